@@ -81,6 +81,20 @@ void Engine::start()
     // Start the game loop
     size_t fpsSamples = 0;
     double totalFps = 0;
+
+    // The game is updated in fixed ticks, catching up with the time that has passed since the last frame.
+    // Counted in microseconds so the ticks add up to the tick rate, the game time is in milliseconds.
+    int64_t simulationTime = 0;
+    int64_t accumulatedTime = 0;
+    int64_t previousFrameTime = GameClock.getElapsedTime().asMicroseconds();
+    bool lastTickUpdated = false;
+
+    // How long the ticks take, to see how much room there is left
+    size_t tickCount = 0;
+    double totalTickTime = 0;
+    double maxTickTime = 0;
+    double averageTickTime = 0;
+
     while (renderWindow_->isOpen()) {
         if (state != state_manager_.getActiveState()) {
             state = state_manager_.getActiveState();
@@ -129,8 +143,39 @@ void Engine::start()
             updated = true;
         }
 
+        const int64_t frameTime = GameClock.getElapsedTime().asMicroseconds();
+        const int64_t elapsed = frameTime - previousFrameTime;
+        previousFrameTime = frameTime;
+
+        // Game time stands still while a dialog is open
         if (!m_currentDialog && state->result == GameState::Result::Running) {
-            updated = state->update(GameClock.getElapsedTime().asMilliseconds()) || updated;
+            accumulatedTime += elapsed;
+
+            int ticks = 0;
+            while (accumulatedTime >= m_tickLength && state->result == GameState::Result::Running) {
+                if (ticks >= MaxTicksPerFrame) {
+                    DBG << "Simulation is" << accumulatedTime / 1000 << "ms behind, skipping ahead";
+                    accumulatedTime %= m_tickLength;
+                    break;
+                }
+
+                simulationTime += m_tickLength;
+
+                const int64_t tickStart = GameClock.getElapsedTime().asMicroseconds();
+                lastTickUpdated = state->update(simulationTime / 1000);
+                const double tickTime = (GameClock.getElapsedTime().asMicroseconds() - tickStart) / 1000.;
+
+                tickCount++;
+                totalTickTime += tickTime;
+                maxTickTime = std::max(maxTickTime, tickTime);
+                averageTickTime = averageTickTime * 0.9 + tickTime * 0.1;
+
+                accumulatedTime -= m_tickLength;
+                ticks++;
+            }
+
+            // Things that moved in the last tick are drawn moving on towards where they are now until the next one
+            updated = lastTickUpdated || updated;
 
             if (state->result != GameState::Result::Running) {
                 if (state->result == GameState::Result::Won) {
@@ -163,13 +208,12 @@ void Engine::start()
             renderWindow_->clear(sf::Color::Green);
             m_mapRenderer->display();
 
-            std::vector<std::weak_ptr<Entity>> visibleEntities;
-            visibleEntities = state->map()->entitiesBetween(m_mapRenderer->firstVisibleColumn(),
-                                                            m_mapRenderer->firstVisibleRow(),
-                                                            m_mapRenderer->lastVisibleColumn(),
-                                                            m_mapRenderer->lastVisibleRow());
-
-            state->unitManager()->render(renderTarget_, visibleEntities);
+            state->unitManager()->render(renderTarget_,
+                                         m_mapRenderer->firstVisibleColumn(),
+                                         m_mapRenderer->firstVisibleRow(),
+                                         m_mapRenderer->lastVisibleColumn(),
+                                         m_mapRenderer->lastVisibleRow(),
+                                         float(accumulatedTime) / m_tickLength);
 
             state->draw();
 
@@ -188,17 +232,31 @@ void Engine::start()
             if (renderTime > 0) {
                 fpsSamples++;
                 totalFps += 1000. / renderTime;
-                fps_label_.setString("fps: " + std::to_string(1000/renderTime));
+                const int tickHeadroom = 100 - 100 * averageTickTime * 1000 / m_tickLength;
+                fps_label_.setString("fps: " + std::to_string(1000/renderTime) + ", tick headroom: " + std::to_string(tickHeadroom) + "%");
             }
 
             // Update the window
             renderWindow_->display();
         } else {
-            sf::sleep(sf::milliseconds(1000 / 60));
+            sf::sleep(sf::microseconds(std::clamp(m_tickLength - accumulatedTime, int64_t(1000), int64_t(1000000 / 60))));
         }
 
     }
     DBG << "avg fps:" << (totalFps / fpsSamples);
+    if (tickCount > 0) {
+        DBG << "avg tick time:" << (totalTickTime / tickCount) << "ms, max:" << maxTickTime << "ms, of" << m_tickLength / 1000. << "ms per tick";
+    }
+}
+
+void Engine::setTickRate(const int ticksPerSecond)
+{
+    if (ticksPerSecond <= 0 || ticksPerSecond > 1000) {
+        WARN << "Invalid tick rate" << ticksPerSecond;
+        return;
+    }
+
+    m_tickLength = 1000000 / ticksPerSecond;
 }
 
 void Engine::addMessage(const std::string &message)
@@ -62,12 +62,20 @@ public:
 
     static const sf::Clock GameClock;
 
+    static constexpr int DefaultTickRate = 30;
+
+    /// In microseconds, a second doesn't divide into whole milliseconds for most tick rates
+    static constexpr int64_t DefaultTickLength = 1000000 / DefaultTickRate;
+
     Engine();
     virtual ~Engine();
 
     bool setup(const std::shared_ptr<genie::ScnFile> &scenario = nullptr);
     void start();
 
+    /// How many times per second the game is updated, independent of how often it is drawn
+    void setTickRate(const int ticksPerSecond);
+
     void addMessage(const std::string &message);
 
 private:
@@ -110,6 +118,12 @@ private:
 
     Time m_lastUpdate = 0u;
 
+    // If frames take so long that it would need more ticks than this to catch up, the game slows down instead
+    static constexpr int MaxTicksPerFrame = 5;
+
+    /// Microseconds, the game time the ticks get is in milliseconds
+    int64_t m_tickLength = DefaultTickLength;
+
     std::unique_ptr<Minimap> m_minimap;
     std::unique_ptr<ActionPanel> m_actionPanel;
     std::unique_ptr<UnitInfoPanel> m_unitInfoPanel;
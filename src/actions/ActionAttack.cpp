@@ -178,7 +178,7 @@ void ActionAttack::spawnMissiles(const Unit::Ptr &source, const int unitId, cons
         MapPos individualTarget = target;
         individualTarget.x +=  -cos(source->angle()) * i*widthDispersion - spawnArea[0]/2.;
         individualTarget.y +=  sin(source->angle()) * i*widthDispersion - spawnArea[1]/2.;
-        Missile::Ptr missile = std::make_shared<Missile>(gunit, source, individualTarget, targetUnit);
+        Missile::Ptr missile = source->unitManager().createMissile(gunit, source, individualTarget, targetUnit);
         missile->setMap(source->map());
 
         missile->setBlastType(Missile::BlastType(source->data()->Combat.BlastAttackLevel), source->data()->Combat.BlastWidth);
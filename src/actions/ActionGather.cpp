@@ -6,6 +6,7 @@
 #include "core/Logger.h"
 #include "core/ResourceMap.h"
 #include "mechanics/Player.h"
+#include "mechanics/ResourceIndex.h"
 #include "mechanics/UnitManager.h"
 
 #include <genie/dat/Unit.h>
@@ -121,6 +122,11 @@ IAction::UpdateResult ActionGather::update(Time time)
     target->resources[m_resourceType] -= amount;
     unit->resources[m_resourceType] += amount;
 
+    // So e. g. farms get updated and turn into dead farms
+    if (target->resources[m_resourceType] <= 0) {
+        target->wakeUp();
+    }
+
     return UpdateResult::Updated;
 }
 
@@ -140,29 +146,32 @@ genie::ActionType ActionGather::taskType() const
 
 std::shared_ptr<Unit> ActionGather::findDropSite(const std::shared_ptr<Unit> &unit)
 {
-    float closestDistance = std::numeric_limits<float>::max();
-    MapPos closestPos = unit->position(); // fallback
-    Unit::Ptr closestUnit;
+    const ResourceIndex &index = unit->unitManager().resourceIndex();
 
-    const int dropUnitId1 = unit->data()->Action.DropSite.first;
-    const int dropUnitId2 = unit->data()->Action.DropSite.second;
-
-    for (const Unit::Ptr &other : unit->unitManager().units()) {
-        if (other->data()->ID != dropUnitId1 && other->data()->ID != dropUnitId2) {
+    Unit *closest = nullptr;
+    float closestDistance = std::numeric_limits<float>::max();
+    for (const int dropUnitId : { unit->data()->Action.DropSite.first, unit->data()->Action.DropSite.second }) {
+        if (dropUnitId < 0) {
             continue;
         }
 
-        const float distance = unit->position().distance(other->position());
-        if (distance > closestDistance) {
+        Unit *dropSite = index.findClosestDropSite(unit->playerId, dropUnitId, unit->position());
+        if (!dropSite) {
             continue;
         }
 
-        closestDistance = distance;
-        closestPos = other->position();
-        closestUnit = other;
+        const float distance = unit->position().distance(dropSite->position());
+        if (distance < closestDistance) {
+            closestDistance = distance;
+            closest = dropSite;
+        }
+    }
+
+    if (!closest) {
+        return nullptr;
     }
 
-    return closestUnit;
+    return Unit::fromEntity(closest->weak_from_this());
 }
 
 
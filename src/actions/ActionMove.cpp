@@ -24,24 +24,13 @@
 #include "mechanics/UnitManager.h"
 #include "mechanics/MapTile.h"
 #include "mechanics/Map.h"
-#include "resource/DataManager.h"
+#include "pathfinding/PathfinderPool.h"
 
 #include <genie/Types.h>
-#include <genie/dat/TerrainRestriction.h>
 #include <genie/dat/Unit.h>
 
-#include <SFML/System/Clock.hpp>
-#include <SFML/System/Time.hpp>
-
 #include <algorithm>
-#include <iosfwd>
-#include <limits>
-#include <queue>
-#include <stack>
-
-#include <system_error>
-#include <unordered_map>
-#include <unordered_set>
+#include <chrono>
 #include <utility>
 
 #include <math.h>
@@ -52,62 +41,11 @@
 std::vector<MapPos> ActionMove::testedPoints;
 #endif
 
-struct SimplePathPoint {
-    SimplePathPoint(const int x_, const int y_) : x(x_), y(y_) {}
-    int x = 0;
-    int y = 0;
-
-    bool operator==(const SimplePathPoint &other) const noexcept {
-        return x == other.x || y == other.y;
-    }
-};
-
-namespace { // anonymous namespace, don't export this
-struct PathPoint {
-    PathPoint() = default;
-
-    int8_t dx = 0;
-    int8_t dy = 0;
-
-    PathPoint(int64_t _x, int64_t _y) : x(_x), y(_y) {}
-
-    int32_t x = 0;
-    int32_t y = 0;
-    float pathLength = 0;
-    float distance = 0;
-
-    bool operator==(const PathPoint &other) const noexcept DUMB_CLANG_IT_IS_USED {
-        return x == other.x && y == other.y;
-    }
-    bool operator!=(const PathPoint &other) const noexcept {
-        return x != other.x || y != other.y;
-    }
-    bool operator<(const PathPoint &other) const noexcept DUMB_CLANG_IT_IS_USED {
-        return other.distance < distance;
-    }
-
-    inline operator SimplePathPoint () const {
-        return {x, y};
-    }
-};
-} //namespace
-template<> struct std::hash<PathPoint>
-{
-    std::size_t operator()(const PathPoint& point) const noexcept DUMB_CLANG_IT_IS_USED
-    {
-        return point.y * 255 * 48 + point.x;
-    }
-};
-
-template<> struct std::hash<SimplePathPoint>
-{
-    std::size_t operator()(const SimplePathPoint& point) const noexcept
-    {
-        return point.y * 255 * 48 + point.x;
-    }
-};
+// How long we wait for other units to get out of the way before we try to find a way around them
+static constexpr Time MAX_BLOCKED_TIME = 1500;
 
-static const float PATHFINDING_HEURISTIC_WEIGHT = 10;
+// How far away other units can be to be considered for avoidance, in tiles
+static constexpr int AVOIDANCE_RANGE = 2;
 
 ActionMove::ActionMove(MapPos destination, const Unit::Ptr &unit, const Task &task) :
     IAction(Type::Move, unit, task),
@@ -116,166 +54,9 @@ ActionMove::ActionMove(MapPos destination, const Unit::Ptr &unit, const Task &ta
 {
     m_destination = destination;
 
-    m_terrainMoveMultipliers = DataManager::Inst().getTerrainRestriction(unit->data()->TerrainRestriction).PassableBuildableDmgMultiplier;
+    m_terrainRestriction = unit->data()->TerrainRestriction;
     m_speed = unit->data()->Speed;
-}
-
-MapPos ActionMove::findClosestWalkableBorder(const MapPos &start, const MapPos &target, int coarseness) noexcept
-{
-    std::shared_ptr<Unit> unit = m_unit.lock();
-    if (!unit) {
-        WARN << "Lost our unit";
-        return start;
-    }
-
-    std::shared_ptr<Unit> targetUnit;
-    const float xSize = unit->data()->Size.x * Constants::TILE_SIZE;
-    const float ySize = unit->data()->Size.y * Constants::TILE_SIZE;
-    const float radius = std::max(xSize, ySize);
-
-    const int tileX = target.x / Constants::TILE_SIZE;
-    const int tileY = target.y / Constants::TILE_SIZE;
-    for (int dx = tileX-1; dx<=tileX+1 && !targetUnit; dx++) {
-        for (int dy = tileY-1; dy<=tileY+1 && !targetUnit; dy++) {
-            if (IS_UNLIKELY(dx < 0 || dy < 0 || dx >= m_map->getCols() || dy >= m_map->getRows())) {
-                continue;
-            }
-            const std::vector<std::weak_ptr<Entity>> &entities = m_map->entitiesAt(dx, dy);
-
-            if (entities.empty()) {
-                continue;
-            }
-
-            for (const std::weak_ptr<Entity> &entity : entities) {
-                Unit::Ptr otherUnit = Unit::fromEntity(entity);
-                if (IS_UNLIKELY(!otherUnit)) {
-                    continue;
-                }
-
-                if (IS_UNLIKELY(otherUnit->id == unit->id)) {
-                    continue;
-                }
-
-                if (otherUnit->data()->Size.z == 0) {
-                    continue;
-                }
-
-                if (otherUnit->distanceTo(target) < radius) {
-                    //                    DBG << "unit in our spot, trying to find a place close to it" << otherUnit->debugName;
-                    targetUnit = std::move(otherUnit);
-                    break;
-                }
-            }
-        }
-    }
-
-    MapPos newPos = start;
-    if (targetUnit) {
-#ifdef DEBUG
-        testedPoints.push_back(target);
-#endif
-        const Size targetSize = targetUnit->clearanceSize();
-        const float targetRadius = std::max(targetSize.width, targetSize.height);
-        const float clearanceLength = std::max(targetRadius, radius);
-
-
-        const float stepSize = M_PI / radius;
-
-        float lowestDistance = std::numeric_limits<float>::max();
-
-        for (float angleOffset = 0; angleOffset < M_PI*2.; angleOffset += stepSize) {
-            MapPos potential(cos(angleOffset), sin(angleOffset));
-            potential = potential * clearanceLength + target;
-            if (!isPassable(potential.x, potential.y)) {
-                continue;
-            }
-
-#ifdef DEBUG
-            testedPoints.push_back(potential);
-#endif
-
-            const float distance = start.distance(potential);
-            if (distance < lowestDistance) {
-                newPos = potential;
-                lowestDistance = distance;
-            }
-        }
-    }
-    if (isPassable(newPos.x, newPos.y)) {
-        return newPos;
-    }
-    // follow a straight line from the target to our location, to find the closest position we can get to
-    // standard bresenham, not the prettiest implementation
-
-    const int x0 = std::round(target.x / coarseness) * coarseness;
-    const int y0 = std::round(target.y / coarseness) * coarseness;
-    const int x1 = std::round(start.x / coarseness) * coarseness;
-    const int y1 = std::round(start.y / coarseness) * coarseness;
-
-    int dx = x1 - x0;
-    int dy = y1 - y0;
-
-    int u, v;
-    int distanceU, distanceV;
-    int uincrX, uincrY, vincrX, vincrY;
-
-    if (std::abs(dx) > std::abs(dy)) {
-        distanceU = std::abs(dx);
-        distanceV = std::abs(dy);
-        u = x1;
-        v = y1;
-        uincrX = 1;
-        uincrY = 0;
-        vincrX = 0;
-        vincrY = 1;
-        if (dx < 0) { uincrX = -uincrX; }
-        if (dy < 0) { vincrY = -vincrY; }
-    } else {
-        distanceU = std::abs(dy);
-        distanceV = std::abs(dx);
-        u = y1;
-        v = x1;
-        uincrX = 0;
-        uincrY = 1;
-        vincrX = 1;
-        vincrY = 0;
-        if (dx < 0) { vincrX = -vincrX; }
-        if (dy < 0) { uincrY = -uincrY; }
-    }
-
-    const int uend = u + distanceU;
-    int d = (2 * distanceV) - distanceU;	    /* Initial value as in Bresenham's */
-    const int incrS = coarseness * 2 * distanceV;	/* Δd for straight increments */
-    const int incrD = coarseness * 2 *(distanceV - distanceU);	/* Δd for diagonal increments */
-
-    int x = x0, y = y0;
-
-    do {
-        if (d < 0) {
-            /* choose straight (u direction) */
-            d = d + incrS;
-        } else {
-            /* choose diagonal (u+v direction) */
-            d = d + incrD;
-            v = v+1;
-            x += vincrX;
-            y += vincrY;
-        }
-
-        u = u+1;
-        x += uincrX;
-        y += uincrY;
-
-        if (isPassable(x, y)) {
-            x += uincrX;
-            y += uincrY;
-            break;
-        }
-    } while (u <= uend);
-
-
-
-    return MapPos(x, y);
+    m_passabilityRevision = m_map->passability().revision();
 }
 
 ActionMove::~ActionMove()
@@ -290,19 +71,17 @@ IAction::UpdateResult ActionMove::update(Time time) noexcept
         return UpdateResult::Failed;
     }
 
-    if (m_passableDirty) {
-        m_passable.reset();
-        m_passableCached.reset();
-    }
+    // Only set if we actually move, others use it to avoid us
+    const MapPos previousVelocity = m_velocity;
+    m_velocity = MapPos();
 
     MapPos unitPosition = unit->position();
-    if (!isPassable(unitPosition.x, unitPosition.y)) {
+    if (!isPassable(unitPosition.x, unitPosition.y, false)) {
         WARN << "we got stuck!" << unit->debugName;
-        unitPosition = findClosestWalkableBorder(m_destination, unitPosition, 1);
-        if (isPassable(unitPosition.x, unitPosition.y)) {
+        if (findWayOut(&unitPosition) && isPassable(unitPosition.x, unitPosition.y)) {
             unitPosition.z = m_map->elevationAt(unitPosition);
             unit->setPosition(unitPosition);
-            updatePath();
+            requestPath(unit, time, true);
             return UpdateResult::Updated;
         }
 
@@ -315,24 +94,61 @@ IAction::UpdateResult ActionMove::update(Time time) noexcept
         }
 
         m_prevTime = time;
-        updatePath();
-        if (m_path.empty()) {
-            return UpdateResult::Failed;
+        if (!m_flowField.valid()) {
+            requestPath(unit, time, true);
         }
-//        if (m_path.back() != unitPosition) {
-//            unit->setPosition(m_path.back()); // Just in case we had to do a coarse check
-//            return UpdateResult::Updated;
-//        }
         return UpdateResult::NotUpdated;
     }
 
+    if (m_flowField.valid()) {
+        if (m_flowField.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            m_prevTime = time;
+            return UpdateResult::NotUpdated;
+        }
+
+        if (!applyFlowField(unitPosition)) {
+            DBG << "Can't use flow field, searching instead" << unit->debugName;
+            requestPath(unit, time, true);
+            m_prevTime = time;
+            return UpdateResult::NotUpdated;
+        }
+    }
+
+    if (m_pendingPath.valid()) {
+        if (m_pendingPath.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            if (!applyPendingPath()) {
+                WARN << "failed to find intermediary path";
+                m_targetReached = true;
+                m_prevTime = time;
+                return UpdateResult::Failed;
+            }
+        } else if (m_waitForPath || m_path.empty()) {
+            // Nowhere to go until the pathfinder is done
+            m_prevTime = time;
+            return UpdateResult::NotUpdated;
+        }
+    }
+
     Unit::Ptr targetUnit = m_targetUnit.lock();
     if (targetUnit) { // check if it moved
         const double targetMovedDistance = m_destination.distance(targetUnit->position());
         m_destination = targetUnit->position();
-        if (targetMovedDistance > 1) {  // chosen by dice roll
+        if (targetMovedDistance > 1 && !m_pendingPath.valid()) {  // chosen by dice roll
             DBG << "Unit moved, repathing";
-            updatePath();
+            // Keep following the old path until we have a new one
+            requestPath(unit, time, false);
+        }
+    }
+
+    // Something was built or destroyed, check if it's in our way
+    const uint32_t passabilityRevision = m_map->passability().revision();
+    if (passabilityRevision != m_passabilityRevision) {
+        m_passabilityRevision = passabilityRevision;
+
+        if (!m_pendingPath.valid() && !m_path.empty() && isPathBlocked(unitPosition)) {
+            DBG << "Path blocked, repairing" << unit->debugName;
+            // Keep going until we get to it
+            requestPathRepair(unit, time, false);
         }
     }
 
@@ -360,18 +176,7 @@ IAction::UpdateResult ActionMove::update(Time time) noexcept
     float elapsed = time - m_prevTime;
     float movement = elapsed * m_speed * 0.15;
 
-
-    float distanceLeft = util::hypot(m_path.back().x - unitPosition.x, m_path.back().y - unitPosition.y);
-    while (movement > distanceLeft && !m_path.empty() && isPassable(m_path.back().x, m_path.back().y)) {
-        movement -= distanceLeft;
-        unitPosition = m_path.back();
-        unitPosition.z = m_map->elevationAt(unitPosition);
-        m_path.pop_back();
-        if (m_path.empty()) {
-            break;
-        }
-        distanceLeft = util::hypot(m_path.back().x - unitPosition.x, m_path.back().y - unitPosition.y);
-    }
+    m_path.resize(m_path.size() - waypointsReached(&unitPosition, &movement));
 
     if (m_path.empty()) {
         m_targetReached = true;
@@ -387,11 +192,9 @@ IAction::UpdateResult ActionMove::update(Time time) noexcept
     }
 
     MapPos nextPos = m_path.back();
-    if (!isPassable(nextPos.x, nextPos.y)) {
+    if (!isPassable(nextPos.x, nextPos.y, false)) {
 //        DBG << "next waypoint inaccessible, repathing" << unit->debugName;
 
-        updatePath();
-
         if (m_destination.rounded() == unit->position().rounded()) {
             DBG << "already in place";
             unitPosition.z = m_map->elevationAt(unitPosition);
@@ -399,26 +202,47 @@ IAction::UpdateResult ActionMove::update(Time time) noexcept
             return UpdateResult::Completed;
         }
 
-        if (m_path.empty()) {
-            WARN << "failed to find new target path";
-            m_targetReached = true;
-            return UpdateResult::Failed;
-        }
-
         if (!isPassable(unitPosition.x, unitPosition.y)) {
             WARN << "ended up in unpassable land";
             return UpdateResult::Failed;
         }
 
+        // Something built in the way, or just units
+        const int nextCol = nextPos.x / Constants::TILE_SIZE + 0.5;
+        const int nextRow = nextPos.y / Constants::TILE_SIZE + 0.5;
+        const bool waypointBlocked = !m_map->passability().isPassable(m_terrainRestriction, nextCol, nextRow);
+
+        m_path.clear();
+        if (waypointBlocked) {
+            requestPathRepair(unit, time, true);
+        } else {
+            requestPath(unit, time, true);
+        }
+
         m_prevTime = time;
         unitPosition.z = m_map->elevationAt(unitPosition);
         unit->setPosition(unitPosition);
         return UpdateResult::NotUpdated;
     }
 
-    const float direction = std::atan2(nextPos.y - unitPosition.y, nextPos.x - unitPosition.x);
+    float direction = std::atan2(nextPos.y - unitPosition.y, nextPos.x - unitPosition.x);
     MapPos newPos = unitPosition;
-    if (util::hypot(nextPos.x - newPos.x, nextPos.y - newPos.y) < movement) {
+
+    const float maxSpeed = m_speed * 0.15;
+    const MapPos preferredVelocity(std::cos(direction) * maxSpeed, std::sin(direction) * maxSpeed);
+    MapPos velocity;
+    if (m_intent.time == time && m_intent.position == unitPosition && m_intent.nextPosition == nextPos && m_intent.previousVelocity == previousVelocity) {
+        velocity = m_intent.velocity;
+    } else {
+        velocity = avoidUnits(unit, unitPosition, previousVelocity, preferredVelocity, maxSpeed);
+    }
+    if (velocity != preferredVelocity && maxSpeed > 0) {
+        // Might be slower, or standing still to let someone past
+        direction = std::atan2(velocity.y, velocity.x);
+        movement *= util::hypot(velocity.x, velocity.y) / maxSpeed;
+        newPos.x += std::cos(direction) * movement;
+        newPos.y += std::sin(direction) * movement;
+    } else if (util::hypot(nextPos.x - newPos.x, nextPos.y - newPos.y) < movement) {
         newPos = nextPos;
     } else {
         newPos.x += std::cos(direction) * movement;
@@ -445,46 +269,63 @@ IAction::UpdateResult ActionMove::update(Time time) noexcept
             DBG << "destination isn't passable, trying again next round";
             return UpdateResult::NotUpdated;
         }
-        DBG << "can't move forward, finding intermediat path for" << unit->debugName;
 
-        std::vector<MapPos> partial = findPath(unitPosition, nextPos, 1);
-        if (partial.size() < 2) {
-            WARN << "failed to find intermediary path";
-            m_targetReached = true;
+        // Just other units in the way, give them a chance to move before we try to go around
+        if (isPassable(newPos.x, newPos.y, false) && m_blockedTime < MAX_BLOCKED_TIME) {
+            m_blockedTime += elapsed;
             m_prevTime = time;
+            return UpdateResult::NotUpdated;
+        }
+        m_blockedTime = 0;
 
-            if (!isPassable(unitPosition.x, unitPosition.y)) {
-                WARN << "ended up in unpassable land";
-                return UpdateResult::Failed;
-            }
-            unitPosition.z = m_map->elevationAt(unitPosition);
-            unit->setPosition(unitPosition);
-            return UpdateResult::Failed;
-        } else {
-            DBG << "found intermediary";
-            m_path.insert(m_path.begin(), ++partial.begin(), partial.end());
-            m_prevTime = time;
+        DBG << "can't move forward, finding intermediat path for" << unit->debugName;
 
-            if (!isPassable(unitPosition.x, unitPosition.y)) {
-                WARN << "ended up in unpassable land";
-                return UpdateResult::Failed;
-            }
-            unitPosition.z = m_map->elevationAt(unitPosition);
-            unit->setPosition(unitPosition);
-            return UpdateResult::Updated;
+        if (!isPassable(unitPosition.x, unitPosition.y)) {
+            WARN << "ended up in unpassable land";
+            return UpdateResult::Failed;
         }
+
+        requestIntermediatePath(unit, unitPosition, nextPos, time);
+
+        m_prevTime = time;
+        unitPosition.z = m_map->elevationAt(unitPosition);
+        unit->setPosition(unitPosition);
+        return UpdateResult::Updated;
     }
 
+    // Standing still or sidestepping to let others past doesn't count as getting anywhere,
+    // so if that goes on for too long we look for a way around them as well
+    const float progress = util::hypot(nextPos.x - unitPosition.x, nextPos.y - unitPosition.y) - util::hypot(nextPos.x - newPos.x, nextPos.y - newPos.y);
+    if (progress > 0.f) {
+        m_blockedTime = 0;
+    } else if (m_blockedTime < MAX_BLOCKED_TIME) {
+        m_blockedTime += elapsed;
+    } else {
+        m_blockedTime = 0;
+
+        DBG << "not getting anywhere, finding intermediate path for" << unit->debugName;
 
-    ScreenPos sourceScreen = unitPosition.toScreen();
-    ScreenPos targetScreen = newPos.toScreen();
-    unit->setAngle(sourceScreen.angleTo(targetScreen));
+        requestIntermediatePath(unit, unitPosition, nextPos, time);
+
+        m_prevTime = time;
+        m_velocity = MapPos();
+        return UpdateResult::Updated;
+    }
+
+    if (newPos != unitPosition) {
+        ScreenPos sourceScreen = unitPosition.toScreen();
+        ScreenPos targetScreen = newPos.toScreen();
+        unit->setAngle(sourceScreen.angleTo(targetScreen));
+    }
     newPos.z = m_map->elevationAt(newPos);
 
     if (!isPassable(newPos.x, newPos.y)) {
         WARN << "ended up in unpassable land";
         return UpdateResult::Failed;
     }
+    if (elapsed > 0) {
+        m_velocity = MapPos((newPos.x - unitPosition.x) / elapsed, (newPos.y - unitPosition.y) / elapsed);
+    }
     unit->setPosition(newPos);
 
     m_prevTime = time;
@@ -492,299 +333,176 @@ IAction::UpdateResult ActionMove::update(Time time) noexcept
     return UpdateResult::Updated;
 }
 
-std::shared_ptr<ActionMove> ActionMove::moveUnitTo(const UnitPtr &unit, const UnitPtr &targetUnit) noexcept
+void ActionMove::think(Time time) noexcept
 {
-    if (!unit->data()->Speed) {
-        DBG << "Handed unit that can't move" << unit->debugName;
-        return nullptr;
-    }
+    m_intent.time = 0;
 
-    std::shared_ptr<ActionMove> action = moveUnitTo(unit, targetUnit->position());
-    action->m_targetUnit = targetUnit;
-
-    return action;
-}
-
-std::shared_ptr<ActionMove> ActionMove::moveUnitTo(const UnitPtr &unit, const UnitPtr &targetUnit, const Task &task) noexcept
-{
-    if (!unit->data()->Speed) {
-        DBG << "Handed unit that can't move" << unit->debugName;
-        return nullptr;
+    // Waiting for something or done, the update takes care of it
+    if (!m_prevTime || m_targetReached || m_path.empty()) {
+        return;
     }
 
-    std::shared_ptr<ActionMove> action = moveUnitTo(unit, targetUnit->position(), task);
-    action->m_targetUnit = targetUnit;
-
-    return action;
-}
-
-std::shared_ptr<ActionMove> ActionMove::moveUnitTo(const Unit::Ptr &unit, MapPos destination, const Task &task) noexcept
-{
-    if (!unit->data()->Speed) {
-        DBG << "Handed unit that can't move" << unit->debugName;
-        return nullptr;
+    const Unit::Ptr unit = m_unit.lock();
+    if (!unit) {
+        return;
     }
 
+    MapPos position = unit->position();
+    const float elapsed = time - m_prevTime;
+    float movement = elapsed * m_speed * 0.15;
 
-    std::shared_ptr<ActionMove> action (new ActionMove(destination, unit, task));
-
-    return action;
-}
-
-std::shared_ptr<ActionMove> ActionMove::moveUnitTo(const Unit::Ptr &unit, MapPos destination) noexcept
-{
-    static genie::Task defaultGenieMoveTask;
-    defaultGenieMoveTask.ActionType = genie::ActionType::MoveTo;
-
-    return moveUnitTo(unit, destination, Task(defaultGenieMoveTask, -1));
-}
-
-#if 0
-static std::vector<MapPos> simplifyAngles(const std::vector<MapPos> &path)
-{
-    std::vector<MapPos> cleanedPath;
-    cleanedPath.push_back(path[0]);
-    for (size_t i=1; i<path.size() - 1; i++) {
-        double lastAngle = std::atan2((path[i].y - path[i-1].y), (path[i].x - path[i-1].x));
-        double nextAngle = std::atan2((path[i+1].y - path[i].y), (path[i+1].x - path[i].x));
-        if (lastAngle != nextAngle) {
-            cleanedPath.push_back(path[i]);
-        }
+    const size_t reached = waypointsReached(&position, &movement);
+    if (reached == m_path.size()) {
+        return;
     }
-    cleanedPath.push_back(path.back());
+    const MapPos &nextPos = m_path[m_path.size() - 1 - reached];
+
+    const float direction = std::atan2(nextPos.y - position.y, nextPos.x - position.x);
+    const float maxSpeed = m_speed * 0.15;
+    const MapPos preferredVelocity(std::cos(direction) * maxSpeed, std::sin(direction) * maxSpeed);
 
-    return cleanedPath;
+    m_intent.position = position;
+    m_intent.nextPosition = nextPos;
+    m_intent.previousVelocity = m_velocity;
+    m_intent.velocity = avoidUnits(unit, position, m_velocity, preferredVelocity, maxSpeed);
+    m_intent.time = time;
 }
-#endif
 
-static std::vector<MapPos> simplifyRdp(const std::vector<MapPos> &path, const float epsilon) noexcept
+size_t ActionMove::waypointsReached(MapPos *position, float *movement) noexcept
 {
-    if (path.empty()) {
-        return path;
-    }
-
-    std::vector<MapPos> cleanedPath;
-
-
-    std::stack<std::pair<int, int>> ranges;
-    ranges.push({0, path.size() - 1});
-    std::vector<bool> selected(path.size(), true);
-
-    while (!ranges.empty()) {
-        const int start = ranges.top().first;
-        const int end = ranges.top().second;
-        ranges.pop();
-
-        float dmax = -1;
-        int index = 0;
-        for (int i = start + 1; i < end - 1; i++) {
-            float d = path[i].distanceToLine(path[start], path[end]);
-            if (d > dmax) {
-                index = i;
-                dmax = d;
-            }
-        }
-
-        if (dmax > epsilon) {
-            ranges.push({start, index});
-            ranges.push({index, end});
-        } else {
-            for (int i=start + 1; i<end; i++) {
-                selected[i] = false;
-            }
+    size_t reached = 0;
+    while (reached < m_path.size()) {
+        const MapPos &waypoint = m_path[m_path.size() - 1 - reached];
+        const float distanceLeft = util::hypot(waypoint.x - position->x, waypoint.y - position->y);
+        if (*movement <= distanceLeft || !isPassable(waypoint.x, waypoint.y)) {
+            break;
         }
-    }
 
-    for (size_t i=0; i<path.size(); i++) {
-        if (selected[i]) {
-            cleanedPath.push_back(path[i]);
-        }
+        *movement -= distanceLeft;
+        *position = waypoint;
+        position->z = m_map->elevationAt(*position);
+        reached++;
     }
 
-//    DBG << "after cleaning" << cleanedPath.size() << "/" << path.size();
-
-    return cleanedPath;
+    return reached;
 }
 
-std::vector<MapPos> ActionMove::findPath(MapPos start, MapPos end, int coarseness) noexcept
+MapPos ActionMove::avoidUnits(const Unit::Ptr &unit, const MapPos &position, const MapPos &currentVelocity, const MapPos &preferredVelocity, const float maxSpeed) noexcept
 {
-#ifdef DEBUG
-    testedPoints.clear();
-#endif
-    if (start == end) {
-        return {};
-    }
-
-    sf::Clock clock;
-
-    std::vector<MapPos> path;
+    const int tileX = position.x / Constants::TILE_SIZE + 0.5;
+    const int tileY = position.y / Constants::TILE_SIZE + 0.5;
 
-    int startX = std::round(start.x / coarseness);
-    int startY = std::round(start.y / coarseness);
-    int endX = std::round(end.x / coarseness);
-    int endY = std::round(end.y / coarseness);
-    if (!isPassable(startX * coarseness, startY * coarseness)) {
-        WARN << "handed unpassable start, attempting to get out";
-        start = findClosestWalkableBorder(MapPos(endX * coarseness, endY * coarseness), MapPos(startX * coarseness, startY * coarseness), coarseness);
-        startX = std::round(start.x / coarseness);
-        startY = std::round(start.y / coarseness);
-    }
-
-    if (!isPassable(startX * coarseness, startY * coarseness)) {
-        WARN << "handed unpassable start, failed to find new";
-        return path;
-    }
+    const genie::XYZF &size = unit->data()->Size;
+    const float ownClearance = std::max(size.x, size.y) * Constants::TILE_SIZE;
 
-    if (!isPassable(endX * coarseness, endY * coarseness)) {
-//        WARN << "handed unpassable target, attempting to get out";
-        start = findClosestWalkableBorder(start, end, coarseness);
-        startX = std::round(start.x / coarseness);
-        startY = std::round(start.y / coarseness);
-    }
-
-    if (!isPassable(endX * coarseness, endY * coarseness)) {
-        WARN << "handed unpassable target";
-        return path;
-    }
-
-    PathPoint currentPosition(startX, startY);
-
-    std::unordered_map<PathPoint, PathPoint> cameFrom;
-
-    // STL is a steaming pile of shit
-    std::priority_queue<PathPoint> queue;
-    currentPosition.distance = util::hypot(startX - endX, startY - endY);
-    currentPosition.pathLength = 0;
-    queue.push(currentPosition);
-
-    std::unordered_set<SimplePathPoint> visited;
-    visited.insert(currentPosition);
-
-    PathPoint parent;
-    size_t tried = 0;
-    while (!queue.empty()) {
-        tried++;
-        parent = queue.top();
-        queue.pop();
-
-        if (parent.x == endX && parent.y == endY) {
-            break;
-        }
-
-        visited.insert(parent);
-
-#ifdef DEBUG
-        testedPoints.push_back(MapPos(parent.x * coarseness, parent.y * coarseness));
-#endif
+    m_neighbours.clear();
+    for (int dx = tileX - AVOIDANCE_RANGE; dx <= tileX + AVOIDANCE_RANGE; dx++) {
+        for (int dy = tileY - AVOIDANCE_RANGE; dy <= tileY + AVOIDANCE_RANGE; dy++) {
+            if (IS_UNLIKELY(dx < 0 || dy < 0 || dx >= m_map->getCols() || dy >= m_map->getRows())) {
+                continue;
+            }
 
-        for (int dx = -1; dx <= 1; dx++) {
-            for (int dy = -1; dy <= 1; dy++) {
-                if (!dx && !dy) {
+            for (Entity &entity : m_map->entitiesAt(dx, dy)) {
+                const Unit *otherUnit = Unit::fromEntity(entity);
+                if (!otherUnit || otherUnit->id == unit->id) {
                     continue;
                 }
 
-                // Check if we're checking backwards
-                if (parent.dy == 0 && dy != 0 && parent.dx * dx < 0)  {
-                    continue;
-                }
-                if (parent.dx == 0 && dx != 0 && parent.dy * dy < 0) {
+                if (otherUnit->data()->Size.z == 0) {
                     continue;
                 }
 
-                const int nx = parent.x + dx;
-                const int ny = parent.y + dy;
-
-                // looking up in visited is expensive, try to avoid that
-                if (nx == parent.x && ny == parent.y) {
+                // Same as in isPassable(), the rest is in the map passability or can be walked through
+                switch (otherUnit->data()->ObstructionType) {
+                case genie::Unit::PassableObstruction:
+                case genie::Unit::PassableObstruction2:
+                case genie::Unit::PassableNoOutlineObstruction:
+                case genie::Unit::BuildingObstruction:
+                case genie::Unit::MountainObstruction:
                     continue;
+                case genie::Unit::UnitObstruction:
+                default:
+                    break;
                 }
 
-                // We already came from there
-                if (nx == parent.x + parent.dx && ny == parent.y + parent.dy) {
-                    continue;
-                }
+                const Size otherSize = otherUnit->clearanceSize();
 
+                LocalAvoidance::Neighbour neighbour;
+                neighbour.position = otherUnit->position();
+                neighbour.clearance = std::max(ownClearance, std::max(otherSize.width, otherSize.height));
 
-                SimplePathPoint position(nx, ny);
-                if (visited.find(position) != visited.end()) {
-                    continue;
+                const ActionPtr &otherAction = otherUnit->currentAction();
+                if (otherAction && otherAction->type == IAction::Type::Move) {
+                    neighbour.velocity = static_cast<const ActionMove*>(otherAction.get())->velocity();
+                    neighbour.reciprocal = true;
                 }
 
-                if (!isPassable(nx * coarseness, ny * coarseness)) {
-                    visited.insert(position);
-                    continue;
-                }
-                PathPoint pathPoint(nx, ny);
+                m_neighbours.push_back(neighbour);
+            }
+        }
+    }
 
+    return LocalAvoidance::chooseVelocity(position, currentVelocity, preferredVelocity, maxSpeed, m_neighbours);
+}
 
-                if (cameFrom.find(pathPoint) != cameFrom.end()) {
-                    if ((cameFrom[pathPoint].pathLength < parent.pathLength)) {
-                        continue;
-                    }
-                }
+std::shared_ptr<ActionMove> ActionMove::moveUnitTo(const UnitPtr &unit, const UnitPtr &targetUnit) noexcept
+{
+    if (!unit->data()->Speed) {
+        DBG << "Handed unit that can't move" << unit->debugName;
+        return nullptr;
+    }
 
-                pathPoint.dx = dx;
-                pathPoint.dy = dx;
+    std::shared_ptr<ActionMove> action = moveUnitTo(unit, targetUnit->position());
+    action->m_targetUnit = targetUnit;
 
-                const int diagCost = 3;
-                const int straightCost = 2;
-                if (!dx || !dy) {
-                    pathPoint.pathLength = parent.pathLength + straightCost;
-                } else {
-                    pathPoint.pathLength = parent.pathLength + diagCost;
-                }
-//                pathPoint.pathLength = parent.pathLength + 1.; // chebychev
-//                pathPoint.pathLength = parent.pathLength + std::abs(dx) + std::abs(dy); // manhattan
-//                pathPoint.pathLength = parent.pathLength + util::hypot(dx, dy); // euclidian
+    return action;
+}
 
-//                pathPoint.distance = pathPoint.pathLength + (std::abs(nx - endX) + std::abs(ny - endY)) * PATHFINDING_HEURISTIC_WEIGHT; // manhattan
-                pathPoint.distance = pathPoint.pathLength + util::hypot(nx - endX, ny - endY) * PATHFINDING_HEURISTIC_WEIGHT * straightCost;
-                queue.push(pathPoint);
+std::shared_ptr<ActionMove> ActionMove::moveUnitTo(const UnitPtr &unit, const UnitPtr &targetUnit, const Task &task) noexcept
+{
+    if (!unit->data()->Speed) {
+        DBG << "Handed unit that can't move" << unit->debugName;
+        return nullptr;
+    }
 
-                cameFrom[pathPoint] = parent;
-            }
-        }
+    std::shared_ptr<ActionMove> action = moveUnitTo(unit, targetUnit->position(), task);
+    action->m_targetUnit = targetUnit;
 
-        if (clock.getElapsedTime().asMilliseconds() > 50) {
-            WARN << "Timeout while pathing (" << tried << "nodes in" << clock.getElapsedTime().asMilliseconds() << "ms)";
-            DBG << "visited" << visited.size();
-            DBG << "queue size" << queue.size();
-            return path;
-        }
-    }
-    const int32_t elapsed = clock.getElapsedTime().asMilliseconds();
-    if (elapsed > 10) {
-        DBG << "walked" << tried << "nodes in" << elapsed << "ms";
-        DBG << "visited" << visited.size();
-    }
+    return action;
+}
 
-    if (cameFrom.find(parent) == cameFrom.end()) {
-        WARN << "Failed to find path from" << startX << "," << startY << "to" << endX << "," << endY;
-        DBG << parent.x << parent.y;
-        return path;
+std::shared_ptr<ActionMove> ActionMove::moveUnitTo(const Unit::Ptr &unit, MapPos destination, const Task &task) noexcept
+{
+    if (!unit->data()->Speed) {
+        DBG << "Handed unit that can't move" << unit->debugName;
+        return nullptr;
     }
 
-    path.push_back(end);
 
-    while (cameFrom[parent] != currentPosition) {
-        parent = cameFrom[parent];
-        path.emplace_back(parent.x * coarseness, parent.y * coarseness);
+    std::shared_ptr<ActionMove> action (new ActionMove(destination, unit, task));
+
+    return action;
+}
 
-        if (cameFrom.find(parent) == cameFrom.end()) {
-            WARN << "invalid path, failed to find previous step";
-            return path;
-        }
+std::shared_ptr<ActionMove> ActionMove::moveUnitTo(const UnitPtr &unit, MapPos destination, const FlowField::Future &flowField) noexcept
+{
+    std::shared_ptr<ActionMove> action = moveUnitTo(unit, destination);
+    if (action) {
+        action->m_flowField = flowField;
     }
-//    DBG << "final path length" << path.size();
 
-    return path;
+    return action;
+}
+
+std::shared_ptr<ActionMove> ActionMove::moveUnitTo(const Unit::Ptr &unit, MapPos destination) noexcept
+{
+    static genie::Task defaultGenieMoveTask;
+    defaultGenieMoveTask.ActionType = genie::ActionType::MoveTo;
 
-//    return simplifyRdp(simplifyAngles(path), coarseness);
-//    return simplifyAngles(path);
-//    return simplifyRdp(path, coarseness*1.5);
+    return moveUnitTo(unit, destination, Task(defaultGenieMoveTask, -1));
 }
 
-bool ActionMove::isPassable(const float x, const float y) noexcept
+bool ActionMove::isPassable(const float x, const float y, const bool includeMovingUnits) noexcept
 {
     if (IS_UNLIKELY(x < 0 || y < 0)) {
         return false;
@@ -795,17 +513,7 @@ bool ActionMove::isPassable(const float x, const float y) noexcept
         return false;
     }
 
-    const unsigned cacheIndex = x  + y * Constants::TILE_SIZE * Constants::MAP_MAX_SIZE;
-    if (m_passableCached[cacheIndex]) {
-        return m_passable[cacheIndex];
-    }
-
-    m_passableDirty = true;
-    m_passableCached[cacheIndex] = true;
-
-    const MapTile &tile = m_map->getTileAt(tileX, tileY);
-    if (m_terrainMoveMultipliers[tile.terrainId] == 0) {
-        m_passable[cacheIndex] = false;
+    if (!m_map->passability().isPassable(m_terrainRestriction, tileX, tileY)) {
         return false;
     }
 
@@ -820,10 +528,8 @@ bool ActionMove::isPassable(const float x, const float y) noexcept
             if (IS_UNLIKELY(dx < 0 || dy < 0 || dx >= m_map->getCols() || dy >= m_map->getRows())) {
                 continue;
             }
-            const std::vector<std::weak_ptr<Entity>> &entities = m_map->entitiesAt(dx, dy);
-
-            for (size_t i=0; i<entities.size(); i++) {
-                const Unit::Ptr otherUnit = Unit::fromEntity(entities[i]);
+            for (Entity &entity : m_map->entitiesAt(dx, dy)) {
+                const Unit *otherUnit = Unit::fromEntity(entity);
                 if (IS_UNLIKELY(!otherUnit)) {
                     continue;
                 }
@@ -842,21 +548,21 @@ bool ActionMove::isPassable(const float x, const float y) noexcept
                 case genie::Unit::PassableNoOutlineObstruction:
                     continue;
                 case genie::Unit::BuildingObstruction:
-                case genie::Unit::MountainObstruction: // TOOD:  apparently uses the selection mask?
-                    if (dx == tileX && dy == tileY) { // TODO: need to check the distance from the tile
-                        m_passable[cacheIndex] = false;
-                        return false;
-                    }
-                    break;
+                case genie::Unit::MountainObstruction:
+                    // Handled by the map passability
+                    continue;
                 case genie::Unit::UnitObstruction:
                 default: {
+                    if (!includeMovingUnits && otherUnit->data()->Speed > 0) {
+                        continue;
+                    }
+
                     const MapPos &otherPos = otherUnit->position();
 
                     const double centreDistance = util::hypot(x - otherPos.x, y - otherPos.y, z - otherPos.z);
                     const Size otherSize = otherUnit->clearanceSize();
                     const double clearance = std::max(std::max(size.x, size.y), std::max(otherSize.width, otherSize.height));
                     if (centreDistance < clearance) {
-                        m_passable[cacheIndex] = false;
                         return false;
                     }
                     break;
@@ -866,89 +572,172 @@ bool ActionMove::isPassable(const float x, const float y) noexcept
         }
     }
 
-    m_passable[cacheIndex] = true;
     return true;
 }
 
-void ActionMove::updatePath() noexcept
+bool ActionMove::findWayOut(MapPos *position) const noexcept
 {
-#ifdef DEBUG
-    testedPoints.clear();
-#endif
-    TIME_THIS;
-
-    m_path.clear();
-    std::shared_ptr<Unit> unit = m_unit.lock();
-    if (!unit) {
-        WARN << "Lost our unit";
-        return;
+    const RegionMap::Ptr regions = m_map->passability().regions(m_terrainRestriction);
+    if (IS_UNLIKELY(!regions)) {
+        return false;
     }
 
-    if (false) { // TODO use this and run the pathfinding in a background thread
-        TIME_THIS;
-        std::vector<MapUnit> mapUnits;
-        MapUnit mapUnit;
-        for (const Unit::Ptr &unit : unit->unitManager().units()) {
-            mapUnit.pos = unit->position();
-            mapUnit.size = unit->data()->ClearanceSize;
+    const int col = position->x / Constants::TILE_SIZE + 0.5;
+    const int row = position->y / Constants::TILE_SIZE + 0.5;
 
-            switch (unit->data()->ObstructionType) {
-            case genie::Unit::PassableObstruction:
-            case genie::Unit::PassableObstruction2:
-            case genie::Unit::PassableNoOutlineObstruction:
-                continue;
-            case genie::Unit::BuildingObstruction:
-            case genie::Unit::MountainObstruction: // TOOD:  apparently uses the selection mask?
-                mapUnit.rectangular = true;
-                break;
-            case genie::Unit::UnitObstruction:
-            default:
-                mapUnit.rectangular = false;
-                break;
-            }
+    // Prefer getting out on the side where we're going
+    int region = regions->regionAt(m_destination.x / Constants::TILE_SIZE + 0.5, m_destination.y / Constants::TILE_SIZE + 0.5);
 
-            mapUnits.push_back(std::move(mapUnit));
+    // Otherwise whatever is closest, e.g. if something got built on top of us and we're going inside it
+    for (int radius = 1; region == RegionMap::NoRegion && radius <= MaxWayOutDistance; radius++) {
+        for (int dy = -radius; dy <= radius && region == RegionMap::NoRegion; dy++) {
+            for (int dx = -radius; dx <= radius && region == RegionMap::NoRegion; dx++) {
+                if (std::abs(dx) != radius && std::abs(dy) != radius) {
+                    continue;
+                }
+                region = regions->regionAt(col + dx, row + dy);
+            }
         }
-        DBG << mapUnits.size();
     }
 
-    TIME_TICK;
+    int closestCol = 0, closestRow = 0;
+    if (!regions->findClosestInRegion(region, col, row, &closestCol, &closestRow)) {
+        return false;
+    }
+
+    position->x = closestCol * Constants::TILE_SIZE;
+    position->y = closestRow * Constants::TILE_SIZE;
+
+    return true;
+}
+
+PathRequest ActionMove::createPathRequest(const ObstructionSnapshot::Ptr &snapshot, const genie::Unit &data, const int unitId, const MapPos &start, const MapPos &destination) noexcept
+{
+    PathRequest request;
+    request.snapshot = snapshot;
+    request.start = start;
+    request.destination = destination;
+    request.unitId = unitId;
+    request.unitRadius = std::max(data.Size.x, data.Size.y) * Constants::TILE_SIZE;
+    return request;
+}
+
+PathRequest ActionMove::createPathRequest(const Unit::Ptr &unit, const Time time) noexcept
+{
+    return createPathRequest(PathfinderPool::Inst().snapshot(m_map, m_terrainRestriction, time), *unit->data(), unit->id, unit->position(), m_destination);
+}
 
-    MapPos newDest = m_destination;
-    if (!isPassable(m_destination.x, m_destination.y)) {
-        // WARN << "target not passable, finding closest possible position";
-        newDest = findClosestWalkableBorder(unit->position(), m_destination, 2);
-        m_destination = newDest;
+void ActionMove::requestPath(const Unit::Ptr &unit, const Time time, const bool waitForPath) noexcept
+{
+    PathRequest request = createPathRequest(unit, time);
+
+    m_requestedDestination = m_destination;
+    m_pendingPathType = PathRequest::FullPath;
+    m_pendingPath = PathfinderPool::Inst().findPath(std::move(request));
+    m_waitForPath = waitForPath;
+}
+
+void ActionMove::requestIntermediatePath(const Unit::Ptr &unit, const MapPos &start, const MapPos &target, const Time time) noexcept
+{
+    PathRequest request = createPathRequest(unit, time);
+    request.type = PathRequest::IntermediatePath;
+    request.avoidMovingUnits = true;
+    request.start = start;
+    request.destination = target;
+
+    m_pendingPathType = PathRequest::IntermediatePath;
+    m_pendingPath = PathfinderPool::Inst().findPath(std::move(request));
+    m_waitForPath = true;
+}
+
+const IncrementalPath::Ptr &ActionMove::incrementalPathToDestination() noexcept
+{
+    const int goalCol = m_destination.x / Constants::TILE_SIZE + 0.5;
+    const int goalRow = m_destination.y / Constants::TILE_SIZE + 0.5;
+    if (!m_incrementalPath || m_incrementalPath->goalCol() != goalCol || m_incrementalPath->goalRow() != goalRow) {
+        m_incrementalPath = std::make_shared<IncrementalPath>(goalCol, goalRow);
     }
 
-    TIME_TICK;
-    m_path = simplifyRdp(findPath(unit->position(), newDest, 2), 2 * 1.3);
+    return m_incrementalPath;
+}
 
-    // Try coarser
-    // Uglier, but hopefully faster
-    if (m_path.empty()) {
-        WARN << "failed to find path, trying 0.2 resolution";
-        if (newDest != m_destination) {
-            newDest = findClosestWalkableBorder(unit->position(), m_destination, 5);
-            m_destination = newDest;
+void ActionMove::requestPathRepair(const Unit::Ptr &unit, const Time time, const bool waitForPath) noexcept
+{
+    PathRequest request = createPathRequest(unit, time);
+    request.type = PathRequest::RepairPath;
+    request.incrementalPath = incrementalPathToDestination();
+
+    m_requestedDestination = m_destination;
+    m_pendingPathType = PathRequest::RepairPath;
+    m_pendingPath = PathfinderPool::Inst().findPath(std::move(request));
+    m_waitForPath = waitForPath;
+}
+
+bool ActionMove::isPathBlocked(const MapPos &unitPosition) const noexcept
+{
+    const PassabilityMap &passability = m_map->passability();
+
+    // Path is reversed, so walk from the back
+    MapPos from = unitPosition;
+    for (std::vector<MapPos>::const_reverse_iterator it = m_path.rbegin(); it != m_path.rend(); it++) {
+        const MapPos &to = *it;
+        const int steps = std::ceil(from.distance(to) / (Constants::TILE_SIZE / 2)) + 1;
+        for (int i=0; i<=steps; i++) {
+            const float x = from.x + (to.x - from.x) * i / steps;
+            const float y = from.y + (to.y - from.y) * i / steps;
+            if (!passability.isPassable(m_terrainRestriction, x / Constants::TILE_SIZE + 0.5, y / Constants::TILE_SIZE + 0.5)) {
+                return true;
+            }
         }
-        m_path = simplifyRdp(findPath(unit->position(), newDest, 5), 5 * 1.3);
+        from = to;
     }
 
-    TIME_TICK;
+    return false;
+}
 
-    if (m_path.empty()) {
-        WARN << "failed to find path, trying 0.1 resolution";
-        if (newDest != m_destination) {
-            newDest = findClosestWalkableBorder(unit->position(), m_destination, 10);
-            m_destination = newDest;
+bool ActionMove::applyPendingPath() noexcept
+{
+    PathResult result = m_pendingPath.get();
+    m_waitForPath = false;
+
+#ifdef DEBUG
+    testedPoints = std::move(result.testedPoints);
+#endif
+
+    if (m_pendingPathType == PathRequest::IntermediatePath) {
+        if (result.path.size() < 2) {
+            return false;
         }
-        m_path = simplifyRdp(findPath(unit->position(), newDest, 10), 10 * 1.3);
+
+        DBG << "found intermediary";
+        // First is the waypoint we were trying to get to, which we already have
+        m_path.insert(m_path.end(), ++result.path.begin(), result.path.end());
+        return true;
+    }
+
+    m_path = std::move(result.path);
+
+    // Don't overwrite if it has changed while we were waiting
+    if (m_destination == m_requestedDestination) {
+        m_destination = result.destination;
     }
 
     if (m_path.empty()) {
-        DBG << "Failed to find path for" << unit->debugName;
+        DBG << "Failed to find path";
+    }
+
+    return true;
+}
+
+bool ActionMove::applyFlowField(const MapPos &unitPosition) noexcept
+{
+    const FlowField::Ptr field = m_flowField.get();
+    m_flowField = FlowField::Future();
+
+    if (!field) {
+        return false;
     }
 
-    TIME_TICK;
+    m_path = field->pathFrom(unitPosition, m_destination);
+    return !m_path.empty();
 }
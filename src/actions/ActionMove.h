@@ -21,26 +21,25 @@
 #include "actions/IAction.h"
 
 #include "core/Constants.h"
+#include "pathfinding/FlowField.h"
+#include "pathfinding/LocalAvoidance.h"
+#include "pathfinding/Pathfinder.h"
 
-#include <bitset>
+#include <future>
 #include <memory>
 #include <vector>
-#include <thread>
 
 struct Unit;
 using UnitPtr = std::shared_ptr<Unit>;
 class Map;
 using MapPtr = std::shared_ptr<Map>;
+namespace genie {
+class Unit;
+}
 
 
 class ActionMove : public IAction
 {
-    struct MapUnit {
-        MapPos pos;
-        Size size;
-        bool rectangular = false;
-    };
-
 public:
 #ifdef DEBUG
     static std::vector<MapPos> testedPoints;
@@ -49,35 +48,101 @@ public:
 
     UpdateResult update(Time time) noexcept override;
 
+    /// Works out how to get past the other units in the next update, from where everyone is now.
+    /// Doesn't change anything anyone else looks at, so all the moving units can do it at the
+    /// same time before they are updated. The update uses it if what it was based on is the same.
+    /// Runs on the job threads, so it must only read the map and the passability.
+    void think(Time time) noexcept;
+
     static std::shared_ptr<ActionMove> moveUnitTo(const UnitPtr &unit, MapPos destination, const Task &task) noexcept;
     static std::shared_ptr<ActionMove> moveUnitTo(const UnitPtr &unit, MapPos destination) noexcept;
     static std::shared_ptr<ActionMove> moveUnitTo(const UnitPtr &unit, const UnitPtr &targetUnit) noexcept;
     static std::shared_ptr<ActionMove> moveUnitTo(const UnitPtr &unit, const UnitPtr &targetUnit, const Task &task) noexcept;
+
+    /// For group moves, follows the shared flow field instead of doing a separate search
+    static std::shared_ptr<ActionMove> moveUnitTo(const UnitPtr &unit, MapPos destination, const FlowField::Future &flowField) noexcept;
     const std::vector<MapPos> &path() const noexcept { return m_path; }
+
+    /// How far we moved in the last update, in pixels per millisecond
+    const MapPos &velocity() const noexcept { return m_velocity; }
     genie::ActionType taskType() const noexcept override { return genie::ActionType::MoveTo; }
 
+    /// What requestPath() asks the pathfinder for, so the benchmarks can send the same requests
+    static PathRequest createPathRequest(const ObstructionSnapshot::Ptr &snapshot, const genie::Unit &data, const int unitId, const MapPos &start, const MapPos &destination) noexcept;
+
 private:
     ActionMove(MapPos destination, const UnitPtr &unit, const Task &task);
 
-    MapPos findClosestWalkableBorder(const MapPos &start, const MapPos &target, int coarseness) noexcept;
+    /// Moving units are left to the local avoidance for things further ahead, so we don't
+    /// search for a new path every time someone walks past
+    bool isPassable(const float x, const float y, const bool includeMovingUnits = true) noexcept;
+
+    /// When we end up inside something that isn't passable, moves the position to the closest
+    /// tile we can walk on (towards the destination if possible), using the region map
+    bool findWayOut(MapPos *position) const noexcept;
+
+    /// How many waypoints from the end of the path we get past, moves the position there and uses up the movement
+    size_t waypointsReached(MapPos *position, float *movement) noexcept;
+
+    /// Adjusts the velocity to go around other units close by
+    MapPos avoidUnits(const UnitPtr &unit, const MapPos &position, const MapPos &currentVelocity, const MapPos &preferredVelocity, const float maxSpeed) noexcept;
+
+    PathRequest createPathRequest(const UnitPtr &unit, const Time time) noexcept;
+    void requestPath(const UnitPtr &unit, const Time time, const bool waitForPath) noexcept;
+    void requestIntermediatePath(const UnitPtr &unit, const MapPos &start, const MapPos &target, const Time time) noexcept;
+    void requestPathRepair(const UnitPtr &unit, const Time time, const bool waitForPath) noexcept;
 
-    std::vector<MapPos> findPath(MapPos start, MapPos end, int coarseness) noexcept;
-    bool isPassable(const float x, const float y) noexcept;
+    /// Only handed to the repairs, which is when something changed along the way. The same one
+    /// is reused as long as the destination is on the same tile, so only the first one searches everything.
+    const IncrementalPath::Ptr &incrementalPathToDestination() noexcept;
 
-    void updatePath() noexcept;
+    /// If any of the tiles along the rest of the path aren't passable anymore (ignores units)
+    bool isPathBlocked(const MapPos &unitPosition) const noexcept;
+    bool applyPendingPath() noexcept;
+    bool applyFlowField(const MapPos &unitPosition) noexcept;
+
+    /// How many tiles around us we look at for somewhere to get out to, if the destination isn't passable
+    static constexpr int MaxWayOutDistance = 5;
 
     MapPtr m_map;
     MapPos m_destination;
     std::weak_ptr<Unit> m_targetUnit;
     std::vector<MapPos> m_path;
-    std::vector<float> m_terrainMoveMultipliers;
+    int m_terrainRestriction = 0;
     float m_speed;
 
     bool m_targetReached;
-    std::bitset<Constants::TILE_SIZE * Constants::TILE_SIZE * Constants::MAP_MAX_SIZE * Constants::MAP_MAX_SIZE> m_passable;
-    std::bitset<Constants::TILE_SIZE * Constants::TILE_SIZE * Constants::MAP_MAX_SIZE * Constants::MAP_MAX_SIZE> m_passableCached;
-    bool m_passableDirty = false;
 
-    std::thread m_pathfindingThread;
+    MapPos m_velocity;
+
+    /// How long we haven't gotten any closer to the next waypoint, we only look for a way around if it goes on
+    Time m_blockedTime = 0;
+
+    // Reused between updates
+    std::vector<LocalAvoidance::Neighbour> m_neighbours;
+
+    /// What think() came up with, and what it was based on
+    struct Intent {
+        Time time = 0;
+        MapPos position;
+        MapPos nextPosition;
+        MapPos previousVelocity;
+        MapPos velocity;
+    };
+    Intent m_intent;
+
+    std::future<PathResult> m_pendingPath;
+    PathRequest::Type m_pendingPathType = PathRequest::FullPath;
+    MapPos m_requestedDestination;
+
+    /// If false we keep following the old path until the new one is ready
+    bool m_waitForPath = false;
+
+    /// Search state kept around so we can just repair the path when something is built in the way
+    IncrementalPath::Ptr m_incrementalPath;
+    uint32_t m_passabilityRevision = 0;
+
+    /// Only used to get the initial path, after that we do normal searches when something is in the way
+    FlowField::Future m_flowField;
 };
 
@@ -0,0 +1,115 @@
+#include "JobSystem.h"
+
+#include "core/Logger.h"
+
+#include <algorithm>
+
+JobSystem &JobSystem::Inst()
+{
+    static JobSystem inst;
+    return inst;
+}
+
+JobSystem::JobSystem()
+{
+    // The calling thread does its share as well
+    const int threadCount = std::clamp(int(std::thread::hardware_concurrency()) - 1, 0, 7);
+    DBG << "Starting" << threadCount << "job threads";
+
+    for (int i=0; i<threadCount; i++) {
+        m_workers.emplace_back(&JobSystem::run, this);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_running = false;
+    }
+    m_batchAvailable.notify_all();
+
+    for (std::thread &worker : m_workers) {
+        worker.join();
+    }
+}
+
+void JobSystem::parallelFor(const int count, const int batchSize, const RangeJob &job) noexcept
+{
+    if (count <= 0) {
+        return;
+    }
+
+    const int rangeSize = std::max(batchSize, 1);
+    const int rangeCount = (count + rangeSize - 1) / rangeSize;
+
+    // Not worth waking anyone up
+    if (rangeCount == 1 || m_workers.empty() || m_singleThreaded) {
+        job(0, count);
+        return;
+    }
+
+    std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+    batch->job = &job;
+    batch->count = count;
+    batch->batchSize = rangeSize;
+    batch->remaining = rangeCount;
+
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_batch = batch;
+        m_batchNumber++;
+    }
+    m_batchAvailable.notify_all();
+
+    work(batch.get());
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_batchDone.wait(lock, [&]() {
+        return batch->remaining == 0;
+    });
+    m_batch.reset();
+}
+
+bool JobSystem::work(Batch *batch) noexcept
+{
+    while (true) {
+        const int begin = batch->next.fetch_add(batch->batchSize);
+        if (begin >= batch->count) {
+            return false;
+        }
+
+        (*batch->job)(begin, std::min(begin + batch->batchSize, batch->count));
+
+        if (batch->remaining.fetch_sub(1) == 1) {
+            return true;
+        }
+    }
+}
+
+void JobSystem::run() noexcept
+{
+    uint64_t lastBatchNumber = 0;
+
+    while (true) {
+        std::shared_ptr<Batch> batch;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_batchAvailable.wait(lock, [&]() {
+                return !m_running || (m_batch && m_batchNumber != lastBatchNumber);
+            });
+
+            if (!m_running) {
+                return;
+            }
+
+            batch = m_batch;
+            lastBatchNumber = m_batchNumber;
+        }
+
+        if (work(batch.get())) {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_batchDone.notify_all();
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// A handful of threads for splitting up big loops, that the calling thread helps with
+/// and waits for. Meant for things like preprocessing the whole map, where each part
+/// can be done on its own; use the PathfinderPool for things that can run in the background.
+class JobSystem
+{
+public:
+    /// Gets a range of indices to work on, from begin up to but not including end
+    typedef std::function<void(const int begin, const int end)> RangeJob;
+
+    static JobSystem &Inst();
+
+    JobSystem(const JobSystem&) = delete;
+    const JobSystem &operator=(const JobSystem&) = delete;
+
+    /// Including the calling thread
+    int threadCount() const noexcept { return m_singleThreaded ? 1 : int(m_workers.size()) + 1; }
+
+    /// Runs everything on the calling thread, for checking that the results don't depend on how the work is split up
+    void setSingleThreaded(const bool singleThreaded) noexcept { m_singleThreaded = singleThreaded; }
+
+    /// Splits 0 to count into ranges of at least batchSize and runs the job on them,
+    /// returns when all are done. Only call from one thread at a time, and not from inside a job.
+    void parallelFor(const int count, const int batchSize, const RangeJob &job) noexcept;
+
+private:
+    struct Batch {
+        const RangeJob *job = nullptr;
+        int count = 0;
+        int batchSize = 1;
+        std::atomic<int> next = 0;
+        std::atomic<int> remaining = 0;
+    };
+
+    JobSystem();
+    ~JobSystem();
+
+    /// Takes ranges until there are none left, returns true if it finished the last one
+    static bool work(Batch *batch) noexcept;
+
+    void run() noexcept;
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_batchAvailable;
+    std::condition_variable m_batchDone;
+    bool m_running = true;
+    bool m_singleThreaded = false;
+
+    // Protected by m_mutex, shared so workers waking up late don't touch a finished batch
+    std::shared_ptr<Batch> m_batch;
+    uint64_t m_batchNumber = 0;
+};
+
+#endif // JOBSYSTEM_H
@@ -0,0 +1,113 @@
+#ifndef OBJECTPOOL_H
+#define OBJECTPOOL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+/// Hands out shared_ptrs to objects that are created and destroyed all the time (missiles,
+/// smoke trails, corpses), reusing the memory of the ones that are gone instead of going
+/// back to the heap every time. The object and the shared_ptr control block are allocated
+/// together, so each one is a single block of the same size.
+/// Not thread safe, only create and let go of them on the main thread.
+template<typename T>
+class ObjectPool
+{
+public:
+    struct Stats {
+        /// Everything that has been created from the pool
+        uint64_t created = 0;
+
+        /// How many of those actually had to allocate, the rest reused memory
+        uint64_t heapAllocations = 0;
+
+        size_t alive = 0;
+        size_t peakAlive = 0;
+    };
+
+    ObjectPool() : m_blocks(std::make_shared<Blocks>()) {}
+
+    ObjectPool(const ObjectPool&) = delete;
+    const ObjectPool &operator=(const ObjectPool&) = delete;
+
+    template<typename... Args>
+    inline std::shared_ptr<T> create(Args&&... args) {
+        return std::allocate_shared<T>(Allocator<T>(m_blocks), std::forward<Args>(args)...);
+    }
+
+    const Stats &stats() const noexcept { return m_blocks->stats; }
+
+private:
+    // Kept alive by the allocators in the control blocks, so it is safe
+    // for objects to be released after the pool itself is gone
+    struct Blocks {
+        ~Blocks() {
+            for (void *block : freeBlocks) {
+                ::operator delete(block);
+            }
+        }
+
+        size_t blockSize = 0;
+        std::vector<void*> freeBlocks;
+        Stats stats;
+    };
+
+    template<typename U>
+    struct Allocator {
+        typedef U value_type;
+
+        Allocator(const std::shared_ptr<Blocks> &blocks_) noexcept : blocks(blocks_) {}
+
+        template<typename Other>
+        Allocator(const Allocator<Other> &other) noexcept : blocks(other.blocks) {}
+
+        U *allocate(const size_t count) {
+            const size_t size = count * sizeof(U);
+
+            // allocate_shared only ever asks for one of its control block type
+            if (count != 1 || (blocks->blockSize != 0 && blocks->blockSize != size)) {
+                return static_cast<U*>(::operator new(size));
+            }
+            blocks->blockSize = size;
+
+            Stats &stats = blocks->stats;
+            stats.created++;
+            stats.alive++;
+            stats.peakAlive = std::max(stats.peakAlive, stats.alive);
+
+            if (!blocks->freeBlocks.empty()) {
+                void *block = blocks->freeBlocks.back();
+                blocks->freeBlocks.pop_back();
+                return static_cast<U*>(block);
+            }
+
+            stats.heapAllocations++;
+            return static_cast<U*>(::operator new(size));
+        }
+
+        void deallocate(U *pointer, const size_t count) noexcept {
+            if (count != 1 || count * sizeof(U) != blocks->blockSize) {
+                ::operator delete(pointer);
+                return;
+            }
+
+            blocks->stats.alive--;
+            blocks->freeBlocks.push_back(pointer);
+        }
+
+        template<typename Other>
+        inline bool operator==(const Allocator<Other> &other) const noexcept { return blocks == other.blocks; }
+        template<typename Other>
+        inline bool operator!=(const Allocator<Other> &other) const noexcept { return blocks != other.blocks; }
+
+        std::shared_ptr<Blocks> blocks;
+    };
+
+    std::shared_ptr<Blocks> m_blocks;
+};
+
+#endif // OBJECTPOOL_H
@@ -0,0 +1,206 @@
+#include "TimerWheel.h"
+
+#include "core/Logger.h"
+#include "core/Utility.h"
+
+#include <algorithm>
+
+TimerHandle TimerWheel::schedule(const Time deadline, Callback callback) noexcept
+{
+    uint32_t index = None;
+    if (!m_freeTimers.empty()) {
+        index = m_freeTimers.back();
+        m_freeTimers.pop_back();
+    } else {
+        index = uint32_t(m_timers.size());
+        m_timers.emplace_back();
+    }
+
+    Timer &timer = m_timers[index];
+    timer.callback = std::move(callback);
+    timer.deadline = deadline;
+
+    insert(index);
+    m_scheduledCount++;
+
+    TimerHandle handle;
+    handle.index = index;
+    handle.generation = timer.generation;
+    return handle;
+}
+
+bool TimerWheel::cancel(const TimerHandle handle) noexcept
+{
+    if (!isScheduled(handle)) {
+        return false;
+    }
+
+    unlink(handle.index);
+    release(handle.index);
+    m_scheduledCount--;
+
+    return true;
+}
+
+bool TimerWheel::isScheduled(const TimerHandle handle) const noexcept
+{
+    if (handle.index >= m_timers.size()) {
+        return false;
+    }
+
+    const Timer &timer = m_timers[handle.index];
+    return timer.generation == handle.generation && timer.slot != None;
+}
+
+Time TimerWheel::timeLeft(const TimerHandle handle) const noexcept
+{
+    if (!isScheduled(handle)) {
+        return 0;
+    }
+
+    return std::max(m_timers[handle.index].deadline - m_now, Time(0));
+}
+
+bool TimerWheel::advanceTo(const Time time) noexcept
+{
+    // Anything that has been scheduled for now or earlier since the last time
+    bool fired = fireCurrentSlot();
+
+    while (m_now < time) {
+        if (m_scheduledCount == 0) {
+            m_now = time;
+            break;
+        }
+
+        // Nothing in the lowest level, so skip straight to where the next level needs to be looked at
+        if (m_levelCounts[0] == 0) {
+            const Time windowEnd = m_now | (SlotsPerLevel - 1);
+            if (windowEnd >= time) {
+                m_now = time;
+                break;
+            }
+            m_now = windowEnd;
+        }
+
+        m_now++;
+
+        // Highest first, so what it moves into the current slots of the lower levels gets moved on down
+        for (int level = LevelCount - 1; level > 0; level--) {
+            const Time levelMask = (Time(1) << (LevelBits * level)) - 1;
+            if ((m_now & levelMask) == 0) {
+                cascade(level);
+            }
+        }
+
+        fired = fireCurrentSlot() || fired;
+    }
+
+    return fired;
+}
+
+void TimerWheel::insert(const uint32_t index) noexcept
+{
+    Timer &timer = m_timers[index];
+
+    // Deadlines that have passed go in the current slot
+    uint64_t due = std::max(timer.deadline, m_now);
+    const uint64_t now = m_now;
+
+    int level = 0;
+    while (level < LevelCount && (due >> (LevelBits * (level + 1))) != (now >> (LevelBits * (level + 1)))) {
+        level++;
+    }
+
+    // Further away than the wheels cover, so put it as far out as they go; it gets looked at again when it cascades
+    if (IS_UNLIKELY(level == LevelCount)) {
+        level = LevelCount - 1;
+        due = now | ((uint64_t(1) << (LevelBits * LevelCount)) - 1);
+    }
+
+    const uint32_t slotIndex = level * SlotsPerLevel + ((due >> (LevelBits * level)) & (SlotsPerLevel - 1));
+    Slot &slot = m_slots[slotIndex];
+
+    timer.slot = slotIndex;
+    timer.next = None;
+    timer.previous = slot.last;
+
+    if (slot.last != None) {
+        m_timers[slot.last].next = index;
+    } else {
+        slot.first = index;
+    }
+    slot.last = index;
+
+    m_levelCounts[level]++;
+}
+
+void TimerWheel::unlink(const uint32_t index) noexcept
+{
+    Timer &timer = m_timers[index];
+    Slot &slot = m_slots[timer.slot];
+
+    if (timer.previous != None) {
+        m_timers[timer.previous].next = timer.next;
+    } else {
+        slot.first = timer.next;
+    }
+
+    if (timer.next != None) {
+        m_timers[timer.next].previous = timer.previous;
+    } else {
+        slot.last = timer.previous;
+    }
+
+    m_levelCounts[timer.slot / SlotsPerLevel]--;
+
+    timer.slot = None;
+    timer.previous = None;
+    timer.next = None;
+}
+
+void TimerWheel::release(const uint32_t index) noexcept
+{
+    Timer &timer = m_timers[index];
+    timer.callback = nullptr;
+    timer.generation++;
+
+    m_freeTimers.push_back(index);
+}
+
+void TimerWheel::cascade(const int level) noexcept
+{
+    const uint32_t slotIndex = level * SlotsPerLevel + ((uint64_t(m_now) >> (LevelBits * level)) & (SlotsPerLevel - 1));
+
+    // Take the whole list first, they might end up back in the same slot if they are further out than the wheels cover
+    uint32_t index = m_slots[slotIndex].first;
+    m_slots[slotIndex] = Slot();
+
+    while (index != None) {
+        const uint32_t next = m_timers[index].next;
+        m_levelCounts[level]--;
+        insert(index);
+        index = next;
+    }
+}
+
+bool TimerWheel::fireCurrentSlot() noexcept
+{
+    const uint32_t slotIndex = m_now & (SlotsPerLevel - 1);
+
+    bool fired = false;
+
+    // The callbacks can schedule and cancel timers, including ones due now that end up in this slot
+    while (m_slots[slotIndex].first != None) {
+        const uint32_t index = m_slots[slotIndex].first;
+        unlink(index);
+
+        Callback callback = std::move(m_timers[index].callback);
+        release(index);
+        m_scheduledCount--;
+
+        callback();
+        fired = true;
+    }
+
+    return fired;
+}
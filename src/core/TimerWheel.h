@@ -0,0 +1,110 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include "core/Types.h"
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/// The game data has times in seconds at normal speed, the game time runs 1.5 times as fast
+constexpr double GameSecondsPerMs = 0.0015;
+
+/// For scheduling things the game data gives a duration for
+inline constexpr double gameSecondsToMs(const double seconds) noexcept { return seconds / GameSecondsPerMs; }
+inline constexpr double msToGameSeconds(const Time time) noexcept { return time * GameSecondsPerMs; }
+
+/// Refers to a scheduled timer, stops being scheduled when it has fired or been cancelled.
+/// Timers are reused, so the generation is what tells an old handle apart from the new timer.
+struct TimerHandle
+{
+    static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+    uint32_t index = InvalidIndex;
+    uint32_t generation = 0;
+
+    inline bool isValid() const noexcept { return index != InvalidIndex; }
+};
+
+/// Calls things when the game time reaches their deadline, so things that wait for
+/// something don't all have to check how much time has passed every tick.
+/// The timers are kept in slots by deadline in a few levels of wheels, each level
+/// covering 256 times as long as the one below, and are moved down a level as their time
+/// gets closer. So scheduling and cancelling doesn't depend on how many timers there are.
+/// Resolution is a millisecond, timers due at the same time fire in the order they were scheduled.
+/// Not thread safe.
+class TimerWheel
+{
+public:
+    typedef std::function<void()> Callback;
+
+    /// Deadlines that have already passed fire on the next advance
+    TimerHandle schedule(const Time deadline, Callback callback) noexcept;
+    inline TimerHandle scheduleIn(const Time delay, Callback callback) noexcept {
+        return schedule(m_now + delay, std::move(callback));
+    }
+
+    /// Returns false if it has already fired or been cancelled
+    bool cancel(const TimerHandle handle) noexcept;
+
+    bool isScheduled(const TimerHandle handle) const noexcept;
+
+    /// 0 if it isn't scheduled
+    Time timeLeft(const TimerHandle handle) const noexcept;
+
+    /// Fires everything that is due up to and including this time, also timers scheduled by the
+    /// callbacks if they are due. Returns true if anything fired.
+    bool advanceTo(const Time time) noexcept;
+
+    /// The time it has been advanced to
+    Time now() const noexcept { return m_now; }
+
+    size_t scheduledCount() const noexcept { return m_scheduledCount; }
+
+private:
+    static constexpr int LevelBits = 8;
+    static constexpr int SlotsPerLevel = 1 << LevelBits;
+    static constexpr int LevelCount = 4;
+
+    static constexpr uint32_t None = UINT32_MAX;
+
+    struct Timer {
+        Callback callback;
+        Time deadline = 0;
+        uint32_t generation = 0;
+
+        // In the slot, or in the free list
+        uint32_t previous = None;
+        uint32_t next = None;
+
+        // None when not scheduled
+        uint32_t slot = None;
+    };
+
+    struct Slot {
+        uint32_t first = None;
+        uint32_t last = None;
+    };
+
+    /// Appends it to the slot for its deadline
+    void insert(const uint32_t index) noexcept;
+    void unlink(const uint32_t index) noexcept;
+    void release(const uint32_t index) noexcept;
+
+    /// Moves the timers in the current slot of the level down to where they belong now
+    void cascade(const int level) noexcept;
+
+    bool fireCurrentSlot() noexcept;
+
+    std::vector<Timer> m_timers;
+    std::vector<uint32_t> m_freeTimers;
+
+    std::array<Slot, SlotsPerLevel * LevelCount> m_slots;
+    std::array<size_t, LevelCount> m_levelCounts {};
+    size_t m_scheduledCount = 0;
+
+    Time m_now = 0;
+};
+
+#endif // TIMERWHEEL_H
@@ -94,6 +94,36 @@ inline std::vector<std::string> stringSplit(const std::string &string, const cha
     return ret;
 }
 
+/// Escapes quotes, backslashes and control characters so it can go inside a JSON string
+inline std::string jsonEscape(const std::string &string)
+{
+    static const char hexDigits[] = "0123456789abcdef";
+
+    std::string ret;
+    ret.reserve(string.size());
+    for (const char c : string) {
+        switch(c) {
+        case '"': ret += "\\\""; break;
+        case '\\': ret += "\\\\"; break;
+        case '\b': ret += "\\b"; break;
+        case '\f': ret += "\\f"; break;
+        case '\n': ret += "\\n"; break;
+        case '\r': ret += "\\r"; break;
+        case '\t': ret += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                ret += "\\u00";
+                ret += hexDigits[(c >> 4) & 0xf];
+                ret += hexDigits[c & 0xf];
+            } else {
+                ret += c;
+            }
+            break;
+        }
+    }
+    return ret;
+}
+
 // STL is a garbage fire and shitshow
 // I blame boost
 inline float hypot(const float a, const float b)
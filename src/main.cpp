@@ -17,6 +17,7 @@
 */
 
 #include <genie/script/ScnFile.h>
+#include <stdlib.h>
 #include <string.h>
 #include <filesystem>
 #include <memory>
@@ -48,7 +49,8 @@ int main(int argc, char **argv) try
             {"game-path", "Path to AoE installation with data files", Config::Stored },
             {"scenario-file", "Path to scenario file to load", Config::NotStored },
             {"single-player", "Launch a simple test map", Config::NotStored },
-            {"game-sample", "Game samples to load", Config::NotStored }
+            {"game-sample", "Game samples to load", Config::NotStored },
+            {"tick-rate", "Game updates per second, 30 by default", Config::Stored }
             });
     if (!config.parseOptions(argc, argv)) {
         return 1;
@@ -186,6 +188,9 @@ int main(int argc, char **argv) try
     }
 
     Engine en;
+    if (!config.getValue("tick-rate").empty()) {
+        en.setTickRate(atoi(config.getValue("tick-rate").c_str()));
+    }
     if (!en.setup(scenarioFile)) {
         return 1;
     }
@@ -17,6 +17,7 @@
 #include "audio/AudioPlayer.h"
 #include "core/Constants.h"
 #include "core/Logger.h"
+#include "core/Utility.h"
 #include "mechanics/Civilization.h"
 #include "mechanics/UnitManager.h"
 #include "resource/DataManager.h"
@@ -63,6 +64,7 @@ bool Building::enqueueProduceUnit(const genie::Unit *data) noexcept
     }
 
     m_productionQueue.push_back(std::move(product));
+    wakeUp();
 
     if (!m_currentProduct) {
         attemptStartProduction();
@@ -112,6 +114,7 @@ bool Building::enqueueProduceResearch(const genie::Tech *data) noexcept
     }
 
     m_productionQueue.push_back(std::move(product));
+    wakeUp();
 
     if (!m_currentProduct) {
         attemptStartProduction();
@@ -124,6 +127,7 @@ void Building::abortProduction(size_t index) noexcept
 {
     if (m_currentProduct) {
         if (index == 0) {
+            m_unitManager.timers().cancel(m_productionTimer);
             m_currentProduct.reset();
             return;
 
@@ -157,14 +161,8 @@ float Building::productionProgress() const noexcept
         return 0;
     }
 
-    float maximum = 0;
-    if (m_currentProduct->type == Product::Unit) {
-        maximum = m_currentProduct->unit->Creatable.TrainTime;
-    } else {
-        maximum = m_currentProduct->tech->ResearchTime;
-    }
-
-    return std::min(m_productionProgress / maximum, 1.f);
+    const float elapsed = msToGameSeconds(m_unitManager.timers().now() - m_productionStartTime);
+    return std::min(elapsed / currentProductionTime(), 1.f);
 }
 
 int Building::productIcon(size_t index) noexcept
@@ -218,31 +216,10 @@ std::string Building::currentProductName() noexcept
 
 bool Building::update(Time time) noexcept
 {
-    const Time deltaTime = time - m_lastUpdateTime;
-    m_lastUpdateTime = time;
-
     bool updated = Unit::update(time);
 
     if (m_currentProduct) {
-        float productionTime = 0;
-        if (m_currentProduct->type == Product::Unit) {
-            productionTime = m_currentProduct->unit->Creatable.TrainTime;
-        } else {
-            productionTime = m_currentProduct->tech->ResearchTime;
-        }
-
-        m_productionProgress += deltaTime * 0.0015;
-        if (m_productionProgress >= productionTime) {
-            if (m_currentProduct->type == Product::Unit) {
-                finalizeUnit();
-            } else {
-                finalizeResearch();
-            }
-
-            m_currentProduct.reset();
-            m_productionProgress = 0;
-        }
-
+        // The progress shown changes, the timer takes care of finishing it
         updated = true;
     } else if (!m_productionQueue.empty()) {
         attemptStartProduction();
@@ -252,6 +229,11 @@ bool Building::update(Time time) noexcept
     return updated;
 }
 
+bool Building::needsUpdate() const noexcept
+{
+    return m_currentProduct || !m_productionQueue.empty() || Unit::needsUpdate();
+}
+
 void Building::setPosition(const MapPos &pos, const bool initial) noexcept
 {
     Unit::setPosition(Unit::snapPositionToGrid(pos, m_map.lock(), data()), initial);
@@ -379,7 +361,46 @@ void Building::attemptStartProduction() noexcept
         }
     }
 
-    m_productionProgress = 0.f;
     m_currentProduct = std::move(m_productionQueue.front());
     m_productionQueue.erase(m_productionQueue.begin());
+
+    TimerWheel &timers = m_unitManager.timers();
+    m_productionStartTime = timers.now();
+
+    std::weak_ptr<Entity> weakThis = weak_from_this();
+    m_productionTimer = timers.scheduleIn(gameSecondsToMs(currentProductionTime()), [weakThis]() {
+        std::shared_ptr<Entity> entity = weakThis.lock();
+        if (entity) {
+            static_cast<Building*>(entity.get())->onProductionFinished();
+        }
+    });
+}
+
+void Building::onProductionFinished() noexcept
+{
+    if (IS_UNLIKELY(!m_currentProduct)) {
+        WARN << "production finished without a product";
+        return;
+    }
+
+    if (m_currentProduct->type == Product::Unit) {
+        finalizeUnit();
+    } else {
+        finalizeResearch();
+    }
+    m_currentProduct.reset();
+
+    attemptStartProduction();
+
+    // In case it couldn't start the next one yet
+    wakeUp();
+}
+
+float Building::currentProductionTime() const noexcept
+{
+    if (m_currentProduct->type == Product::Unit) {
+        return m_currentProduct->unit->Creatable.TrainTime;
+    } else {
+        return m_currentProduct->tech->ResearchTime;
+    }
 }
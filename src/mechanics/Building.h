@@ -9,6 +9,7 @@
 #include "Entity.h"
 #include "Unit.h"
 #include "core/ResourceMap.h"
+#include "core/TimerWheel.h"
 #include "core/Types.h"
 
 class UnitManager;
@@ -40,6 +41,7 @@ struct Building : public Unit
     float productionProgress() const noexcept;
 
     bool update(Time time) noexcept override;
+    bool needsUpdate() const noexcept override;
 
     void setPosition(const MapPos &pos, const bool initial = false) noexcept override;
 
@@ -51,6 +53,10 @@ private:
     void finalizeUnit() noexcept;
     void finalizeResearch() noexcept;
     void attemptStartProduction() noexcept;
+    void onProductionFinished() noexcept;
+
+    /// In game seconds
+    float currentProductionTime() const noexcept;
 
     struct Product {
         enum {
@@ -67,11 +73,11 @@ private:
     };
 
     std::vector<std::unique_ptr<Product>> m_productionQueue;
-    float m_productionProgress = 0.f;
 
     std::unique_ptr<Product> m_currentProduct;
+    Time m_productionStartTime = 0;
+    TimerHandle m_productionTimer;
 
-    Time m_lastUpdateTime = 0;
 };
 
 #endif // BUILDING_H
@@ -25,12 +25,13 @@
 #include "render/GraphicRender.h"
 
 #include <stddef.h>
-#include <cmath>
 #include <memory>
 #include <string>
 
 static size_t s_entityCount = 0;
 
+uint64_t Entity::s_simulationTick = 1;
+
 Entity::Entity(const Entity::Type type_, const std::string &name) :
     id(s_entityCount++),
     debugName(name + " #" + std::to_string(id)),
@@ -44,9 +45,7 @@ Entity::~Entity()
     MapPtr map = m_map.lock();
 
     if (map) {
-        int tileX = m_position.x / Constants::TILE_SIZE;
-        int tileY = m_position.y / Constants::TILE_SIZE;
-        map->removeEntityAt(tileX, tileY, id);
+        map->removeEntity(this);
     }
 }
 
@@ -79,12 +78,12 @@ void Entity::setMap(const MapPtr &newMap) noexcept
 
     MapPtr oldMap = m_map.lock();
     if (oldMap) {
-        oldMap->removeEntityAt(tileX, tileY, id);
+        oldMap->removeEntity(this);
     }
 
     m_map = newMap;
     if (newMap) {
-        newMap->addEntityAt(tileX, tileY, shared_from_this());
+        newMap->addEntityAt(tileX, tileY, this);
     }
 }
 
@@ -100,6 +99,14 @@ void Entity::setPosition(const MapPos &pos, const bool initial) noexcept
     const int newTileX = pos.x / Constants::TILE_SIZE;
     const int newTileY = pos.y / Constants::TILE_SIZE;
 
+    // Don't draw it sliding in from wherever it was before it was placed
+    if (initial || m_movedInTick == 0) {
+        m_previousPosition = pos;
+    } else if (m_movedInTick != s_simulationTick) {
+        m_previousPosition = m_position;
+    }
+    m_movedInTick = s_simulationTick;
+
     m_position = pos;
 
     if (!isUnit() && !isMissile() && !isDecayingEntity()) {
@@ -114,10 +121,22 @@ void Entity::setPosition(const MapPos &pos, const bool initial) noexcept
     if (!map) {
         return;
     }
-    if (!initial) {
-        map->removeEntityAt(oldTileX, oldTileY, id);
+    // Moves it if it is already on the map
+    map->addEntityAt(newTileX, newTileY, this);
+}
+
+MapPos Entity::renderPosition(const float interpolation) const noexcept
+{
+    // Hasn't moved since the last tick
+    if (m_movedInTick != s_simulationTick) {
+        return m_position;
     }
-    map->addEntityAt(newTileX, newTileY, shared_from_this());
+
+    MapPos position = m_position;
+    position -= m_previousPosition;
+    position *= interpolation;
+    position += m_previousPosition;
+    return position;
 }
 
 MoveTargetMarker::MoveTargetMarker() :
@@ -152,7 +171,8 @@ bool MoveTargetMarker::update(Time time) noexcept
 
 DecayingEntity::DecayingEntity(const int graphicId, float decayTime) :
     Entity(Type::Decaying, "Eye Candy Things"),
-    m_decayTimeLeft(decayTime)
+    m_decayTime(decayTime),
+    m_decayTimeEnded(decayTime <= 0)
 {
     m_renderer->setGraphic(graphicId);
 }
@@ -163,15 +183,10 @@ bool DecayingEntity::update(Time time) noexcept
         return false;
     }
 
-    if (!std::isinf(m_decayTimeLeft)) {
-        m_decayTimeLeft -= (time - m_prevTime) * 0.0015;
-        m_prevTime = time;
-    }
-
     return Entity::update(time);
 }
 
 bool DecayingEntity::decaying() const noexcept
 {
-    return m_decayTimeLeft > 0 || m_renderer->currentFrame() < m_renderer->frameCount() - 1;
+    return !m_decayTimeEnded || m_renderer->currentFrame() < m_renderer->frameCount() - 1;
 }
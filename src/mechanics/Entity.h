@@ -65,6 +65,12 @@ struct Entity : std::enable_shared_from_this<Entity>, SignalEmitter<Entity>
     inline const MapPos &position() const noexcept { return m_position; }
     virtual void setPosition(const MapPos &pos, const bool initial = false) noexcept;
 
+    /// Where to draw it, between where it was before the last simulation tick (at 0) and where it is now (at 1)
+    MapPos renderPosition(const float interpolation) const noexcept;
+
+    /// Called when a simulation tick starts, so entities know which tick they moved in
+    static void beginSimulationTick() noexcept { s_simulationTick++; }
+
     inline bool isUnit() const noexcept { return m_type >= Type::Unit; }
     inline bool isBuilding() const noexcept { return m_type >= Type::Building; }
     inline bool isMissile() const noexcept { return m_type == Type::Missile; }
@@ -92,6 +98,15 @@ private:
 
     friend struct MoveTargetMarker;
     MapPos m_position;
+
+    // Where it was when the tick it last moved in started, 0 if it hasn't been placed yet
+    MapPos m_previousPosition;
+    uint64_t m_movedInTick = 0;
+    static uint64_t s_simulationTick;
+
+    // Where we are in the spatial index of the map
+    friend class Map;
+    int32_t m_mapSlot = -1;
 };
 
 
@@ -121,7 +136,11 @@ struct DecayingEntity : public Entity
 
     bool decaying() const noexcept;
 
+    /// In game seconds, the UnitManager counts it down when it is added
+    float decayTime() const noexcept { return m_decayTime; }
+    void setDecayTimeEnded() noexcept { m_decayTimeEnded = true; }
+
 private:
-    float m_decayTimeLeft = 0.f;
-    Time m_prevTime = 0;
+    const float m_decayTime = 0.f;
+    bool m_decayTimeEnded = false;
 };
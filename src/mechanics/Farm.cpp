@@ -66,6 +66,11 @@ bool Farm::update(Time time) noexcept
     return updated;
 }
 
+bool Farm::needsUpdate() const noexcept
+{
+    return m_updated || Building::needsUpdate();
+}
+
 ScreenRect Farm::rect() const noexcept
 {
     ScreenRect rect;
@@ -105,6 +110,7 @@ void Farm::setTerrain(const Farm::TerrainTypes terrainToSet) noexcept
 
     m_currentTerrain = terrainToSet;
     m_updated = true;
+    wakeUp();
 }
 
 FarmRender::FarmRender(const Size &size) :
@@ -126,7 +132,7 @@ FarmRender::FarmRender(const Size &size) :
     m_unavailableTexture.loadFromImage(Graphic::slpFrameToImage(frame, 0, ImageType::ConstructionUnavailable));
 }
 
-void FarmRender::render(sf::RenderTarget &renderTarget, const ScreenPos screenPos, const RenderType pass) noexcept
+void FarmRender::render(sf::RenderTarget &renderTarget, const ScreenPos screenPos, const RenderType pass, const Time /*time*/) noexcept
 {
     sf::Sprite sprite;
     if (pass == RenderType::ConstructAvailable) {
@@ -21,7 +21,7 @@ class FarmRender : public GraphicRender
 public:
     FarmRender(const Size &size);
 
-    void render(sf::RenderTarget &renderTarget, const ScreenPos screenPos, const RenderType pass) noexcept override;
+    void render(sf::RenderTarget &renderTarget, const ScreenPos screenPos, const RenderType pass, const Time time) noexcept override;
 
 private:
     sf::Texture m_availableTexture;
@@ -45,6 +45,7 @@ public:
     Farm(const genie::Unit &data_, const std::shared_ptr<Player> &player, UnitManager &unitManager);
     void setCreationProgress(float progress) noexcept override;
     bool update(Time time) noexcept override;
+    bool needsUpdate() const noexcept override;
 
     GraphicRender &renderer() noexcept override { return m_farmRenderer; }
     ScreenRect rect() const noexcept override;
@@ -139,6 +139,9 @@ bool GameState::init()
 
     map_->updateMapData();
 
+    // Everything that happens during a tick is signalled at the end of it
+    map_->setDeferSignals(true);
+
     return true;
 }
 
@@ -151,6 +154,10 @@ bool GameState::update(Time time)
         updated = m_scenarioController->update(time) || updated;
     }
 
+    if (map_) {
+        map_->flushSignals();
+    }
+
     //game_server_->update();
     //game_client_->update();
 
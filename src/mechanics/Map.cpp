@@ -28,6 +28,7 @@
 #include <unordered_set>
 
 #include "core/Constants.h"
+#include "core/JobSystem.h"
 #include "core/Logger.h"
 #include "core/Types.h"
 #include "core/Utility.h"
@@ -36,6 +37,9 @@
 
 #include <genie/script/scn/MapDescription.h>
 
+// Small enough to spread even small maps over a few threads
+static const int ROWS_PER_JOB = 8;
+
 Map::Map() //: map_txt_(0)
 {
 //    DBG << DataManager::Inst().datFile().TerrainBlock.TileSizes.size();
@@ -63,7 +67,7 @@ void Map::setupBasic() noexcept
 
     const size_t tileCount = cols_ * rows_;
     tiles_.resize(tileCount, grass);
-    m_tileUnits.resize(tileCount);
+    resizeEntityIndex(tileCount);
 
     for (int i=6; i<10; i++) {
         getTileAt(0, i).terrainId = 2;
@@ -87,6 +91,9 @@ void Map::setupBasic() noexcept
     getTileAt(13, 4).terrainId = 2;
     getTileAt(17, 4).elevation = 1;
     getTileAt(18, 5).elevation = 1;
+
+    resetPassability();
+    resetTileHeights();
 }
 
 void Map::setupAllunitsMap() noexcept
@@ -102,7 +109,7 @@ void Map::setupAllunitsMap() noexcept
 
     const size_t tileCount = cols_ * rows_;
     tiles_.resize(tileCount, water);
-    m_tileUnits.resize(tileCount);
+    resizeEntityIndex(tileCount);
 
     // add some grass
     for (int i = 0; i < 20; i++) {
@@ -142,6 +149,9 @@ void Map::setupAllunitsMap() noexcept
     elevate(5, 5, 10, 5);
     elevate(5, 17, 10, 5);
     elevate(5, 14, 1, 1);
+
+    resetPassability();
+    resetTileHeights();
 }
 
 void Map::create(const genie::ScnMap &mapDescription) noexcept
@@ -155,7 +165,7 @@ void Map::create(const genie::ScnMap &mapDescription) noexcept
 
     const size_t tileCount = cols_ * rows_;
     tiles_.resize(tileCount);
-    m_tileUnits.resize(tileCount);
+    resizeEntityIndex(tileCount);
 
     for (size_t i = 0; i < tiles_.size(); i++) {
         const int col = i % cols_;
@@ -165,62 +175,87 @@ void Map::create(const genie::ScnMap &mapDescription) noexcept
         getTileAt(row, col).elevation = tile.elevation;
         getTileAt(row, col).terrainId = tile.terrainID;
     }
+
+    resetPassability();
+    resetTileHeights();
 }
 
-float Map::elevationAt(const MapPos &position) noexcept
+void Map::elevationsAt(const MapPos *positions, const size_t count, float *elevations) const noexcept
 {
-    const int tileX = position.x / Constants::TILE_SIZE;
-    const int tileY = position.y / Constants::TILE_SIZE;
-    const MapTile &tile = getTileAt(tileX, tileY);
-    const float localX = position.x / Constants::TILE_SIZE - tileX;
-    const float localY = position.y / Constants::TILE_SIZE - tileY;
-
-    float elevation = tile.elevation;
+    for (size_t i = 0; i < count; i++) {
+        elevations[i] = elevationAt(positions[i]);
+    }
+}
 
-    switch(tile.slopes.self) {
+// How much higher than the tile elevation the slope makes it at the position on the tile
+static float slopeOffset(const Slope slope, const float localX, const float localY) noexcept
+{
+    switch(slope) {
     case Slope::NorthWestUp:
-        elevation += 1. - localX;
-        break;
+        return 1. - localX;
     case Slope::SouthEastUp:
-        elevation += localX;
-        break;
+        return localX;
     case Slope::SouthWestUp:
-        elevation += 1. - localY;
-        break;
+        return 1. - localY;
     case Slope::NorthEastUp:
-        elevation += localY;
-        break;
+        return localY;
     case Slope::EastUp:
-        elevation += localX * localY;
-        break;
+        return localX * localY;
     case Slope::WestUp:
-        elevation += (1. - localX) * (1. - localY);
-        break;
+        return (1. - localX) * (1. - localY);
     case Slope::NorthUp:
-        elevation += (1. - localX) * localY;
-        break;
+        return (1. - localX) * localY;
     case Slope::SouthUp:
-        elevation += localX * (1. - localY);
-        break;
+        return localX * (1. - localY);
     case Slope::NorthWestEastUp:
-        elevation += 1. - localX * (1. - localY);
-        break;
+        return 1. - localX * (1. - localY);
     case Slope::SouthWestEastUp:
-        elevation += 1. - (1. - localX) * localY;
-        break;
+        return 1. - (1. - localX) * localY;
     case Slope::NorthSouthEastUp:
-        elevation += 1. - (1. - localX) * (1. - localY);
-        break;
+        return 1. - (1. - localX) * (1. - localY);
     case Slope::NorthSouthWestUp:
-        elevation += 1. - localX * localY;
-        break;
+        return 1. - localX * localY;
     case Slope::Flat:
-        break;
+        return 0;
     default:
-        WARN << "Unhanhdled slope" << tile.slopes.self;
-        break;
+        WARN << "Unhanhdled slope" << slope;
+        return 0;
+    }
+}
+
+void Map::resetTileHeights() noexcept
+{
+    m_elevationHeight = DataManager::Inst().terrainBlock().ElevHeight;
+    m_tileHeights.assign(tiles_.size(), TileHeight());
+
+    for (int row = 0; row < rows_; row++) {
+        for (int col = 0; col < cols_; col++) {
+            updateTileHeight(col, row);
+        }
     }
-    return elevation * DataManager::Inst().terrainBlock().ElevHeight;
+}
+
+void Map::updateTileHeight(const int col, const int row) noexcept
+{
+    const unsigned int index = row * cols_ + col;
+    if (IS_UNLIKELY(index >= m_tileHeights.size())) {
+        return;
+    }
+
+    const MapTile &tile = tiles_[index];
+
+    // Only need the corners, the rest is interpolated
+    const float elevation = tile.elevation;
+    const float topLeft = elevation + slopeOffset(tile.slopes.self, 0, 0);
+    const float topRight = elevation + slopeOffset(tile.slopes.self, 1, 0);
+    const float bottomLeft = elevation + slopeOffset(tile.slopes.self, 0, 1);
+    const float bottomRight = elevation + slopeOffset(tile.slopes.self, 1, 1);
+
+    TileHeight &height = m_tileHeights[index];
+    height.base = topLeft * m_elevationHeight;
+    height.x = (topRight - topLeft) * m_elevationHeight;
+    height.y = (bottomLeft - topLeft) * m_elevationHeight;
+    height.xy = (bottomRight - topRight - bottomLeft + topLeft) * m_elevationHeight;
 }
 
 
@@ -235,6 +270,7 @@ void Map::setTileAt(unsigned col, unsigned row, unsigned id) noexcept
     }
 
     tiles_[index].terrainId = id;
+    m_passability.setTerrain(col, row, id);
     m_updated = true;
 }
 
@@ -248,6 +284,7 @@ void Map::updateTileAt(const int col, const int row, unsigned id) noexcept
     }
 
     tiles_[index].terrainId = id;
+    m_passability.setTerrain(col, row, id);
     tiles_[index].frame = AssetManager::Inst()->getTerrain(tiles_[index].terrainId)->coordinatesToFrame(col, row);
     for (int col_ = std::max(col - 1, 0); col_ < std::min(col + 2, cols_); col_++) {
         for (int row_ = std::max(row - 1, 0); row_ < std::min(row + 2, rows_); row_++) {
@@ -258,6 +295,7 @@ void Map::updateTileAt(const int col, const int row, unsigned id) noexcept
     for (int col_ = std::max(col - 1, 0); col_ < std::min(col + 2, cols_); col_++) {
         for (int row_ = std::max(row - 1, 0); row_ < std::min(row + 2, rows_); row_++) {
             updateTileBlend(col_, row_);
+            updateTileHeight(col_, row_);
         }
     }
     for (int col_ = std::max(col - 1, 0); col_ < std::min(col + 2, cols_); col_++) {
@@ -267,62 +305,165 @@ void Map::updateTileAt(const int col, const int row, unsigned id) noexcept
     }
 
     m_updated = true;
+    markTerrainChanged(std::max(col - 1, 0), std::max(row - 1, 0), std::min(col + 1, cols_ - 1), std::min(row + 1, rows_ - 1));
 }
 
-void Map::removeEntityAt(unsigned int col, unsigned int row, const int entityId) noexcept
+bool Map::matches(const Entity &entity, const EntityFilter &filter) noexcept
 {
-    unsigned int index = row * cols_ + col;
+    switch(filter.kind) {
+    case EntityFilter::Kind::Any:
+        break;
+    case EntityFilter::Kind::Unit:
+        if (!entity.isUnit()) {
+            return false;
+        }
+        break;
+    case EntityFilter::Kind::Building:
+        if (!entity.isBuilding()) {
+            return false;
+        }
+        break;
+    case EntityFilter::Kind::Missile:
+        if (!entity.isMissile()) {
+            return false;
+        }
+        break;
+    case EntityFilter::Kind::Decaying:
+        if (!entity.isDecayingEntity()) {
+            return false;
+        }
+        break;
+    }
 
-    if (IS_UNLIKELY(index >= m_tileUnits.size())) {
-        WARN << "Trying to remove unit out of range" << col << row;
-        return;
+    if (filter.playerId == EntityFilter::AnyPlayer && filter.ignoredPlayerId == EntityFilter::AnyPlayer) {
+        return true;
     }
 
-    std::vector<std::weak_ptr<Entity>>::iterator it=m_tileUnits[index].begin();
-    while (it != m_tileUnits[index].end()) {
-        if (it->expired()) {
-            it = m_tileUnits[index].erase(it);
-            continue;
-        }
-        EntityPtr entity = it->lock();
-        if (!entity) {
-            it = m_tileUnits[index].erase(it);
-            continue;
-        }
+    // Only units have owners we care about
+    if (!entity.isUnit()) {
+        return false;
+    }
 
-        if (entity->id == entityId) {
-            m_tileUnits[index].erase(it);
+    const int owner = static_cast<const Unit&>(entity).playerId;
+    if (filter.playerId != EntityFilter::AnyPlayer && owner != filter.playerId) {
+        return false;
+    }
+    if (filter.ignoredPlayerId != EntityFilter::AnyPlayer && owner == filter.ignoredPlayerId) {
+        return false;
+    }
 
-            emit(Signals::UnitsChanged);
+    return true;
+}
 
-            return;
+void Map::resizeEntityIndex(const size_t tileCount) noexcept
+{
+    for (size_t slot = 0; slot < m_entitySlots.size(); slot++) {
+        if (m_entitySlots[slot].tile >= int32_t(tileCount)) {
+            unlinkEntitySlot(slot);
         }
+    }
 
-        it++;
+    m_tileFirstSlot.resize(tileCount, NoSlot);
+}
+
+void Map::unlinkEntitySlot(const int32_t slot) noexcept
+{
+    EntitySlot &entitySlot = m_entitySlots[slot];
+    if (entitySlot.tile < 0) {
+        return;
+    }
+
+    if (entitySlot.previous != NoSlot) {
+        m_entitySlots[entitySlot.previous].next = entitySlot.next;
+    } else {
+        m_tileFirstSlot[entitySlot.tile] = entitySlot.next;
+    }
+    if (entitySlot.next != NoSlot) {
+        m_entitySlots[entitySlot.next].previous = entitySlot.previous;
     }
+
+    entitySlot.tile = -1;
+    entitySlot.next = NoSlot;
+    entitySlot.previous = NoSlot;
 }
 
-void Map::addEntityAt(int col, int row, const EntityPtr &entity) noexcept
+void Map::removeEntity(Entity *entity) noexcept
 {
-    unsigned int index = row * cols_ + col;
+    const int32_t slot = entity->m_mapSlot;
+    if (slot == NoSlot) {
+        return;
+    }
+    if (IS_UNLIKELY(slot >= int32_t(m_entitySlots.size()) || m_entitySlots[slot].entity != entity)) {
+        WARN << "Entity has an invalid slot" << entity->debugName;
+        entity->m_mapSlot = NoSlot;
+        return;
+    }
+
+    const int32_t tile = m_entitySlots[slot].tile;
+    unlinkEntitySlot(slot);
+    m_entitySlots[slot].entity = nullptr;
+    m_freeEntitySlots.push_back(slot);
+    entity->m_mapSlot = NoSlot;
+
+    if (tile >= 0) {
+        updateObstruction(tile % cols_, tile / cols_);
+        markUnitsChanged(tile % cols_, tile / cols_);
+    }
+}
 
-    if (IS_UNLIKELY(index >= m_tileUnits.size())) {
+void Map::addEntityAt(int col, int row, Entity *entity) noexcept
+{
+    if (IS_UNLIKELY(col < 0 || row < 0 || col >= cols_ || row >= rows_)) {
         WARN << "Trying to add unit out of range" << col << row;
+        removeEntity(entity);
         return;
     }
 
-    // just to be sure
-    removeEntityAt(col, row, entity->id);
+    const int32_t tile = row * cols_ + col;
+
+    int32_t slot = entity->m_mapSlot;
+    if (slot == NoSlot) {
+        if (!m_freeEntitySlots.empty()) {
+            slot = m_freeEntitySlots.back();
+            m_freeEntitySlots.pop_back();
+        } else {
+            slot = m_entitySlots.size();
+            m_entitySlots.emplace_back();
+        }
+        m_entitySlots[slot].entity = entity;
+        entity->m_mapSlot = slot;
+    }
+
+    const int32_t oldTile = m_entitySlots[slot].tile;
+    if (oldTile == tile) {
+        return;
+    }
 
-    m_tileUnits[index].push_back(entity);
+    unlinkEntitySlot(slot);
+    if (oldTile >= 0) {
+        updateObstruction(oldTile % cols_, oldTile / cols_);
 
-    emit(Signals::UnitsChanged);
+        // Signalled together with the new tile below
+        m_changedUnits.add(oldTile % cols_, oldTile / cols_);
+    }
+
+    EntitySlot &entitySlot = m_entitySlots[slot];
+    entitySlot.tile = tile;
+    entitySlot.previous = NoSlot;
+    entitySlot.next = m_tileFirstSlot[tile];
+    if (entitySlot.next != NoSlot) {
+        m_entitySlots[entitySlot.next].previous = slot;
+    }
+    m_tileFirstSlot[tile] = slot;
+
+    updateObstruction(col, row);
+    markUnitsChanged(col, row);
 
     if (!entity->isUnit()) {
         return;
     }
 
-    Unit::Ptr unit = Unit::fromEntity(entity);
+    const Unit *unit = static_cast<const Unit*>(entity);
     const int newTerrain = unit->data()->Building.FoundationTerrainID;
 
     if (newTerrain < 0) {
@@ -350,33 +491,157 @@ void Map::addEntityAt(int col, int row, const EntityPtr &entity) noexcept
 
 
 
-void Map::updateMapData() noexcept
+void Map::updateMapData(const bool parallel) noexcept
 {
     TIME_THIS;
 
-    for (int col = 0; col < cols_; col++) {
-        for (int row = 0; row < rows_; row++) {
-            MapTile &tile = tiles_[row * cols_ + col];
-            tile.reset();
-            tile.frame = AssetManager::Inst()->getTerrain(tile.terrainId)->coordinatesToFrame(col, row);
+    m_elevationHeight = DataManager::Inst().terrainBlock().ElevHeight;
+    m_tileHeights.resize(tiles_.size());
+
+    if (!parallel) {
+        for (int col = 0; col < cols_; col++) {
+            for (int row = 0; row < rows_; row++) {
+                MapTile &tile = tiles_[row * cols_ + col];
+                tile.reset();
+                tile.frame = AssetManager::Inst()->getTerrain(tile.terrainId)->coordinatesToFrame(col, row);
+            }
+        }
+
+        for (int col = 0; col < cols_; col++) {
+            for (int row = 0; row < rows_; row++) {
+                updateTileBlend(col, row);
+                updateTileHeight(col, row);
+            }
         }
+
+        TIME_TICK;
+        for (int col = 0; col < cols_; col++) {
+            for (int row = 0; row < rows_; row++) {
+                updateTileSlopes(col, row);
+            }
+        }
+    } else {
+        // The terrain sprites are created the first time they're asked for, which can't happen from several threads
+        std::vector<bool> terrainLoaded;
+        for (const MapTile &tile : tiles_) {
+            if (tile.terrainId >= terrainLoaded.size()) {
+                terrainLoaded.resize(tile.terrainId + 1);
+            }
+            if (!terrainLoaded[tile.terrainId]) {
+                AssetManager::Inst()->getTerrain(tile.terrainId);
+                terrainLoaded[tile.terrainId] = true;
+            }
+        }
+
+        // Blending only looks at the elevation and terrain of the neighbors, so it can be done right after resetting
+        JobSystem::Inst().parallelFor(rows_, ROWS_PER_JOB, [this](const int firstRow, const int lastRow) {
+            for (int row = firstRow; row < lastRow; row++) {
+                for (int col = 0; col < cols_; col++) {
+                    MapTile &tile = tiles_[row * cols_ + col];
+                    tile.reset();
+                    tile.frame = AssetManager::Inst()->getTerrain(tile.terrainId)->coordinatesToFrame(col, row);
+                    updateTileBlend(col, row);
+                    updateTileHeight(col, row);
+                }
+            }
+        });
+
+        TIME_TICK;
+
+        // Needs the slopes of all the neighbors from the blending
+        JobSystem::Inst().parallelFor(rows_, ROWS_PER_JOB, [this](const int firstRow, const int lastRow) {
+            for (int row = firstRow; row < lastRow; row++) {
+                for (int col = 0; col < cols_; col++) {
+                    updateTileSlopes(col, row);
+                }
+            }
+        });
+    }
+
+    m_updated = true;
+
+    markTerrainChanged(0, 0, cols_ - 1, rows_ - 1);
+}
+
+void Map::setDeferSignals(const bool defer) noexcept
+{
+    m_deferSignals = defer;
+
+    if (!defer) {
+        flushSignals();
+    }
+}
+
+void Map::flushSignals() noexcept
+{
+    // Swap out first, the receivers might change things again
+    if (!m_changedTerrain.isEmpty()) {
+        m_signalledTerrain = m_changedTerrain;
+        m_changedTerrain.clear();
+        emit(Signals::TerrainChanged);
     }
 
+    if (!m_changedUnits.isEmpty()) {
+        m_signalledUnits = m_changedUnits;
+        m_changedUnits.clear();
+        emit(Signals::UnitsChanged);
+    }
+}
+
+void Map::markUnitsChanged(const int col, const int row) noexcept
+{
+    m_changedUnits.add(col, row);
+
+    if (!m_deferSignals) {
+        flushSignals();
+    }
+}
+
+void Map::markTerrainChanged(const int firstCol, const int firstRow, const int lastCol, const int lastRow) noexcept
+{
+    m_changedTerrain.add(firstCol, firstRow, lastCol, lastRow);
+
+    if (!m_deferSignals) {
+        flushSignals();
+    }
+}
+
+void Map::resetPassability() noexcept
+{
+    m_passability.reset(cols_, rows_);
+
     for (int col = 0; col < cols_; col++) {
         for (int row = 0; row < rows_; row++) {
-            updateTileBlend(col, row);
+            m_passability.setTerrain(col, row, tiles_[row * cols_ + col].terrainId);
+            updateObstruction(col, row);
         }
     }
+}
 
-    TIME_TICK;
-    for (int col = 0; col < cols_; col++) {
-        for (int row = 0; row < rows_; row++) {
-            updateTileSlopes(col, row);
+void Map::updateObstruction(const int col, const int row) noexcept
+{
+    bool obstructed = false;
+    for (Entity &entity : entitiesAt(col, row)) {
+        const Unit *unit = Unit::fromEntity(entity);
+        if (!unit || unit->data()->Size.z == 0) {
+            continue;
+        }
+
+        switch (unit->data()->ObstructionType) {
+        case genie::Unit::BuildingObstruction:
+        case genie::Unit::MountainObstruction: // TOOD:  apparently uses the selection mask?
+            obstructed = true;
+            break;
+        default:
+            break;
+        }
+
+        if (obstructed) {
+            break;
         }
     }
-    m_updated = true;
 
-    emit(Signals::TerrainChanged);
+    m_passability.setObstructed(col, row, obstructed);
 }
 
 enum Direction : uint8_t {
@@ -19,10 +19,12 @@
 #pragma once
 
 #include <assert.h>
+#include <algorithm>
 #include <memory>
 #include <vector>
 
 #include "MapTile.h"
+#include "PassabilityMap.h"
 #include "core/Constants.h"
 #include "core/SignalEmitter.h"
 #include "core/Utility.h"
@@ -44,6 +46,73 @@ public:
     int32_t x_pos, y_pos, z_pos;
 };
 
+/// Narrows down which entities range queries on the map visit
+struct EntityFilter
+{
+    static constexpr int AnyPlayer = -1;
+
+    enum class Kind {
+        Any,
+        Unit, // Includes buildings
+        Building,
+        Missile,
+        Decaying
+    };
+
+    Kind kind = Kind::Any;
+
+    /// Only units owned by this player
+    int playerId = AnyPlayer;
+
+    /// Skip units owned by this player, e.g. gaia
+    int ignoredPlayerId = AnyPlayer;
+
+    inline bool acceptsAll() const noexcept {
+        return kind == Kind::Any && playerId == AnyPlayer && ignoredPlayerId == AnyPlayer;
+    }
+};
+
+/// The tiles that changed, as the smallest rectangle containing all of them (inclusive)
+struct MapRegion
+{
+    int firstCol = 0;
+    int firstRow = 0;
+    int lastCol = -1;
+    int lastRow = -1;
+
+    inline bool isEmpty() const noexcept { return lastCol < firstCol || lastRow < firstRow; }
+
+    inline bool contains(const int col, const int row) const noexcept {
+        return col >= firstCol && col <= lastCol && row >= firstRow && row <= lastRow;
+    }
+
+    inline void add(const int col, const int row) noexcept {
+        add(col, row, col, row);
+    }
+
+    inline void add(const int fromCol, const int fromRow, const int toCol, const int toRow) noexcept {
+        if (isEmpty()) {
+            firstCol = fromCol;
+            firstRow = fromRow;
+            lastCol = toCol;
+            lastRow = toRow;
+            return;
+        }
+        firstCol = std::min(firstCol, fromCol);
+        firstRow = std::min(firstRow, fromRow);
+        lastCol = std::max(lastCol, toCol);
+        lastRow = std::max(lastRow, toRow);
+    }
+
+    inline void add(const MapRegion &other) noexcept {
+        if (!other.isEmpty()) {
+            add(other.firstCol, other.firstRow, other.lastCol, other.lastRow);
+        }
+    }
+
+    inline void clear() noexcept { *this = MapRegion(); }
+};
+
 class Map : public SignalEmitter<Map>
 {
 public:
@@ -52,6 +121,15 @@ public:
         TerrainChanged
     };
 
+    static constexpr int32_t NoSlot = -1;
+
+    struct EntitySlot {
+        Entity *entity = nullptr;
+        int32_t tile = -1; // -1 when not on any tile
+        int32_t next = NoSlot;
+        int32_t previous = NoSlot;
+    };
+
     enum MapSize {
         Tiny = 72,
         Small = 96,
@@ -83,7 +161,24 @@ public:
     inline int height() const noexcept { return rows_ * Constants::TILE_SIZE; }
     inline int width() const noexcept { return cols_ * Constants::TILE_SIZE; }
 
-    float elevationAt(const MapPos &position) noexcept;
+    /// Precomputed for each tile when the tiles are updated, so this is cheap enough to call all the time
+    inline float elevationAt(const MapPos &position) const noexcept {
+        const int tileX = position.x / Constants::TILE_SIZE;
+        const int tileY = position.y / Constants::TILE_SIZE;
+        const unsigned int index = tileY * cols_ + tileX;
+        if (IS_UNLIKELY(index >= m_tileHeights.size())) {
+            return MapTile::null.elevation * m_elevationHeight;
+        }
+
+        const float localX = position.x / Constants::TILE_SIZE - tileX;
+        const float localY = position.y / Constants::TILE_SIZE - tileY;
+
+        const TileHeight &height = m_tileHeights[index];
+        return height.base + height.x * localX + height.y * localY + height.xy * localX * localY;
+    }
+
+    /// Same as elevationAt(), for a bunch of positions at once
+    void elevationsAt(const MapPos *positions, const size_t count, float *elevations) const noexcept;
 
     const MapTile &getTileAt(unsigned int col, unsigned int row) const noexcept {
         const unsigned int index = row * cols_ + col;
@@ -106,33 +201,95 @@ public:
     void setTileAt(unsigned col, unsigned row, unsigned id) noexcept;
     void updateTileAt(const int col, const int row, unsigned id) noexcept;
 
-    void removeEntityAt(unsigned int col, unsigned int row, const int entityId) noexcept;
-    void addEntityAt(int col, int row, const EntityPtr &entity) noexcept;
+    /// Adds it to the tile, or moves it there if it already is on the map
+    void addEntityAt(int col, int row, Entity *entity) noexcept;
+    void removeEntity(Entity *entity) noexcept;
+
+    /// The entities on a tile, linked through the slots so moving between tiles doesn't allocate
+    class TileEntities
+    {
+    public:
+        class Iterator
+        {
+        public:
+            inline Entity &operator*() const noexcept { return *(*m_slots)[m_slot].entity; }
+            inline Iterator &operator++() noexcept { m_slot = (*m_slots)[m_slot].next; return *this; }
+            inline bool operator!=(const Iterator &other) const noexcept { return m_slot != other.m_slot; }
+
+        private:
+            friend class TileEntities;
+            Iterator(const std::vector<EntitySlot> *slots, const int32_t slot) : m_slots(slots), m_slot(slot) {}
+
+            const std::vector<EntitySlot> *m_slots;
+            int32_t m_slot;
+        };
+
+        inline Iterator begin() const noexcept { return Iterator(m_slots, m_first); }
+        inline Iterator end() const noexcept { return Iterator(m_slots, NoSlot); }
+        inline bool empty() const noexcept { return m_first == NoSlot; }
+
+    private:
+        friend class Map;
+        TileEntities(const std::vector<EntitySlot> *slots, const int32_t first) : m_slots(slots), m_first(first) {}
+
+        const std::vector<EntitySlot> *m_slots;
+        int32_t m_first;
+    };
 
-    inline const std::vector<std::weak_ptr<Entity>> &entitiesAt(unsigned int col, unsigned int row) const noexcept {
+    /// Don't add or remove entities from the map while going through them
+    inline TileEntities entitiesAt(unsigned int col, unsigned int row) const noexcept {
         unsigned int index = row * cols_ + col;
-        if (IS_UNLIKELY(index >= m_tileUnits.size())) {
-            static const std::vector<std::weak_ptr<Entity>> nullVector;
-            return nullVector;
+        if (IS_UNLIKELY(index >= m_tileFirstSlot.size())) {
+            return TileEntities(&m_entitySlots, NoSlot);
         }
-        return m_tileUnits[index];
+        return TileEntities(&m_entitySlots, m_tileFirstSlot[index]);
     }
 
-    inline const std::vector<std::weak_ptr<Entity>> entitiesBetween(int firstCol, int firstRow, int lastCol, int lastRow) const noexcept {
-        std::vector<std::weak_ptr<Entity>> entities;
-        for (int col=firstCol; col<lastCol; col++) {
-            for (int row=firstRow; row<lastRow; row++) {
-                entities.insert(entities.end(), entitiesAt(col, row).begin(), entitiesAt(col, row).end());
+    /// Calls the callback with every entity on the tiles from the first up to,
+    /// but not including, the last, without copying anything.
+    /// Don't add or remove entities from the map in the callback, collect them and do it after.
+    template<typename Callback>
+    inline void forEachEntityBetween(int firstCol, int firstRow, int lastCol, int lastRow, const Callback &callback, const EntityFilter &filter = EntityFilter()) const noexcept {
+        firstCol = std::max(firstCol, 0);
+        firstRow = std::max(firstRow, 0);
+        lastCol = std::min(lastCol, cols_);
+        lastRow = std::min(lastRow, rows_);
+
+        const bool filtered = !filter.acceptsAll();
+        for (int row=firstRow; row<lastRow; row++) {
+            for (int col=firstCol; col<lastCol; col++) {
+                for (int32_t slot = m_tileFirstSlot[row * cols_ + col]; slot != NoSlot; slot = m_entitySlots[slot].next) {
+                    Entity &entity = *m_entitySlots[slot].entity;
+                    if (filtered && !matches(entity, filter)) {
+                        continue;
+                    }
+                    callback(entity);
+                }
             }
         }
-        return entities;
     }
 
-    void updateMapData() noexcept;
+    /// Works out the frames, blends and slopes of all the tiles, the result is the same either way
+    void updateMapData(const bool parallel = true) noexcept;
+
+    const PassabilityMap &passability() const noexcept { return m_passability; }
 
     bool tilesUpdated() const noexcept { return m_updated; }
     void flushDirty() noexcept { m_updated = false; }
 
+    /// When deferred, changes to the entities on the tiles and to the terrain are
+    /// collected and only signalled when flushSignals() is called, once per tick,
+    /// instead of for every single unit that moves to another tile.
+    /// Turning it off delivers anything collected so far.
+    void setDeferSignals(const bool defer) noexcept;
+
+    /// Emits UnitsChanged and TerrainChanged once each if anything changed since last time
+    void flushSignals() noexcept;
+
+    /// What changed, valid while handling UnitsChanged and TerrainChanged
+    const MapRegion &changedUnitsRegion() const noexcept { return m_signalledUnits; }
+    const MapRegion &changedTerrainRegion() const noexcept { return m_signalledTerrain; }
+
     inline bool isValidTile(const unsigned col, const unsigned row) const {
         if (IS_UNLIKELY(row * cols_ + col >= tiles_.size())) {
             return false;
@@ -145,9 +302,25 @@ public:
     }
 
 private:
+    static bool matches(const Entity &entity, const EntityFilter &filter) noexcept;
+
+    /// Makes room for the entities on the tiles, anything outside the new size is taken off
+    void resizeEntityIndex(const size_t tileCount) noexcept;
+    void unlinkEntitySlot(const int32_t slot) noexcept;
+
     void updateTileBlend(int tileX, int tileY) noexcept;
     void updateTileSlopes(int tileX, int tileY) noexcept;
 
+    void resetPassability() noexcept;
+
+    /// Call after the elevations are set up, the slopes come later with updateMapData()
+    void resetTileHeights() noexcept;
+    void updateTileHeight(const int col, const int row) noexcept;
+    void updateObstruction(const int col, const int row) noexcept;
+
+    void markUnitsChanged(const int col, const int row) noexcept;
+    void markTerrainChanged(const int firstCol, const int firstRow, const int lastCol, const int lastRow) noexcept;
+
     inline Slope slopeAt(const int col, const int row) const noexcept {
         const unsigned int index = row * cols_ + col;
         if (IS_UNLIKELY(index >= tiles_.size())) {
@@ -161,9 +334,32 @@ private:
     typedef std::vector<MapTile> MapTileArray;
     MapTileArray tiles_;
 
-    std::vector<std::vector<std::weak_ptr<Entity>>> m_tileUnits;
+    /// Each entity on the map has a slot (stored in the entity), which is
+    /// in a doubly linked list with the rest of the entities on the same tile
+    std::vector<EntitySlot> m_entitySlots;
+    std::vector<int32_t> m_freeEntitySlots;
+    std::vector<int32_t> m_tileFirstSlot;
+
+    PassabilityMap m_passability;
+
+    /// All the slopes are bilinear, so the elevation anywhere on a tile is
+    /// base + x * localX + y * localY + xy * localX * localY
+    struct TileHeight {
+        float base = 0;
+        float x = 0;
+        float y = 0;
+        float xy = 0;
+    };
+    std::vector<TileHeight> m_tileHeights;
+    float m_elevationHeight = 0;
 
     bool m_updated = false;
+
+    bool m_deferSignals = false;
+    MapRegion m_changedUnits;
+    MapRegion m_changedTerrain;
+    MapRegion m_signalledUnits;
+    MapRegion m_signalledTerrain;
 };
 
 typedef std::shared_ptr<Map> MapPtr;
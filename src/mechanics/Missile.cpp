@@ -135,7 +135,7 @@ bool Missile::update(Time time) noexcept
         m_previousSmokeTime = time;
         if (player) {
             const genie::Unit &trailingData = player->civilization.unitData(m_data.Moving.TrackingUnit);
-            DecayingEntity::Ptr trailingUnit = std::make_shared<DecayingEntity>(trailingData.StandingGraphic.first, 0.f);
+            DecayingEntity::Ptr trailingUnit = m_unitManager.createDecayingEntity(trailingData.StandingGraphic.first, 0.f);
             trailingUnit->setMap(m_map.lock());
             trailingUnit->setPosition(position());
             m_unitManager.addDecayingEntity(trailingUnit);
@@ -169,18 +169,13 @@ bool Missile::update(Time time) noexcept
         Unit::Ptr sourceUnit = m_sourceUnit.lock();
         for (int dx = tileX-1; dx<=tileX+1; dx++) {
             for (int dy = tileY-1; dy<=tileY+1; dy++) {
-                const std::vector<std::weak_ptr<Entity>> &entities = map->entitiesAt(dx, dy);
-                if (entities.empty()) {
-                    continue;
-                }
-
-                for (const std::weak_ptr<Entity> &entity : entities) {
-                    Unit::Ptr otherUnit = Unit::fromEntity(entity);
+                for (Entity &entity : map->entitiesAt(dx, dy)) {
+                    const Unit *otherUnit = Unit::fromEntity(entity);
                     if (IS_UNLIKELY(!otherUnit)) {
                         continue;
                     }
 
-                    if (IS_UNLIKELY(otherUnit == sourceUnit)) {
+                    if (IS_UNLIKELY(otherUnit == sourceUnit.get())) {
                         continue;
                     }
 
@@ -194,7 +189,7 @@ bool Missile::update(Time time) noexcept
                     const float yDistance = std::abs(otherUnit->position().y - newPos.y);
 
                     if (IS_UNLIKELY(xDistance < xSize && yDistance < ySize)) {
-                        hitUnits.push_back(otherUnit);
+                        hitUnits.push_back(Unit::fromEntity(entity.weak_from_this()));
                         break;
                     }
                 }
@@ -0,0 +1,172 @@
+#include "PassabilityMap.h"
+
+#include <genie/dat/TerrainRestriction.h>
+
+#include "core/Logger.h"
+#include "resource/DataManager.h"
+
+#include <algorithm>
+
+void PassabilityMap::reset(const int cols, const int rows) noexcept
+{
+    m_cols = cols;
+    m_rows = rows;
+
+    const size_t tileCount = cols * rows;
+    m_terrainIds.assign(tileCount, 0);
+    m_obstructed.assign(tileCount, 0);
+    m_impassableLayer.assign(tileCount, 0);
+
+    // Everything starts out as terrain 0
+    m_layers.resize(DataManager::Inst().terrainRestrictionCount());
+    for (size_t restriction = 0; restriction < m_layers.size(); restriction++) {
+        const std::vector<float> &multipliers = DataManager::Inst().getTerrainRestriction(restriction).PassableBuildableDmgMultiplier;
+        m_layers[restriction].assign(tileCount, isTerrainPassable(multipliers, 0));
+    }
+
+    m_clusterGraphs.clear();
+    m_regions.clear();
+    m_revision++;
+}
+
+void PassabilityMap::setTerrain(const int col, const int row, const int terrainId) noexcept
+{
+    if (IS_UNLIKELY(!isValid(col, row))) {
+        WARN << "Trying to set terrain out of range" << col << row;
+        return;
+    }
+
+    const int index = row * m_cols + col;
+    if (m_terrainIds[index] == terrainId) {
+        return;
+    }
+    m_terrainIds[index] = terrainId;
+    setChanged(col, row);
+    m_revision++;
+
+    for (size_t restriction = 0; restriction < m_layers.size(); restriction++) {
+        const std::vector<float> &multipliers = DataManager::Inst().getTerrainRestriction(restriction).PassableBuildableDmgMultiplier;
+        m_layers[restriction][index] = isTerrainPassable(multipliers, terrainId);
+    }
+}
+
+void PassabilityMap::setObstructed(const int col, const int row, const bool obstructed) noexcept
+{
+    if (IS_UNLIKELY(!isValid(col, row))) {
+        WARN << "Trying to set obstruction out of range" << col << row;
+        return;
+    }
+
+    const int index = row * m_cols + col;
+    if (m_obstructed[index] == obstructed) {
+        return;
+    }
+
+    m_obstructed[index] = obstructed;
+    setChanged(col, row);
+    m_revision++;
+}
+
+std::vector<uint8_t> PassabilityMap::passableTiles(const int restriction) const noexcept
+{
+    const std::vector<uint8_t> &terrain = layer(restriction);
+
+    std::vector<uint8_t> passable(terrain.size());
+    for (size_t i=0; i<terrain.size(); i++) {
+        passable[i] = terrain[i] && !m_obstructed[i];
+    }
+
+    return passable;
+}
+
+ClusterGraph::Ptr PassabilityMap::clusterGraph(const int restriction) const noexcept
+{
+    CachedClusterGraph &cached = m_clusterGraphs[restriction];
+    if (!cached.graph) {
+        cached.graph = std::make_shared<ClusterGraph>(m_cols, m_rows);
+        cached.dirtyClusters.assign(cached.graph->clusterCount(), 1);
+        cached.dirty = true;
+    }
+
+    if (!cached.dirty) {
+        return cached.graph;
+    }
+
+    // Someone (a path search) is still using the old one
+    if (cached.graph.use_count() > 1) {
+        cached.graph = std::make_shared<ClusterGraph>(*cached.graph);
+    }
+
+    cached.graph->rebuild(cached.dirtyClusters, [this, restriction](const int col, const int row) {
+        return isPassable(restriction, col, row);
+    });
+
+    std::fill(cached.dirtyClusters.begin(), cached.dirtyClusters.end(), 0);
+    cached.dirty = false;
+
+    return cached.graph;
+}
+
+RegionMap::Ptr PassabilityMap::regions(const int restriction) const noexcept
+{
+    CachedRegionMap &cached = m_regions[restriction];
+    if (!cached.needsRebuild && cached.changedTiles.empty()) {
+        return cached.regions;
+    }
+
+    if (!cached.regions) {
+        cached.regions = std::make_shared<RegionMap>(m_cols, m_rows);
+    } else if (cached.regions.use_count() > 1) {
+        // Someone (a path search) is still using the old one
+        cached.regions = std::make_shared<RegionMap>(*cached.regions);
+    }
+
+    const RegionMap::PassableFunction isPassableFunction = [this, restriction](const int col, const int row) {
+        return isPassable(restriction, col, row);
+    };
+
+    if (cached.needsRebuild) {
+        cached.regions->rebuild(isPassableFunction);
+    } else {
+        cached.regions->update(cached.changedTiles, isPassableFunction);
+    }
+
+    cached.changedTiles.clear();
+    cached.needsRebuild = false;
+
+    return cached.regions;
+}
+
+void PassabilityMap::setChanged(const int col, const int row) noexcept
+{
+    for (std::pair<const int, CachedClusterGraph> &cached : m_clusterGraphs) {
+        cached.second.dirtyClusters[cached.second.graph->clusterIndexAt(col, row)] = 1;
+        cached.second.dirty = true;
+    }
+
+    // If a lot changed (e.g. the map is being set up) it is faster to just start over
+    const size_t maxChanges = m_terrainIds.size() / 16;
+    for (std::pair<const int, CachedRegionMap> &cached : m_regions) {
+        if (cached.second.needsRebuild) {
+            continue;
+        }
+
+        if (cached.second.changedTiles.size() >= maxChanges) {
+            cached.second.changedTiles.clear();
+            cached.second.needsRebuild = true;
+            continue;
+        }
+
+        cached.second.changedTiles.push_back(row * m_cols + col);
+    }
+}
+
+bool PassabilityMap::isTerrainPassable(const std::vector<float> &multipliers, const int terrainId) noexcept
+{
+    if (IS_UNLIKELY(terrainId < 0 || terrainId >= int(multipliers.size()))) {
+        return false;
+    }
+
+    return multipliers[terrainId] != 0;
+}
+
@@ -0,0 +1,107 @@
+#ifndef PASSABILITYMAP_H
+#define PASSABILITYMAP_H
+
+#include "core/Utility.h"
+#include "pathfinding/ClusterGraph.h"
+#include "pathfinding/RegionMap.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/// Tile level static passability, shared by everything that moves on a map.
+/// Terrain passability is kept per terrain restriction (all of them are built when
+/// it is reset, so looking things up never changes anything), static obstructions
+/// (buildings, cliffs etc.) are the same for every restriction.
+/// The lookups are safe from other threads as long as nothing changes it at the same time.
+/// Units moving around are not part of this, they are too short lived.
+/// Also keeps the cluster graphs for hierarchical pathfinding and the connected
+/// regions up to date.
+class PassabilityMap
+{
+public:
+    void reset(const int cols, const int rows) noexcept;
+
+    void setTerrain(const int col, const int row, const int terrainId) noexcept;
+    void setObstructed(const int col, const int row, const bool obstructed) noexcept;
+
+    inline bool isObstructed(const int col, const int row) const noexcept {
+        if (IS_UNLIKELY(!isValid(col, row))) {
+            return true;
+        }
+        return m_obstructed[row * m_cols + col];
+    }
+
+    inline bool isTerrainPassable(const int restriction, const int col, const int row) const noexcept {
+        if (IS_UNLIKELY(!isValid(col, row))) {
+            return false;
+        }
+        return layer(restriction)[row * m_cols + col];
+    }
+
+    inline bool isPassable(const int restriction, const int col, const int row) const noexcept {
+        if (IS_UNLIKELY(!isValid(col, row))) {
+            return false;
+        }
+        const int index = row * m_cols + col;
+        return !m_obstructed[index] && layer(restriction)[index];
+    }
+
+    inline bool isValid(const int col, const int row) const noexcept {
+        return col >= 0 && row >= 0 && col < m_cols && row < m_rows;
+    }
+
+    int cols() const noexcept { return m_cols; }
+    int rows() const noexcept { return m_rows; }
+
+    /// Bumped every time something changes, to know when cached searches are stale
+    uint32_t revision() const noexcept { return m_revision; }
+
+    /// Copy of isPassable() for every tile, row by row
+    std::vector<uint8_t> passableTiles(const int restriction) const noexcept;
+
+    /// Only from the main thread, the returned graph is not touched again so it can be handed to other threads
+    ClusterGraph::Ptr clusterGraph(const int restriction) const noexcept;
+
+    /// Same as clusterGraph(), only from the main thread
+    RegionMap::Ptr regions(const int restriction) const noexcept;
+
+private:
+    struct CachedClusterGraph {
+        std::shared_ptr<ClusterGraph> graph;
+        std::vector<uint8_t> dirtyClusters;
+        bool dirty = true;
+    };
+
+    struct CachedRegionMap {
+        std::shared_ptr<RegionMap> regions;
+        std::vector<int> changedTiles;
+        bool needsRebuild = true;
+    };
+
+    void setChanged(const int col, const int row) noexcept;
+
+    inline const std::vector<uint8_t> &layer(const int restriction) const noexcept {
+        if (IS_UNLIKELY(restriction < 0 || restriction >= int(m_layers.size()))) {
+            return m_impassableLayer;
+        }
+        return m_layers[restriction];
+    }
+    static bool isTerrainPassable(const std::vector<float> &multipliers, const int terrainId) noexcept;
+
+    int m_cols = 0;
+    int m_rows = 0;
+    uint32_t m_revision = 0;
+
+    std::vector<int16_t> m_terrainIds;
+    std::vector<uint8_t> m_obstructed;
+
+    // One for each terrain restriction, the unknown ones get the impassable one
+    std::vector<std::vector<uint8_t>> m_layers;
+    std::vector<uint8_t> m_impassableLayer;
+
+    mutable std::unordered_map<int, CachedClusterGraph> m_clusterGraphs;
+    mutable std::unordered_map<int, CachedRegionMap> m_regions;
+};
+
+#endif // PASSABILITYMAP_H
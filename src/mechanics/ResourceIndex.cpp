@@ -0,0 +1,160 @@
+#include "ResourceIndex.h"
+
+#include "Unit.h"
+
+#include "core/Logger.h"
+#include "core/ResourceMap.h"
+#include "global/EventManager.h"
+
+#include <genie/dat/Unit.h>
+
+// Only the things that can actually be gathered, not e. g. the population headroom town centers have
+static const genie::ResourceType s_gatherableTypes[] = {
+    genie::ResourceType::FoodStorage,
+    genie::ResourceType::WoodStorage,
+    genie::ResourceType::StoneStorage,
+    genie::ResourceType::GoldStorage,
+};
+
+ResourceIndex::ResourceIndex(const UnitManager *unitManager) :
+    m_unitManager(unitManager)
+{
+    EventManager::registerListener(this, EventManager::UnitCreated);
+    EventManager::registerListener(this, EventManager::UnitDestroyed);
+    EventManager::registerListener(this, EventManager::UnitMoved);
+    EventManager::registerListener(this, EventManager::UnitChangedOwner);
+}
+
+ResourceIndex::~ResourceIndex()
+{
+    EventManager::deregisterListener(this);
+}
+
+Unit *ResourceIndex::findClosestDropSite(const int playerId, const int unitId, const MapPos &position) const noexcept
+{
+    std::unordered_map<int, CellGrid>::const_iterator it = m_dropSites.find(dropSiteKey(playerId, unitId));
+    if (it == m_dropSites.end()) {
+        return nullptr;
+    }
+
+    return findClosest(it->second, position, std::numeric_limits<float>::max(), [](Unit *) { return true; });
+}
+
+void ResourceIndex::onUnitCreated(Unit *unit)
+{
+    if (&unit->unitManager() != m_unitManager) {
+        return;
+    }
+
+    // Same as what we get when it moves
+    MapPos tile = unit->position() / Constants::TILE_SIZE;
+    tile.round();
+    add(unit, cellAt(tile));
+}
+
+void ResourceIndex::onUnitDying(Unit *unit)
+{
+    remove(unit);
+}
+
+void ResourceIndex::onUnitMoved(Unit *unit, const MapPos &oldTile, const MapPos &newTile)
+{
+    std::unordered_map<const Unit*, IndexedUnit>::iterator it = m_units.find(unit);
+    if (it == m_units.end()) {
+        return;
+    }
+
+    // Sent before the position is updated
+    const int cell = cellAt(newTile);
+    if (cell == it->second.cell) {
+        return;
+    }
+
+    remove(unit);
+    add(unit, cell);
+}
+
+void ResourceIndex::onUnitOwnerChanged(Unit *unit, int oldPlayerId, int newPlayerId)
+{
+    std::unordered_map<const Unit*, IndexedUnit>::iterator it = m_units.find(unit);
+    if (it == m_units.end()) {
+        return;
+    }
+
+    const int cell = it->second.cell;
+    remove(unit);
+    add(unit, cell);
+}
+
+bool ResourceIndex::hasResource(const Unit *unit, const genie::ResourceType type) noexcept
+{
+    ResourceMap::const_iterator it = unit->resources.find(type);
+    return it != unit->resources.end() && it->second > 0;
+}
+
+MapPos ResourceIndex::unitPosition(const Unit *unit) noexcept
+{
+    return unit->position();
+}
+
+int ResourceIndex::cellAt(const MapPos &tile) noexcept
+{
+    const int col = std::clamp(int(tile.x) / CellSize, 0, CellCount - 1);
+    const int row = std::clamp(int(tile.y) / CellSize, 0, CellCount - 1);
+    return row * CellCount + col;
+}
+
+void ResourceIndex::add(Unit *unit, const int cell) noexcept
+{
+    IndexedUnit indexed;
+    indexed.cell = cell;
+
+    // Only buildings can be dropped off at
+    if (unit->data()->Type >= genie::Unit::BuildingType) {
+        indexed.dropSiteKey = dropSiteKey(unit->playerId, unit->data()->ID);
+        m_dropSites[indexed.dropSiteKey].cells[cell].push_back(unit);
+    }
+
+    for (const genie::ResourceType type : s_gatherableTypes) {
+        if (hasResource(unit, type)) {
+            indexed.resourceTypes.push_back(int(type));
+            m_resources[int(type)].cells[cell].push_back(unit);
+        }
+    }
+
+    if (indexed.dropSiteKey == -1 && indexed.resourceTypes.empty()) {
+        return;
+    }
+
+    m_units[unit] = std::move(indexed);
+}
+
+void ResourceIndex::remove(Unit *unit) noexcept
+{
+    std::unordered_map<const Unit*, IndexedUnit>::iterator it = m_units.find(unit);
+    if (it == m_units.end()) {
+        return;
+    }
+
+    const IndexedUnit &indexed = it->second;
+
+    const auto removeFrom = [&](CellGrid &grid) {
+        std::vector<Unit*> &cell = grid.cells[indexed.cell];
+        std::vector<Unit*>::iterator unitIt = std::find(cell.begin(), cell.end(), unit);
+        if (IS_UNLIKELY(unitIt == cell.end())) {
+            WARN << "Unit not where we put it" << unit->debugName;
+            return;
+        }
+        *unitIt = cell.back();
+        cell.pop_back();
+    };
+
+    if (indexed.dropSiteKey != -1) {
+        removeFrom(m_dropSites[indexed.dropSiteKey]);
+    }
+    for (const int type : indexed.resourceTypes) {
+        removeFrom(m_resources[type]);
+    }
+
+    m_units.erase(it);
+}
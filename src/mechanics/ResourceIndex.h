@@ -0,0 +1,120 @@
+#ifndef RESOURCEINDEX_H
+#define RESOURCEINDEX_H
+
+#include "core/Constants.h"
+#include "core/Types.h"
+#include "global/EventListener.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+class UnitManager;
+
+/// Keeps track of where the drop sites (per player and unit id) and the units that can
+/// be gathered from (per resource type) are, so gatherers don't have to go through all
+/// the units on the map every time they are full or run out of things to gather.
+/// Kept up to date from the unit events, not rebuilt.
+class ResourceIndex : public EventListener
+{
+public:
+    /// In tiles
+    static constexpr int CellSize = 8;
+
+    ResourceIndex(const UnitManager *unitManager);
+    ~ResourceIndex();
+
+    Unit *findClosestDropSite(const int playerId, const int unitId, const MapPos &position) const noexcept;
+
+    /// The closest unit with some of the resource left that the predicate accepts, nullptr if none within the distance
+    template<typename Predicate>
+    inline Unit *findClosestResource(const genie::ResourceType type, const MapPos &position, const float maxDistance, const Predicate &accept) const noexcept {
+        std::unordered_map<int, CellGrid>::const_iterator it = m_resources.find(int(type));
+        if (it == m_resources.end()) {
+            return nullptr;
+        }
+        return findClosest(it->second, position, maxDistance, [&](Unit *unit) {
+            return hasResource(unit, type) && accept(unit);
+        });
+    }
+
+protected:
+    void onUnitCreated(Unit *unit) override;
+    void onUnitDying(Unit *unit) override;
+    void onUnitMoved(Unit *unit, const MapPos &oldTile, const MapPos &newTile) override;
+    void onUnitOwnerChanged(Unit *unit, int oldPlayerId, int newPlayerId) override;
+
+private:
+    static constexpr int CellCount = (Constants::MAP_MAX_SIZE + CellSize - 1) / CellSize;
+
+    struct CellGrid {
+        CellGrid() : cells(CellCount * CellCount) {}
+
+        std::vector<std::vector<Unit*>> cells;
+    };
+
+    struct IndexedUnit {
+        int cell = -1;
+        int dropSiteKey = -1;
+        std::vector<int> resourceTypes;
+    };
+
+    static bool hasResource(const Unit *unit, const genie::ResourceType type) noexcept;
+    static MapPos unitPosition(const Unit *unit) noexcept;
+    static int cellAt(const MapPos &tile) noexcept;
+    static inline int dropSiteKey(const int playerId, const int unitId) noexcept { return (playerId << 16) | (unitId & 0xFFFF); }
+
+    void add(Unit *unit, const int cell) noexcept;
+    void remove(Unit *unit) noexcept;
+
+    /// Looks through growing squares of cells around the position, until the squares are further away than what we found
+    template<typename Predicate>
+    Unit *findClosest(const CellGrid &grid, const MapPos &position, const float maxDistance, const Predicate &accept) const noexcept {
+        const float cellSize = CellSize * Constants::TILE_SIZE;
+        const int centerCol = std::clamp(int(position.x / cellSize), 0, CellCount - 1);
+        const int centerRow = std::clamp(int(position.y / cellSize), 0, CellCount - 1);
+
+        Unit *closest = nullptr;
+        float closestDistance = maxDistance;
+        for (int radius = 0; radius < CellCount && (radius - 1) * cellSize <= closestDistance; radius++) {
+            for (int row = centerRow - radius; row <= centerRow + radius; row++) {
+                if (row < 0 || row >= CellCount) {
+                    continue;
+                }
+
+                // Only the edges of the square
+                const int step = (row == centerRow - radius || row == centerRow + radius) ? 1 : std::max(radius * 2, 1);
+                for (int col = centerCol - radius; col <= centerCol + radius; col += step) {
+                    if (col < 0 || col >= CellCount) {
+                        continue;
+                    }
+
+                    for (Unit *unit : grid.cells[row * CellCount + col]) {
+                        const float distance = position.distance(unitPosition(unit));
+                        if (distance > closestDistance) {
+                            continue;
+                        }
+                        if (!accept(unit)) {
+                            continue;
+                        }
+
+                        closest = unit;
+                        closestDistance = distance;
+                    }
+                }
+            }
+        }
+
+        return closest;
+    }
+
+    const UnitManager *m_unitManager;
+
+    std::unordered_map<int, CellGrid> m_dropSites;
+    std::unordered_map<int, CellGrid> m_resources;
+    std::unordered_map<const Unit*, IndexedUnit> m_units;
+};
+
+#endif // RESOURCEINDEX_H
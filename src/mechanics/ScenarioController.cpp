@@ -42,8 +42,19 @@ ScenarioController::ScenarioController(GameState *gameState) :
 {
 }
 
+ScenarioController::~ScenarioController()
+{
+    // The timers call back into us
+    for (size_t i=0; i<m_triggers.size(); i++) {
+        stopTimers(i);
+    }
+}
+
 void ScenarioController::setScenario(const std::shared_ptr<genie::ScnFile> &scenario)
 {
+    for (size_t i=0; i<m_triggers.size(); i++) {
+        stopTimers(i);
+    }
     m_triggers.clear();
 
     if (!scenario) {
@@ -270,6 +281,13 @@ void ScenarioController::setScenario(const std::shared_ptr<genie::ScnFile> &scen
         m_triggers.emplace_back(winTrigger);
     }
 
+    // Only now that they are all in place, the timers refer to them by index
+    for (size_t i=0; i<m_triggers.size(); i++) {
+        if (m_triggers[i].enabled) {
+            startTimers(i);
+        }
+    }
+
     EventManager::registerListener(this, EventManager::UnitCreated);
     EventManager::registerListener(this, EventManager::UnitMoved);
     EventManager::registerListener(this, EventManager::UnitSelected);
@@ -279,22 +297,18 @@ void ScenarioController::setScenario(const std::shared_ptr<genie::ScnFile> &scen
     EventManager::registerListener(this, EventManager::AttributeChanged);
 }
 
-bool ScenarioController::update(Time time)
+bool ScenarioController::update(Time /*time*/)
 {
     bool updated = false;
-    const Time elapsed = time - m_lastUpdateTime;
-    m_lastUpdateTime = time;
-    for (Trigger &trigger : m_triggers) {
+    for (size_t triggerIndex = 0; triggerIndex < m_triggers.size(); triggerIndex++) {
+        Trigger &trigger = m_triggers[triggerIndex];
         if (!trigger.enabled) {
             continue;
         }
 
+        // Timers are set to 0 by the timer wheel when they run out
         bool conditionsSatisfied = true;
-        for (Condition &condition : trigger.conditions) {
-            if (condition.data.type == genie::TriggerCondition::Timer) {
-                condition.amountRequired -= elapsed;
-            }
-
+        for (const Condition &condition : trigger.conditions) {
             if (condition.amountRequired > 0) {
                 conditionsSatisfied = false;
             }
@@ -307,7 +321,7 @@ bool ScenarioController::update(Time time)
         updated = true;
 
         if (!trigger.looping) {
-            trigger.enabled = false;
+            setTriggerEnabled(triggerIndex, false);
         }
 
         for (const genie::TriggerEffect &effect : trigger.effects) {
@@ -318,6 +332,61 @@ bool ScenarioController::update(Time time)
     return updated;
 }
 
+void ScenarioController::setTriggerEnabled(const size_t triggerIndex, const bool enabled)
+{
+    if (m_triggers[triggerIndex].enabled == enabled) {
+        return;
+    }
+
+    m_triggers[triggerIndex].enabled = enabled;
+
+    if (enabled) {
+        startTimers(triggerIndex);
+    } else {
+        stopTimers(triggerIndex);
+    }
+}
+
+void ScenarioController::startTimers(const size_t triggerIndex)
+{
+    const std::shared_ptr<UnitManager> &unitManager = m_gameState->unitManager();
+    if (!unitManager) {
+        WARN << "no unit manager to run timers";
+        return;
+    }
+
+    std::vector<Condition> &conditions = m_triggers[triggerIndex].conditions;
+    for (size_t conditionIndex = 0; conditionIndex < conditions.size(); conditionIndex++) {
+        Condition &condition = conditions[conditionIndex];
+        if (condition.data.type != genie::TriggerCondition::Timer || condition.amountRequired <= 0) {
+            continue;
+        }
+
+        condition.timer = unitManager->timers().scheduleIn(condition.amountRequired, [this, triggerIndex, conditionIndex]() {
+            m_triggers[triggerIndex].conditions[conditionIndex].amountRequired = 0;
+        });
+    }
+}
+
+void ScenarioController::stopTimers(const size_t triggerIndex)
+{
+    const std::shared_ptr<UnitManager> &unitManager = m_gameState->unitManager();
+    if (!unitManager) {
+        return;
+    }
+
+    TimerWheel &timers = unitManager->timers();
+    for (Condition &condition : m_triggers[triggerIndex].conditions) {
+        if (!timers.isScheduled(condition.timer)) {
+            continue;
+        }
+
+        // Keep what is left, so it continues from there if it is enabled again
+        condition.amountRequired = timers.timeLeft(condition.timer);
+        timers.cancel(condition.timer);
+    }
+}
+
 void ScenarioController::handleTriggerEffect(const genie::TriggerEffect &effect)
 {
     switch(effect.type) {
@@ -328,7 +397,7 @@ void ScenarioController::handleTriggerEffect(const genie::TriggerEffect &effect)
             return;
         }
         DBG << "enabling trigger" << m_triggers[effect.trigger].name;
-        m_triggers[effect.trigger].enabled = true;
+        setTriggerEnabled(effect.trigger, true);
         break;
     case genie::TriggerEffect::DeactivateTrigger:
         // TODO: display order or normal order?
@@ -337,7 +406,7 @@ void ScenarioController::handleTriggerEffect(const genie::TriggerEffect &effect)
             return;
         }
         DBG << "disabling trigger" << m_triggers[effect.trigger].name;
-        m_triggers[effect.trigger].enabled = false;
+        setTriggerEnabled(effect.trigger, false);
         break;
     case genie::TriggerEffect::DisplayInstructions:
         DBG << "TODO: implement sound for instructions";
@@ -376,48 +445,18 @@ void ScenarioController::handleTriggerEffect(const genie::TriggerEffect &effect)
     }
     case genie::TriggerEffect::RemoveObject: {
         DBG << "Removing unit" << effect;
-        std::vector<std::weak_ptr<Entity>> entities;
-        entities = m_gameState->map()->entitiesBetween(effect.areaFrom.y,
-                                                              effect.areaFrom.x,
-                                                              effect.areaTo.y,
-                                                              effect.areaTo.x);
-
-        for (const std::weak_ptr<Entity> &entity : entities) {
-            Unit::Ptr unit = Unit::fromEntity(entity);
-            if (!unit) {
-                WARN << "got invalid unit in area for effect";
-                continue;
-            }
-            if (!checkUnitMatchingEffect(unit, effect)) {
-                continue;
-            }
-
+        for (const Unit::Ptr &unit : unitsMatchingEffect(effect)) {
             DBG << "Removing unit" << unit->debugName;
             m_gameState->unitManager()->remove(unit);
         }
         break;
     }
     case genie::TriggerEffect::TaskObject: {
-        // again with the wtf swap of x and y
-        std::vector<std::weak_ptr<Entity>> entities;
-        entities = m_gameState->map()->entitiesBetween(effect.areaFrom.y,
-                                                              effect.areaFrom.x,
-                                                              effect.areaTo.y,
-                                                              effect.areaTo.x);
-
         // TODO, not sure if it is right to move to the middle of the tile, but whatevs
         MapPos targetPos(effect.location.y + 0.5, effect.location.x + 0.5);
         targetPos *= Constants::TILE_SIZE;
 
-        for (const std::weak_ptr<Entity> &entity : entities) {
-            Unit::Ptr unit = Unit::fromEntity(entity);
-            if (!unit) {
-                WARN << "got invalid unit in area for effect";
-                continue;
-            }
-            if (!checkUnitMatchingEffect(unit, effect)) {
-                continue;
-            }
+        for (const Unit::Ptr &unit : unitsMatchingEffect(effect)) {
             DBG << "Tasking object" << unit->debugName;
 
             m_gameState->unitManager()->moveUnitTo(unit, targetPos);
@@ -636,6 +675,32 @@ bool ScenarioController::Condition::checkUnitMatching(const Unit *unit) const
     return true;
 }
 
+std::vector<Unit::Ptr> ScenarioController::unitsMatchingEffect(const genie::TriggerEffect &effect)
+{
+    EntityFilter filter;
+    filter.kind = EntityFilter::Kind::Unit;
+    if (effect.sourcePlayer > -1) {
+        filter.playerId = effect.sourcePlayer;
+    }
+
+    // Removing or tasking them might change what is on the map, so don't do that while we go through it
+    std::vector<Unit::Ptr> units;
+
+    // again with the wtf swap of x and y
+    m_gameState->map()->forEachEntityBetween(effect.areaFrom.y,
+                                             effect.areaFrom.x,
+                                             effect.areaTo.y,
+                                             effect.areaTo.x,
+                                             [&](Entity &entity) {
+        Unit::Ptr unit = Unit::fromEntity(entity.weak_from_this());
+        if (checkUnitMatchingEffect(unit, effect)) {
+            units.push_back(unit);
+        }
+    }, filter);
+
+    return units;
+}
+
 bool ScenarioController::checkUnitMatchingEffect(const std::shared_ptr<Unit> &unit, const genie::TriggerEffect &effect)
 {
     if (!unit) {
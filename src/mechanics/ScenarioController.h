@@ -3,6 +3,7 @@
 
 #include "global/EventListener.h"
 #include "core/Logger.h"
+#include "core/TimerWheel.h"
 #include "core/Types.h"
 
 #include <genie/script/scn/Trigger.h>
@@ -19,9 +20,12 @@ class ScenarioController : public EventListener
 {
     struct Condition {
         /// For boolean triggers just 0 or 1
-        /// For timers, milliseconds elapsed
+        /// For timers, milliseconds left, only updated when the timer is stopped or fires
         float amountRequired = 0;
 
+        /// Counts down while the trigger is enabled
+        TimerHandle timer;
+
         Condition(const genie::TriggerCondition &d) : data(d) {
             if (d.type == genie::TriggerCondition::Timer) {
                 amountRequired = 1000 * data.timer; // it is in milliseconds
@@ -76,6 +80,7 @@ class ScenarioController : public EventListener
 
 public:
     ScenarioController(GameState *gameState);
+    ~ScenarioController();
 
     void setScenario(const std::shared_ptr<genie::ScnFile> &scenario);
     bool update(Time time);
@@ -86,6 +91,9 @@ public:
 private:
     bool checkUnitMatchingEffect(const std::shared_ptr<Unit> &unit, const genie::TriggerEffect &effect);
 
+    /// Units in the area of the effect that it applies to
+    std::vector<std::shared_ptr<Unit>> unitsMatchingEffect(const genie::TriggerEffect &effect);
+
     void onUnitDying(Unit *unit) override;
     void onUnitCreated(Unit *unit) override;
     void onUnitMoved(Unit *unit, const MapPos &oldTile, const MapPos &newTile) override;
@@ -96,14 +104,16 @@ private:
 
     void handleTriggerEffect(const genie::TriggerEffect &effect);
 
+    void setTriggerEnabled(const size_t triggerIndex, const bool enabled);
+    void startTimers(const size_t triggerIndex);
+    void stopTimers(const size_t triggerIndex);
+
     // Todo: put these in an std::array based on type, so we don't have to loop over all
 
     std::vector<Trigger> m_triggers;
-    Time m_lastUpdateTime = 0;
 
     GameState *m_gameState = nullptr; // ugly raw pointer, but owned by gamestate, so sue me
     Engine *m_engine = nullptr; // samesies
-//    Time m_nextTimerTriggerTarget = -1;
 
 };
 
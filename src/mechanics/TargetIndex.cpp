@@ -0,0 +1,168 @@
+#include "TargetIndex.h"
+
+#include "Unit.h"
+
+#include "core/Constants.h"
+#include "core/Logger.h"
+#include "core/Utility.h"
+
+#include <algorithm>
+
+void TargetIndex::reset(const int cols, const int rows) noexcept
+{
+    m_cols = cols;
+    m_rows = rows;
+    m_cellCols = (cols + CellSize - 1) / CellSize;
+    m_cellRows = (rows + CellSize - 1) / CellSize;
+
+    m_players.clear();
+    m_trackedUnits.clear();
+    m_changedCells.assign(m_cellCols * m_cellRows, true);
+}
+
+void TargetIndex::rebuild(const UnitCache &units, const int cols, const int rows) noexcept
+{
+    if (cols != m_cols || rows != m_rows) {
+        reset(cols, rows);
+    } else {
+        std::fill(m_changedCells.begin(), m_changedCells.end(), false);
+    }
+
+    const int cellCount = m_cellCols * m_cellRows;
+    if (IS_UNLIKELY(cellCount <= 0)) {
+        return;
+    }
+
+    for (PlayerCells &player : m_players) {
+        player.cellStart.assign(cellCount + 1, 0);
+    }
+
+    m_generation++;
+
+    // Straight from the packed arrays, without touching the units themselves
+    const std::vector<MapPos> &positions = units.positions();
+    const std::vector<int> &playerIds = units.playerIds();
+    const std::vector<UnitHandle> &handles = units.handles();
+
+    // Count how many go in each cell first, so we can put them straight in place after
+    m_unitCells.resize(units.size());
+    for (size_t i = 0; i < units.size(); i++) {
+        const int playerId = playerIds[i];
+        if (IS_UNLIKELY(playerId < 0)) {
+            m_unitCells[i].first = -1;
+            continue;
+        }
+
+        const int col = std::clamp(int(positions[i].x / Constants::TILE_SIZE), 0, m_cols - 1);
+        const int row = std::clamp(int(positions[i].y / Constants::TILE_SIZE), 0, m_rows - 1);
+        const int tile = row * m_cols + col;
+
+        const UnitHandle &handle = handles[i];
+        if (handle.index >= m_trackedUnits.size()) {
+            m_trackedUnits.resize(handle.index + 1);
+        }
+
+        TrackedUnit &tracked = m_trackedUnits[handle.index];
+        if (tracked.tile != tile || tracked.playerId != playerId || tracked.unitGeneration != handle.generation) {
+            if (tracked.tile >= 0) {
+                markChanged(tracked.tile);
+            }
+            markChanged(tile);
+
+            tracked.tile = tile;
+            tracked.playerId = playerId;
+            tracked.unitGeneration = handle.generation;
+        }
+        tracked.generation = m_generation;
+
+        if (playerId >= int(m_players.size())) {
+            m_players.resize(playerId + 1);
+            for (PlayerCells &player : m_players) {
+                if (player.cellStart.empty()) {
+                    player.cellStart.assign(cellCount + 1, 0);
+                }
+            }
+        }
+
+        const int cell = cellOfTile(tile);
+        m_unitCells[i] = { playerId, cell };
+        m_players[playerId].cellStart[cell + 1]++;
+    }
+
+    for (PlayerCells &player : m_players) {
+        for (int cell = 0; cell < cellCount; cell++) {
+            player.cellStart[cell + 1] += player.cellStart[cell];
+        }
+        player.units.resize(player.cellStart[cellCount]);
+    }
+
+    // Reuse the counts as where to put the next one, and shift back after
+    const std::vector<Unit*> &unitPointers = units.units();
+    for (size_t i = 0; i < units.size(); i++) {
+        const int playerId = m_unitCells[i].first;
+        if (playerId < 0) {
+            continue;
+        }
+        PlayerCells &player = m_players[playerId];
+        player.units[player.cellStart[m_unitCells[i].second]++] = unitPointers[i];
+    }
+    for (PlayerCells &player : m_players) {
+        for (int cell = cellCount; cell > 0; cell--) {
+            player.cellStart[cell] = player.cellStart[cell - 1];
+        }
+        player.cellStart[0] = 0;
+    }
+
+    // Everything that wasn't there this time is gone
+    for (TrackedUnit &tracked : m_trackedUnits) {
+        if (tracked.tile >= 0 && tracked.generation != m_generation) {
+            markChanged(tracked.tile);
+            tracked.tile = -1;
+            tracked.playerId = -1;
+        }
+    }
+}
+
+void TargetIndex::remove(const Unit *unit) noexcept
+{
+    for (PlayerCells &player : m_players) {
+        std::replace(player.units.begin(), player.units.end(), const_cast<Unit*>(unit), static_cast<Unit*>(nullptr));
+    }
+}
+
+bool TargetIndex::hasChangedAround(const MapPos &position, const float radius) const noexcept
+{
+    if (m_changedCells.empty()) {
+        return false;
+    }
+
+    int firstCol, firstRow, lastCol, lastRow;
+    cellsAround(position, radius, &firstCol, &firstRow, &lastCol, &lastRow);
+
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int col = firstCol; col <= lastCol; col++) {
+            if (m_changedCells[row * m_cellCols + col]) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void TargetIndex::cellsAround(const MapPos &position, const float radius, int *firstCol, int *firstRow, int *lastCol, int *lastRow) const noexcept
+{
+    // One tile extra, units might have moved a bit since the rebuild
+    const float cellSize = CellSize * Constants::TILE_SIZE;
+    const float range = radius + Constants::TILE_SIZE;
+
+    *firstCol = std::max(int((position.x - range) / cellSize), 0);
+    *firstRow = std::max(int((position.y - range) / cellSize), 0);
+    *lastCol = std::min(int((position.x + range) / cellSize), m_cellCols - 1);
+    *lastRow = std::min(int((position.y + range) / cellSize), m_cellRows - 1);
+}
+
+void TargetIndex::markChanged(const int tile) noexcept
+{
+    m_changedCells[cellOfTile(tile)] = true;
+}
@@ -0,0 +1,107 @@
+#ifndef TARGETINDEX_H
+#define TARGETINDEX_H
+
+#include "UnitCache.h"
+
+#include "core/Types.h"
+
+#include <cstdint>
+#include <vector>
+
+struct Unit;
+
+/// All the units bucketed by player and by coarse cells of the map, so units looking
+/// for something to attack only have to go through the units of the players they care
+/// about that are close by, instead of everything on every tile they can see.
+/// Rebuilt every tick, and keeps track of which cells had units move to another tile,
+/// appear, disappear or change owner since the previous rebuild, so idle units only
+/// need to look again when something changed around them.
+class TargetIndex
+{
+public:
+    /// In tiles
+    static constexpr int CellSize = 4;
+
+    /// Call after the dead units are cleaned out, they need to stay alive until the next rebuild
+    void rebuild(const UnitCache &units, const int cols, const int rows) noexcept;
+
+    /// For units removed between the rebuilds
+    void remove(const Unit *unit) noexcept;
+
+    /// If anything changed within the radius since the previous rebuild
+    bool hasChangedAround(const MapPos &position, const float radius) const noexcept;
+
+    int playerCount() const noexcept { return m_players.size(); }
+
+    /// Calls the callback with every unit owned by the player that might be within the
+    /// radius, the caller needs to check the actual distance
+    template<typename Callback>
+    inline void forEachUnitNear(const int playerId, const MapPos &position, const float radius, const Callback &callback) const noexcept {
+        if (playerId < 0 || playerId >= int(m_players.size())) {
+            return;
+        }
+
+        const PlayerCells &player = m_players[playerId];
+        if (player.units.empty()) {
+            return;
+        }
+
+        int firstCol, firstRow, lastCol, lastRow;
+        cellsAround(position, radius, &firstCol, &firstRow, &lastCol, &lastRow);
+
+        for (int row = firstRow; row <= lastRow; row++) {
+            for (int col = firstCol; col <= lastCol; col++) {
+                const int cell = row * m_cellCols + col;
+                for (int32_t i = player.cellStart[cell]; i < player.cellStart[cell + 1]; i++) {
+                    // Removed since the rebuild
+                    if (player.units[i]) {
+                        callback(player.units[i]);
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    struct PlayerCells {
+        // Where each cell starts in the units, one extra at the end
+        std::vector<int32_t> cellStart;
+        std::vector<Unit*> units;
+    };
+
+    struct TrackedUnit {
+        int32_t tile = -1;
+        int playerId = -1;
+
+        // Of the handle, in case the slot has been reused by another unit since
+        uint32_t unitGeneration = 0;
+
+        // Of the rebuild it was last seen in
+        uint32_t generation = 0;
+    };
+
+    void reset(const int cols, const int rows) noexcept;
+    void cellsAround(const MapPos &position, const float radius, int *firstCol, int *firstRow, int *lastCol, int *lastRow) const noexcept;
+    void markChanged(const int tile) noexcept;
+
+    inline int cellOfTile(const int tile) const noexcept {
+        return (tile / m_cols) / CellSize * m_cellCols + (tile % m_cols) / CellSize;
+    }
+
+    int m_cols = 0;
+    int m_rows = 0;
+    int m_cellCols = 0;
+    int m_cellRows = 0;
+
+    std::vector<PlayerCells> m_players;
+    std::vector<bool> m_changedCells;
+
+    // Where each unit was at the previous rebuild, by the index of its handle
+    std::vector<TrackedUnit> m_trackedUnits;
+    uint32_t m_generation = 0;
+
+    // Player and cell of each unit while rebuilding, kept around to avoid allocating every tick
+    std::vector<std::pair<int, int>> m_unitCells;
+};
+
+#endif // TARGETINDEX_H
@@ -122,20 +122,6 @@ bool Unit::update(Time time) noexcept
 
     bool updated = false;
 
-    if (m_prevTime) {
-        int timeDelta = time - m_prevTime;
-
-        if (targetBlinkTimeLeft) {
-            targetBlinkTimeLeft -= timeDelta;
-        }
-
-        if (targetBlinkTimeLeft < 0) {
-            targetBlinkTimeLeft = 0;
-        }
-    }
-
-    m_prevTime = time;
-
     for (Annex &annex : annexes) {
         updated = annex.unit->update(time) || updated;
     }
@@ -165,15 +151,63 @@ bool Unit::update(Time time) noexcept
         if (!m_currentAction || currentAction != m_currentAction || prevState != m_currentAction->unitState()) {
             updateGraphic();
         }
-        if (!m_currentAction) {
-            checkForAutoTargets();
-        }
     }
 
 
     return Entity::update(time) || updated;
 }
 
+bool Unit::needsUpdate() const noexcept
+{
+    if (m_currentAction || !m_actionQueue.empty()) {
+        return true;
+    }
+
+    // Includes the death animation
+    if (m_renderer->isAnimating()) {
+        return true;
+    }
+
+    for (const Annex &annex : annexes) {
+        if (annex.unit->needsUpdate()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void Unit::wakeUp() noexcept
+{
+    m_unitManager.wakeUp(this);
+}
+
+void Unit::startTargetBlink() noexcept
+{
+    m_unitManager.timers().cancel(m_targetBlinkTimer);
+
+    // 3 seconds, starting with it hidden
+    m_targetBlinksLeft = 6;
+    scheduleTargetBlink();
+}
+
+void Unit::scheduleTargetBlink() noexcept
+{
+    std::weak_ptr<Entity> weakThis = weak_from_this();
+    m_targetBlinkTimer = m_unitManager.timers().scheduleIn(500, [weakThis]() {
+        std::shared_ptr<Entity> entity = weakThis.lock();
+        if (!entity) {
+            return;
+        }
+
+        Unit *unit = static_cast<Unit*>(entity.get());
+        unit->m_targetBlinksLeft--;
+        if (unit->m_targetBlinksLeft > 0) {
+            unit->scheduleTargetBlink();
+        }
+    });
+}
+
 MapPos Unit::snapPositionToGrid(const MapPos &position, const MapPtr &map, const genie::Unit *data) noexcept
 {
     MapPos newPos = position;
@@ -269,8 +303,10 @@ void Unit::setCreationProgress(float progress) noexcept
     if (m_data->Type == genie::Unit::BuildingType && progress < m_data->Creatable.TrainTime) {
         m_renderer->setAngle(M_PI_2 + 2. * M_PI * (creationProgress()));
     } else {
-        m_renderer->setAngle(m_angle); // blarf
+        m_renderer->setAngle(angle()); // blarf
     }
+
+    wakeUp();
 }
 
 void Unit::increaseCreationProgress(float progress) noexcept
@@ -305,6 +341,7 @@ void Unit::takeDamage(const genie::unit::AttackOrArmor &attack, const float dama
     newDamage = std::max(newDamage, 1.f);
 
     m_damageTaken += newDamage;
+    wakeUp();
 
     if (hitpointsLeft() <= 0) {
         kill();
@@ -343,6 +380,7 @@ void Unit::kill() noexcept
 
     m_renderer->setPlaySounds(true);
     m_renderer->setGraphic(m_data->DyingGraphic);
+    wakeUp();
 
     if (data()->DyingSound != -1) {
         Player::Ptr owner = player.lock();
@@ -398,78 +436,78 @@ bool Unit::isDead() const noexcept
     return true;
 }
 
-void Unit::checkForAutoTargets() noexcept
+bool Unit::findAutoTarget(Task *task, Ptr *target) const noexcept
 {
     if (stance != Stance::Aggressive || m_autoTargetTasks.empty() || m_currentAction) {
-        return;
-    }
-    MapPtr map = m_map.lock();
-    if (!map) {
-        WARN << "no map";
-        return;
+        return false;
     }
 
     const int los = data()->LineOfSight;
 
     Task newTask;
-    Unit::Ptr target;
-
-
-    const int left = position().x / Constants::TILE_SIZE - los;
-    const int top = position().y / Constants::TILE_SIZE - los;
-    const int right = position().x / Constants::TILE_SIZE + los;
-    const int bottom = position().y / Constants::TILE_SIZE + los;
+    Unit::Ptr newTarget;
 
     float closestDistance = los * Constants::TILE_SIZE;
-    const std::vector<std::weak_ptr<Entity>> entities = map->entitiesBetween(left, top, right, bottom);
-    for (size_t i=0; i<entities.size(); i++) {
-        Unit::Ptr other = Unit::fromEntity(entities[i]);
-        if (!other) {
-            continue;
-        }
+    const Player::Ptr owner = player.lock();
+    if (!owner) {
+        return false;
+    }
 
-        if (other->id == this->id) {
+    const TargetIndex &targetIndex = m_unitManager.targetIndex();
+    for (int targetPlayer = 0; targetPlayer < targetIndex.playerCount(); targetPlayer++) {
+        // I don't think we should auto-target gaia units?
+        if (targetPlayer == UnitManager::GaiaID) {
             continue;
         }
-        if (other->playerId == UnitManager::GaiaID) {
-            // I don't think we should auto-target gaia units?
+        if (targetPlayer == playerId && !m_autoTargetsOwnUnits) {
             continue;
         }
 
-        const float distance = other->position().distance(position());
+        targetIndex.forEachUnitNear(targetPlayer, position(), closestDistance, [&](Unit *candidate) {
+            if (candidate->id == this->id) {
+                return;
+            }
 
-        if (distance > closestDistance) {
-            continue;
-        }
+            const float distance = candidate->position().distance(position());
+            if (distance > closestDistance) {
+                return;
+            }
 
-        Task potentialTask;
-        potentialTask = IAction::findMatchingTask(player.lock(), other, m_autoTargetTasks);
-        if (!potentialTask.data) {
-            continue;
-        }
+            Unit::Ptr other = Unit::fromEntity(candidate->weak_from_this());
+            Task potentialTask;
+            potentialTask = IAction::findMatchingTask(owner, other, m_autoTargetTasks);
+            if (!potentialTask.data) {
+                return;
+            }
 
-        // TODO: should only prefer civilians (and I think only wolves? lions?)
-        // should attack others as well
-        // Maybe check combat level instead? but then suddenly we get wolves trying to find a path to ships
-        if (potentialTask.data->ActionType == genie::ActionType::Combat && data()->Class == genie::Unit::PredatorAnimal) {
-            if (other->data()->Creatable.CreatableType != genie::unit::Creatable::VillagerType) {
-                continue;
+            // TODO: should only prefer civilians (and I think only wolves? lions?)
+            // should attack others as well
+            // Maybe check combat level instead? but then suddenly we get wolves trying to find a path to ships
+            if (potentialTask.data->ActionType == genie::ActionType::Combat && data()->Class == genie::Unit::PredatorAnimal) {
+                if (other->data()->Creatable.CreatableType != genie::unit::Creatable::VillagerType) {
+                    return;
+                }
             }
-        }
 
-        if (potentialTask.data) {
             newTask = potentialTask;
-            target = other;
+            newTarget = other;
             closestDistance = distance;
-        }
+        });
     }
 
-    if (!newTask.data || !target) {
-        return;
+    if (!newTask.data || !newTarget) {
+        return false;
     }
 
-    DBG << "found auto task" << newTask.data->actionTypeName() << "for" << debugName;
-    IAction::assignTask(newTask, Unit::fromEntity(shared_from_this()), target);
+    *task = newTask;
+    *target = std::move(newTarget);
+    return true;
+}
+
+void Unit::startAutoTask(const Task &task, const Ptr &target) noexcept
+{
+    DBG << "found auto task" << task.data->actionTypeName() << "for" << debugName;
+    IAction::assignTask(task, Unit::fromEntity(shared_from_this()), target);
 }
 
 std::unordered_set<Task> Unit::availableActions() noexcept
@@ -553,6 +591,7 @@ void Unit::setPosition(const MapPos &pos, const bool initial) noexcept
     }
 
     Entity::setPosition(pos, initial);
+    m_unitManager.unitCache().setPosition(m_cacheHandle, pos);
 
     if (owner) {
         forEachVisibleTile([&](const int tileX, const int tileY) {
@@ -563,10 +602,6 @@ void Unit::setPosition(const MapPos &pos, const bool initial) noexcept
     for (Annex &annex : annexes) {
         annex.unit->setPosition(pos + annex.offset, initial);
     }
-
-    if (data()->Type >= genie::Unit::CombatantType) {
-        m_unitManager.onCombatantUnitsMoved();
-    }
 }
 
 void Unit::setUnitData(const genie::Unit &data_) noexcept
@@ -585,11 +620,23 @@ void Unit::setUnitData(const genie::Unit &data_) noexcept
     m_renderer->setGraphic(defaultGraphics);
 
     m_autoTargetTasks.clear();
+    m_autoTargetsOwnUnits = false;
     for (const Task &task : availableActions()) {
         if (!task.data->EnableTargeting) {
             continue;
         }
         m_autoTargetTasks.insert(task);
+
+        switch(task.data->TargetDiplomacy) {
+        case genie::Task::TargetNeutralsEnemies:
+        case genie::Task::TargetGaiaNeutralEnemies:
+        case genie::Task::TargetOthers:
+        case genie::Task::TargetGaiaOnly:
+            break;
+        default:
+            m_autoTargetsOwnUnits = true;
+            break;
+        }
     }
 }
 
@@ -668,6 +715,8 @@ int Unit::taskGraphicId(const genie::ActionType taskType, const IAction::UnitSta
 
 void Unit::updateGraphic()
 {
+    m_unitManager.unitCache().setAction(m_cacheHandle, m_currentAction.get());
+
     if (hitpointsLeft() <= 0 && !isDying()) {
         m_renderer->setGraphic(m_data->DyingGraphic);
         return;
@@ -732,6 +781,7 @@ void Unit::prependAction(const ActionPtr &action) noexcept
     m_actionQueue.push_front(std::move(m_currentAction));
     m_currentAction = action;
     updateGraphic();
+    wakeUp();
 }
 
 void Unit::queueAction(const ActionPtr &action) noexcept
@@ -746,7 +796,11 @@ void Unit::queueAction(const ActionPtr &action) noexcept
 void Unit::setCurrentAction(const ActionPtr &action) noexcept
 {
     m_currentAction = action;
+    wakeUp();
 
+    if (!action && m_actionQueue.empty()) {
+        m_becameIdle = true;
+    }
 
     Player::Ptr owner = player.lock();
     if (!owner) {
@@ -786,7 +840,9 @@ void Unit::clearActionQueue() noexcept
 {
     m_actionQueue.clear();
     m_currentAction.reset();
+    m_becameIdle = true;
     updateGraphic();
+    wakeUp();
 }
 
 
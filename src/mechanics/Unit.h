@@ -28,9 +28,11 @@
 #include <vector>
 
 #include "Entity.h"
+#include "UnitCache.h"
 #include "actions/IAction.h"
 #include "core/Constants.h"
 #include "core/ResourceMap.h"
+#include "core/TimerWheel.h"
 #include "core/Types.h"
 
 class UnitManager;
@@ -75,6 +77,7 @@ struct Unit : public Entity
         Archer = 4,
 
         Barracks = 12,
+        Militia = 74,
         Monastery = 104,
         SiegeWorkshop = 49,
         Stable = 101,
@@ -111,13 +114,16 @@ struct Unit : public Entity
         NoAttack
     } stance = Stance::Aggressive;
 
-    // The blinking animation thing when it is selected as a target
-    int targetBlinkTimeLeft = 0;
-
     static std::shared_ptr<Unit> fromEntity(const EntityPtr &entity) noexcept;
     static inline std::shared_ptr<Unit> fromEntity(const std::weak_ptr<Entity> &entity) noexcept {
         return fromEntity(entity.lock());
     }
+    static inline Unit *fromEntity(Entity &entity) noexcept {
+        if (!entity.isUnit()) {
+            return nullptr;
+        }
+        return static_cast<Unit*>(&entity);
+    }
 
     Unit() = delete;
     Unit(const Unit &unit) = delete;
@@ -139,12 +145,20 @@ struct Unit : public Entity
 
     bool update(Time time) noexcept override;
 
+    /// If there is anything going on that needs it to be updated every tick,
+    /// otherwise it is left to sleep until something wakes it up again
+    virtual bool needsUpdate() const noexcept;
+
+    /// Puts it back with the units that are updated every tick, if it was sleeping
+    void wakeUp() noexcept;
+
     const std::vector<const genie::Unit *> creatableUnits() noexcept;
 
     static std::shared_ptr<Building> asBuilding(const Unit::Ptr &unit) noexcept;
 
     bool selected = false;
-    int playerId;
+    /// Never changes, the UnitCache copies it once when the unit is added
+    const int playerId;
     std::weak_ptr<Player> player;
     std::vector<Annex> annexes;
 
@@ -153,8 +167,16 @@ struct Unit : public Entity
     virtual ScreenRect rect() const noexcept;
     virtual bool checkClick(const ScreenPos &pos) const noexcept;
 
+    /// The blinking animation thing when it is selected as a target
+    void startTargetBlink() noexcept;
+    bool isTargetBlinkShown() const noexcept { return m_targetBlinksLeft % 2 == 1; }
+
     bool hasAutoTargets() const noexcept { return !m_autoTargetTasks.empty(); }
-    void checkForAutoTargets() noexcept;
+
+    /// Doesn't change anything so it can be done for many units at the same time,
+    /// UnitManager starts the task afterwards. Returns false if there's nothing to go for.
+    bool findAutoTarget(Task *task, Ptr *target) const noexcept;
+    void startAutoTask(const Task &task, const Ptr &target) noexcept;
     std::unordered_set<Task> availableActions() noexcept;
     Task findMatchingTask(const genie::ActionType &m_type, int targetUnit) noexcept;
     Size selectionSize() const noexcept;
@@ -218,13 +240,30 @@ protected:
 
     std::unordered_set<Task> m_autoTargetTasks;
 
+    // If any of the auto target tasks can be used on our own units, so we know if we need to look at them
+    bool m_autoTargetsOwnUnits = false;
+
     float m_creationProgress = 0.f;
 
     UnitManager &m_unitManager;
 
     float m_damageTaken = 0.f;
-    Time m_prevTime = 0;
     float m_angle = 0.f;
+
+private:
+    friend class UnitManager;
+
+    UnitHandle m_cacheHandle;
+    bool m_isActive = false;
+    /// Set when it runs out of things to do, so it looks for auto targets
+    /// even if nothing changed around it
+    bool m_becameIdle = true;
+
+    void scheduleTargetBlink() noexcept;
+
+    // Every 500ms, shown when odd
+    int m_targetBlinksLeft = 0;
+    TimerHandle m_targetBlinkTimer;
 };
 
 
@@ -0,0 +1,85 @@
+#include "UnitCache.h"
+
+#include "Unit.h"
+
+#include "core/Logger.h"
+
+UnitHandle UnitCache::add(Unit *unit) noexcept
+{
+    UnitHandle handle;
+    if (!m_freeSlots.empty()) {
+        handle.index = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    } else {
+        handle.index = m_slots.size();
+        m_slots.emplace_back();
+    }
+
+    Slot &slot = m_slots[handle.index];
+    handle.generation = slot.generation;
+    slot.position = m_units.size();
+
+    m_units.push_back(unit);
+    m_handles.push_back(handle);
+    m_positions.push_back(unit->position());
+    m_playerIds.push_back(unit->playerId);
+    m_actionTypes.push_back(IAction::Type::None);
+
+    setAction(handle, unit->currentAction().get());
+
+    return handle;
+}
+
+void UnitCache::remove(const UnitHandle handle) noexcept
+{
+    if (!slotFor(handle)) {
+        WARN << "Trying to remove unit that isn't here";
+        return;
+    }
+
+    Slot &slot = m_slots[handle.index];
+    const uint32_t position = slot.position;
+    const uint32_t last = m_units.size() - 1;
+
+    // Move the last one into the hole so everything stays packed
+    if (position != last) {
+        m_units[position] = m_units[last];
+        m_handles[position] = m_handles[last];
+        m_positions[position] = m_positions[last];
+        m_playerIds[position] = m_playerIds[last];
+        m_actionTypes[position] = m_actionTypes[last];
+
+        m_slots[m_handles[position].index].position = position;
+    }
+
+    m_units.pop_back();
+    m_handles.pop_back();
+    m_positions.pop_back();
+    m_playerIds.pop_back();
+    m_actionTypes.pop_back();
+
+    // Make any handles still around for it invalid
+    slot.generation++;
+    slot.position = UnitHandle::InvalidIndex;
+    m_freeSlots.push_back(handle.index);
+}
+
+Unit *UnitCache::get(const UnitHandle handle) const noexcept
+{
+    const Slot *slot = slotFor(handle);
+    if (!slot) {
+        return nullptr;
+    }
+
+    return m_units[slot->position];
+}
+
+void UnitCache::setAction(const UnitHandle handle, const IAction *action) noexcept
+{
+    const Slot *slot = slotFor(handle);
+    if (!slot) {
+        return;
+    }
+
+    m_actionTypes[slot->position] = action ? action->type : IAction::Type::None;
+}
@@ -0,0 +1,93 @@
+#ifndef UNITCACHE_H
+#define UNITCACHE_H
+
+#include "actions/IAction.h"
+#include "core/Types.h"
+#include "core/Utility.h"
+
+#include <cstdint>
+#include <vector>
+
+struct Unit;
+
+/// Refers to a unit in the UnitCache, stays valid until the unit is removed.
+/// Slots are reused, so the generation is what tells an old handle apart from the new unit.
+struct UnitHandle
+{
+    static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+    uint32_t index = InvalidIndex;
+    uint32_t generation = 0;
+
+    inline bool isValid() const noexcept { return index != InvalidIndex; }
+
+    inline bool operator==(const UnitHandle &other) const noexcept {
+        return index == other.index && generation == other.generation;
+    }
+    inline bool operator!=(const UnitHandle &other) const noexcept { return !(*this == other); }
+};
+
+/// Read only copies of what the loops over all the units look at every tick (TargetIndex
+/// and picking out the moving units), in packed arrays that all have the units in the same
+/// order, so going through all of them doesn't have to chase a pointer to each unit.
+/// The units own their state, and update these whenever it changes, so it is the same
+/// for the ones that are sleeping.
+class UnitCache
+{
+public:
+    UnitHandle add(Unit *unit) noexcept;
+    void remove(const UnitHandle handle) noexcept;
+
+    /// nullptr if it has been removed since the handle was made
+    Unit *get(const UnitHandle handle) const noexcept;
+
+    /// Called when the graphic is picked, which happens every time the action or its state changes
+    void setAction(const UnitHandle handle, const IAction *action) noexcept;
+
+    /// From Unit::setPosition, which is the only way a unit moves
+    inline void setPosition(const UnitHandle handle, const MapPos &position) noexcept {
+        const Slot *slot = slotFor(handle);
+        if (slot) {
+            m_positions[slot->position] = position;
+        }
+    }
+
+    size_t size() const noexcept { return m_units.size(); }
+
+    // The order changes when units are removed
+    const std::vector<Unit*> &units() const noexcept { return m_units; }
+    const std::vector<UnitHandle> &handles() const noexcept { return m_handles; }
+    const std::vector<MapPos> &positions() const noexcept { return m_positions; }
+    const std::vector<int> &playerIds() const noexcept { return m_playerIds; }
+    const std::vector<IAction::Type> &actionTypes() const noexcept { return m_actionTypes; }
+
+private:
+    struct Slot {
+        uint32_t generation = 0;
+
+        // Where in the arrays, InvalidIndex when free
+        uint32_t position = UnitHandle::InvalidIndex;
+    };
+
+    inline const Slot *slotFor(const UnitHandle handle) const noexcept {
+        if (IS_UNLIKELY(handle.index >= m_slots.size())) {
+            return nullptr;
+        }
+        const Slot &slot = m_slots[handle.index];
+        if (slot.generation != handle.generation || slot.position == UnitHandle::InvalidIndex) {
+            return nullptr;
+        }
+        return &slot;
+    }
+
+    std::vector<Slot> m_slots;
+    std::vector<uint32_t> m_freeSlots;
+
+    std::vector<Unit*> m_units;
+    std::vector<UnitHandle> m_handles;
+    std::vector<MapPos> m_positions;
+    std::vector<int> m_playerIds;
+    std::vector<IAction::Type> m_actionTypes;
+};
+
+#endif // UNITCACHE_H
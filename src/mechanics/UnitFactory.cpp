@@ -200,7 +200,7 @@ DecayingEntity::Ptr UnitFactory::createCorpseFor(const Unit::Ptr &unit)
         DBG << "decaying forever";
         decayTime = std::numeric_limits<float>::infinity();
     }
-    DecayingEntity::Ptr corpse = std::make_shared<DecayingEntity>(corpseData.StandingGraphic.first, decayTime);
+    DecayingEntity::Ptr corpse = unit->unitManager().createDecayingEntity(corpseData.StandingGraphic.first, decayTime);
     corpse->renderer().setPlayerColor(owner->playerColor);
     corpse->setPosition(unit->position());
     corpse->renderer().setAngle(unit->angle());
@@ -30,10 +30,13 @@
 #include "actions/ActionMove.h"
 #include "audio/AudioPlayer.h"
 #include "core/Constants.h"
+#include "core/JobSystem.h"
 #include "core/Logger.h"
 #include "core/Utility.h"
 #include "global/EventManager.h"
 #include "mechanics/Player.h"
+#include "pathfinding/PathfinderPool.h"
+#include "render/GraphicRender.h"
 #include "render/SfmlRenderTarget.h"
 #include "Map.h"
 
@@ -51,19 +54,60 @@
 #include <SFML/Graphics/RenderTexture.hpp>
 
 #include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <unordered_map>
 #include <utility>
 
 namespace genie {
 class Tech;
 }  // namespace genie
 
-UnitManager::UnitManager()
+// How many units each job thread takes at a time in the parts of the update that are done in parallel
+static const int UNITS_PER_JOB = 16;
+
+UnitManager::UnitManager() :
+    m_resourceIndex(this)
 {
     m_outlineOverlay = std::make_unique<sf::RenderTexture>();
 }
 
 UnitManager::~UnitManager()
 {
+    const ObjectPool<Missile>::Stats &missiles = m_missilePool.stats();
+    DBG << "Missiles created:" << missiles.created << "allocated:" << missiles.heapAllocations << "peak:" << missiles.peakAlive;
+
+    const ObjectPool<DecayingEntity>::Stats &decaying = m_decayingEntityPool.stats();
+    DBG << "Decaying entities created:" << decaying.created << "allocated:" << decaying.heapAllocations << "peak:" << decaying.peakAlive;
+}
+
+Missile::Ptr UnitManager::createMissile(const genie::Unit &data, const Unit::Ptr &sourceUnit, const MapPos &target, const Unit::Ptr &targetUnit)
+{
+    return m_missilePool.create(data, sourceUnit, target, targetUnit);
+}
+
+DecayingEntity::Ptr UnitManager::createDecayingEntity(const int graphicId, const float decayTime)
+{
+    return m_decayingEntityPool.create(graphicId, decayTime);
+}
+
+void UnitManager::addDecayingEntity(const DecayingEntity::Ptr &entity)
+{
+    m_decayingEntities.push_back(entity);
+
+    // Smoke trails and such are just there until the animation is done
+    const float decayTime = entity->decayTime();
+    if (decayTime <= 0 || std::isinf(decayTime)) {
+        return;
+    }
+
+    std::weak_ptr<DecayingEntity> weakEntity = entity;
+    m_timers.scheduleIn(gameSecondsToMs(decayTime), [weakEntity]() {
+        DecayingEntity::Ptr entity = weakEntity.lock();
+        if (entity) {
+            entity->setDecayTimeEnded();
+        }
+    });
 }
 
 void UnitManager::add(const Unit::Ptr &unit)
@@ -74,6 +118,8 @@ void UnitManager::add(const Unit::Ptr &unit)
     }
     unit->setMap(m_map);
     m_units.push_back(unit);
+    unit->m_cacheHandle = m_unitCache.add(unit.get());
+    wakeUp(unit.get());
     if (unit->hasAutoTargets()) {
         m_unitsWithActions.insert(unit);
     }
@@ -90,15 +136,43 @@ void UnitManager::remove(const Unit::Ptr &unit)
     }
 
     m_unitsWithActions.erase(unit);
+    m_targetIndex.remove(unit.get());
 
     UnitVector::iterator it = std::find(m_units.begin(), m_units.end(), unit);
     if (it != m_units.end()) {
         EventManager::unitDying(unit.get()); // not sure about this, but whatever
+        removeFromCache(*unit);
         m_units.erase(it);
     }
     // TODO: EventManager::unitDisappeared(), we need to check the visibility maps
 }
 
+void UnitManager::removeFromCache(Unit &unit)
+{
+    m_unitCache.remove(unit.m_cacheHandle);
+    unit.m_cacheHandle = UnitHandle();
+
+    if (unit.m_isActive) {
+        unit.m_isActive = false;
+        std::vector<Unit*>::iterator it = std::find(m_activeUnits.begin(), m_activeUnits.end(), &unit);
+        if (it != m_activeUnits.end()) {
+            *it = m_activeUnits.back();
+            m_activeUnits.pop_back();
+        }
+    }
+}
+
+void UnitManager::wakeUp(Unit *unit) noexcept
+{
+    // If it isn't added yet add() wakes it up
+    if (unit->m_isActive || !unit->m_cacheHandle.isValid()) {
+        return;
+    }
+
+    unit->m_isActive = true;
+    m_activeUnits.push_back(unit);
+}
+
 bool UnitManager::init()
 {
     m_moveTargetMarker = std::make_unique<MoveTargetMarker>();
@@ -111,37 +185,38 @@ bool UnitManager::update(Time time)
 {
     bool updated = false;
 
-    if (m_unitsMoved) {
-        m_unitsMoved = false;
+    PathfinderPool::Inst().beginFrame();
+    Entity::beginSimulationTick();
 
-        for (const Unit::Ptr &unit : m_unitsWithActions) {
-            unit->checkForAutoTargets();
-        }
-    }
+    updated = m_timers.advanceTo(time) || updated;
 
     // Update missiles (siege rockthings, arrows, etc.)
-    std::unordered_set<Missile::Ptr>::iterator missileIterator = m_missiles.begin();
-    while (missileIterator != m_missiles.end()) {
-        const Missile::Ptr &missile = *missileIterator;
-        updated = missile->update(time) || updated;
-        if (!missile->isFlying() && !missile->isExploding()) {
-            missileIterator = m_missiles.erase(missileIterator);
+    // The order doesn't matter, so the finished ones are swapped with the last one and popped off
+    size_t missileIndex = 0;
+    while (missileIndex < m_missiles.size()) {
+        Missile &missile = *m_missiles[missileIndex];
+        updated = missile.update(time) || updated;
+        if (!missile.isFlying() && !missile.isExploding()) {
+            m_missiles[missileIndex] = std::move(m_missiles.back());
+            m_missiles.pop_back();
             updated = true;
         } else {
-            missileIterator++;
+            missileIndex++;
         }
     }
 
     // Update decaying entities (smoke stuff from siege, corpses, etc.)
-    std::unordered_set<DecayingEntity::Ptr>::iterator decayingEntityIterator = m_decayingEntities.begin();
-    while (decayingEntityIterator != m_decayingEntities.end()) {
-        const DecayingEntity::Ptr &entity = *decayingEntityIterator;
-        updated = entity->update(time) || updated;
-        if (!entity->decaying()) {
-            decayingEntityIterator = m_decayingEntities.erase(decayingEntityIterator);
+    // Missiles add smoke trails above, but nothing here adds any
+    size_t decayingEntityIndex = 0;
+    while (decayingEntityIndex < m_decayingEntities.size()) {
+        DecayingEntity &entity = *m_decayingEntities[decayingEntityIndex];
+        updated = entity.update(time) || updated;
+        if (!entity.decaying()) {
+            m_decayingEntities[decayingEntityIndex] = std::move(m_decayingEntities.back());
+            m_decayingEntities.pop_back();
             updated = true;
         } else {
-            decayingEntityIterator++;
+            decayingEntityIndex++;
         }
     }
 
@@ -164,10 +239,11 @@ bool UnitManager::update(Time time)
 
             DecayingEntity::Ptr corpse = UnitFactory::Inst().createCorpseFor(unit);
             if (corpse) {
-                m_decayingEntities.insert(corpse);
+                addDecayingEntity(corpse);
                 updated = true;
             }
             m_unitsWithActions.erase(unit);
+            removeFromCache(*unit);
 
             unitIterator = m_units.erase(unitIterator);
         } else {
@@ -175,9 +251,26 @@ bool UnitManager::update(Time time)
         }
     }
 
-    // Update the living units that are left
-    for (const Unit::Ptr &unit : m_units) {
+    m_targetIndex.rebuild(m_unitCache, m_map->getCols(), m_map->getRows());
+    findAutoTargets();
+
+    thinkMovement(time);
+
+    // Update the units that have something going on, the rest are sleeping until something wakes them up.
+    // By index because buildings add the units they finish, and units wake each other up.
+    size_t activeIndex = 0;
+    while (activeIndex < m_activeUnits.size()) {
+        Unit *unit = m_activeUnits[activeIndex];
         updated = unit->update(time) || updated;
+
+        if (unit->needsUpdate()) {
+            activeIndex++;
+            continue;
+        }
+
+        unit->m_isActive = false;
+        m_activeUnits[activeIndex] = m_activeUnits.back();
+        m_activeUnits.pop_back();
     }
 
     updated = m_moveTargetMarker->update(time) || updated;
@@ -185,7 +278,79 @@ bool UnitManager::update(Time time)
     return updated;
 }
 
-void UnitManager::render(const std::shared_ptr<SfmlRenderTarget> &renderTarget, const std::vector<std::weak_ptr<Entity>> &visible)
+void UnitManager::findAutoTargets()
+{
+    // Only the ones that have had something change around them, or just ran out of
+    // things to do, need to look for new targets
+    m_autoTargets.clear();
+    for (const Unit::Ptr &unit : m_unitsWithActions) {
+        const bool becameIdle = unit->m_becameIdle;
+        unit->m_becameIdle = false;
+
+        if (becameIdle || m_targetIndex.hasChangedAround(unit->position(), unit->data()->LineOfSight * Constants::TILE_SIZE)) {
+            AutoTarget autoTarget;
+            autoTarget.unit = unit.get();
+            m_autoTargets.push_back(std::move(autoTarget));
+        }
+    }
+
+    JobSystem::Inst().parallelFor(int(m_autoTargets.size()), UNITS_PER_JOB, [this](const int begin, const int end) {
+        for (int i = begin; i < end; i++) {
+            AutoTarget &autoTarget = m_autoTargets[i];
+            if (!autoTarget.unit->findAutoTarget(&autoTarget.task, &autoTarget.target)) {
+                autoTarget.target.reset();
+            }
+        }
+    });
+
+    // Assigning a task only changes the unit itself, so this is the same as if each had looked right before
+    for (const AutoTarget &autoTarget : m_autoTargets) {
+        if (autoTarget.target) {
+            autoTarget.unit->startAutoTask(autoTarget.task, autoTarget.target);
+        }
+    }
+
+    m_autoTargets.clear();
+}
+
+void UnitManager::thinkMovement(const Time time)
+{
+    m_movingActions.clear();
+    const std::vector<Unit*> &units = m_unitCache.units();
+    const std::vector<IAction::Type> &actionTypes = m_unitCache.actionTypes();
+    for (size_t i = 0; i < units.size(); i++) {
+        if (actionTypes[i] != IAction::Type::Move || !units[i]->m_isActive) {
+            continue;
+        }
+
+        const ActionPtr &action = units[i]->currentAction();
+        if (IS_LIKELY(action && action->type == IAction::Type::Move)) {
+            m_movingActions.push_back(static_cast<ActionMove*>(action.get()));
+        }
+    }
+
+    // They only look at where the others are and how fast they were going in the last tick,
+    // the updates that move them come after all of them are done.
+    // Nothing in here may change the map, the passability or any other unit, that's what
+    // makes it safe to run on the job threads.
+    const uint32_t passabilityRevision = m_map->passability().revision();
+
+    JobSystem::Inst().parallelFor(int(m_movingActions.size()), UNITS_PER_JOB, [this, time](const int begin, const int end) {
+        for (int i = begin; i < end; i++) {
+            m_movingActions[i]->think(time);
+        }
+    });
+
+    // Means something in there broke the rule above, and what they came up with depends on the timing
+    if (IS_UNLIKELY(m_map->passability().revision() != passabilityRevision)) {
+        WARN << "passability changed while the units were thinking, doing it again on the main thread";
+        for (ActionMove *action : m_movingActions) {
+            action->think(time);
+        }
+    }
+}
+
+void UnitManager::render(const std::shared_ptr<SfmlRenderTarget> &renderTarget, const int firstCol, const int firstRow, const int lastCol, const int lastRow, const float interpolation)
 {
     Player::Ptr humanPlayer = m_humanPlayer.lock();
     if (!humanPlayer) {
@@ -195,6 +360,9 @@ void UnitManager::render(const std::shared_ptr<SfmlRenderTarget> &renderTarget,
 
     CameraPtr camera = renderTarget->camera();
 
+    // Sleeping units aren't updated, their animations are drawn as they are at the last tick
+    const Time now = m_timers.now();
+
     if (Size(m_outlineOverlay->getSize()) != renderTarget->getSize()) {
         m_outlineOverlay->create(renderTarget->getSize().width, renderTarget->getSize().height);
     }
@@ -214,78 +382,69 @@ void UnitManager::render(const std::shared_ptr<SfmlRenderTarget> &renderTarget,
 
     std::vector<Unit::Ptr> visibleUnits;
     std::vector<Missile::Ptr> visibleMissiles;
-    for (const std::weak_ptr<Entity> &e : visible) {
-        std::shared_ptr<Entity> entity = e.lock();
-        if (!entity) {
-            WARN << "got dead entity";
-            continue;
-        }
-
-        const VisibilityMap::Visibility visibility = humanPlayer->visibility->visibilityAt(entity->position());
+    m_map->forEachEntityBetween(firstCol, firstRow, lastCol, lastRow, [&](Entity &entity) {
+        const VisibilityMap::Visibility visibility = humanPlayer->visibility->visibilityAt(entity.position());
         if (visibility == VisibilityMap::Unexplored) {
-            continue;
+            return;
         }
 
-        if (entity->isUnit()) {
-            Unit::Ptr unit = Unit::fromEntity(entity);
-
+        if (entity.isUnit()) {
             if (visibility == VisibilityMap::Visible) {
-                entity->isVisible = true;
-                visibleUnits.push_back(unit);
-                entity->renderer().render(*renderTarget->renderTarget_, camera->absoluteScreenPos(entity->position()), RenderType::Shadow);
+                entity.isVisible = true;
+                visibleUnits.push_back(Unit::fromEntity(entity.weak_from_this()));
+                entity.renderer().render(*renderTarget->renderTarget_, camera->absoluteScreenPos(entity.renderPosition(interpolation)), RenderType::Shadow, now);
 
-                continue;
+                return;
             }
 
-            if (visibility != VisibilityMap::Explored || !unit->data()->FogVisibility) {
-                continue;
+            if (visibility != VisibilityMap::Explored || !Unit::fromEntity(entity)->data()->FogVisibility) {
+                return;
             }
 
-            entity->isVisible = true;
+            entity.isVisible = true;
 
-            entity->renderer().render(*renderTarget->renderTarget_, camera->absoluteScreenPos(entity->position()), RenderType::InTheShadows);
+            entity.renderer().render(*renderTarget->renderTarget_, camera->absoluteScreenPos(entity.renderPosition(interpolation)), RenderType::InTheShadows, now);
 
-            continue;
+            return;
         }
 
-        if (entity->isMissile()) {
-            Missile::Ptr missile = Entity::asMissile(entity);
+        if (entity.isMissile()) {
             if (visibility != VisibilityMap::Visible) {;// && missile->playerId != GaiaID) {
-                continue;
+                return;
             }
 
-            entity->isVisible = true;
+            entity.isVisible = true;
 
-            MapPos shadowPosition = entity->position();
+            MapPos shadowPosition = entity.renderPosition(interpolation);
             shadowPosition.z = m_map->elevationAt(shadowPosition);
-            entity->renderer().render(*renderTarget->renderTarget_, camera->absoluteScreenPos(shadowPosition), RenderType::Shadow);
+            entity.renderer().render(*renderTarget->renderTarget_, camera->absoluteScreenPos(shadowPosition), RenderType::Shadow, now);
 
-            visibleMissiles.push_back(missile);
+            visibleMissiles.push_back(Entity::asMissile(entity.weak_from_this().lock()));
 
-            continue;
+            return;
         }
 
-        if (entity->isDecayingEntity() || entity->isDoppleganger()) {
+        if (entity.isDecayingEntity() || entity.isDoppleganger()) {
             if (visibility == VisibilityMap::Visible) {
-                entity->renderer().render(*renderTarget->renderTarget_, camera->absoluteScreenPos(entity->position()), RenderType::Base);
+                entity.renderer().render(*renderTarget->renderTarget_, camera->absoluteScreenPos(entity.position()), RenderType::Base, now);
             } else {
-                entity->renderer().render(*renderTarget->renderTarget_, camera->absoluteScreenPos(entity->position()), RenderType::InTheShadows);
+                entity.renderer().render(*renderTarget->renderTarget_, camera->absoluteScreenPos(entity.position()), RenderType::InTheShadows, now);
             }
 
-            entity->isVisible = true;
+            entity.isVisible = true;
         }
-    }
+    });
     std::sort(visibleUnits.begin(), visibleUnits.end(), MapPositionSorter());
 
 
     m_outlineOverlay->clear(sf::Color::Transparent);
 
     for (const Unit::Ptr &unit : visibleUnits) {
-        const ScreenPos unitPosition = camera->absoluteScreenPos(unit->position());
+        const ScreenPos unitPosition = camera->absoluteScreenPos(unit->renderPosition(interpolation));
         if (!(unit->data()->OcclusionMode & genie::Unit::OccludeOthers)) {
-            unit->renderer().render(*m_outlineOverlay, unitPosition, RenderType::Outline);
+            unit->renderer().render(*m_outlineOverlay, unitPosition, RenderType::Outline, now);
         } else {
-            unit->renderer().render(*m_outlineOverlay, unitPosition, RenderType::BuildingAlpha);
+            unit->renderer().render(*m_outlineOverlay, unitPosition, RenderType::BuildingAlpha, now);
 
         }
     }
@@ -293,9 +452,7 @@ void UnitManager::render(const std::shared_ptr<SfmlRenderTarget> &renderTarget,
 
     for (const Unit::Ptr &unit : visibleUnits) {
 
-        const bool blinkingAsTarget = unit->targetBlinkTimeLeft > 0 &&
-                (((unit->targetBlinkTimeLeft) / 500) % 2 == 0) &&
-                !unit->isDead() && !unit->isDying();
+        const bool blinkingAsTarget = unit->isTargetBlinkShown() && !unit->isDead() && !unit->isDying();
 
         if (blinkingAsTarget || m_selectedUnits.count(unit)) {
             sf::RectangleShape rect;
@@ -318,11 +475,11 @@ void UnitManager::render(const std::shared_ptr<SfmlRenderTarget> &renderTarget,
             rect.setOutlineColor(sf::Color::White);
             rect.setOutlineThickness(1);
             rect.setSize(unit->rect().size());
-            rect.setPosition(camera->absoluteScreenPos(unit->position()) + unit->rect().topLeft());
+            rect.setPosition(camera->absoluteScreenPos(unit->renderPosition(interpolation)) + unit->rect().topLeft());
             m_outlineOverlay->draw(rect);
 #endif
 
-            ScreenPos pos = camera->absoluteScreenPos(unit->position());
+            ScreenPos pos = camera->absoluteScreenPos(unit->renderPosition(interpolation));
 
             circle.setPosition(pos.x - width, pos.y - height);
             circle.setRadius(width);
@@ -387,8 +544,8 @@ void UnitManager::render(const std::shared_ptr<SfmlRenderTarget> &renderTarget,
             }
         }
 
-        const ScreenPos pos = renderTarget->camera()->absoluteScreenPos(unit->position());
-        unit->renderer().render(*renderTarget->renderTarget_, pos, RenderType::Base);
+        const ScreenPos pos = renderTarget->camera()->absoluteScreenPos(unit->renderPosition(interpolation));
+        unit->renderer().render(*renderTarget->renderTarget_, pos, RenderType::Base, now);
 
 
 #ifdef DEBUG
@@ -444,10 +601,10 @@ void UnitManager::render(const std::shared_ptr<SfmlRenderTarget> &renderTarget,
 
     m_moveTargetMarker->renderer().render(*renderTarget->renderTarget_,
                                           renderTarget->camera()->absoluteScreenPos(m_moveTargetMarker->position()),
-                                          RenderType::Base);
+                                          RenderType::Base, now);
 
     for (const Missile::Ptr &missile : visibleMissiles) {
-        missile->renderer().render(*renderTarget->renderTarget_, renderTarget->camera()->absoluteScreenPos(missile->position()), RenderType::Base);
+        missile->renderer().render(*renderTarget->renderTarget_, renderTarget->camera()->absoluteScreenPos(missile->renderPosition(interpolation)), RenderType::Base, now);
     }
 
     if (m_state == State::PlacingBuilding || m_state == State::PlacingWall) {
@@ -480,7 +637,7 @@ void UnitManager::render(const std::shared_ptr<SfmlRenderTarget> &renderTarget,
             building.graphic->setOrientation(building.orientation);
             building.graphic->render(*renderTarget->renderTarget_,
                                         renderTarget->camera()->absoluteScreenPos(building.position),
-                                        building.canPlace ? RenderType::ConstructAvailable : RenderType::ConstructUnavailable);
+                                        building.canPlace ? RenderType::ConstructAvailable : RenderType::ConstructUnavailable, now);
         }
     }
 }
@@ -583,7 +740,7 @@ void UnitManager::onRightClick(const ScreenPos &screenPos, const CameraPtr &came
         Unit::Ptr target = unitAt(screenPos, camera);
         IAction::assignTask(task, unit, target);
         if (target) {
-            target->targetBlinkTimeLeft = 3000; // 3s
+            target->startTargetBlink();
         }
         foundTasks = true;
     }
@@ -605,20 +762,20 @@ void UnitManager::onRightClick(const ScreenPos &screenPos, const CameraPtr &came
         mapPos.y = Constants::TILE_SIZE * m_map->getCols();
     }
 
-    bool movedSomeone = false;
+    std::vector<Unit::Ptr> unitsToMove;
     for (const Unit::Ptr &unit : m_selectedUnits) {
         if (unit->playerId != humanPlayer->playerId) {
             continue;
         }
 
         unit->clearActionQueue();
-        moveUnitTo(unit, mapPos);
-        movedSomeone = true;
+        unitsToMove.push_back(unit);
 
         AudioPlayer::instance().playSound(unit->data()->Action.MoveSound, humanPlayer->civilization.id());
     }
 
-    if (movedSomeone) {
+    if (!unitsToMove.empty()) {
+        moveUnitsTo(unitsToMove, mapPos);
         m_moveTargetMarker->moveTo(mapPos);
     }
 }
@@ -980,6 +1137,25 @@ void UnitManager::moveUnitTo(const Unit::Ptr &unit, const MapPos &targetPos)
     unit->setCurrentAction(ActionMove::moveUnitTo(unit, targetPos));
 }
 
+void UnitManager::moveUnitsTo(const std::vector<Unit::Ptr> &units, const MapPos &targetPos)
+{
+    if (units.size() == 1) {
+        moveUnitTo(units[0], targetPos);
+        return;
+    }
+
+    std::unordered_map<int, FlowField::Future> flowFields;
+    for (const Unit::Ptr &unit : units) {
+        const int restriction = unit->data()->TerrainRestriction;
+        std::unordered_map<int, FlowField::Future>::iterator it = flowFields.find(restriction);
+        if (it == flowFields.end()) {
+            it = flowFields.emplace(restriction, PathfinderPool::Inst().flowField(m_map, restriction, targetPos)).first;
+        }
+
+        unit->setCurrentAction(ActionMove::moveUnitTo(unit, targetPos, it->second));
+    }
+}
+
 void UnitManager::selectAttackTarget()
 {
     m_state = State::SelectingAttackTarget;
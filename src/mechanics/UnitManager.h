@@ -20,7 +20,14 @@
 #include <memory>
 #include <unordered_set>
 
+#include "ResourceIndex.h"
+#include "Missile.h"
+#include "TargetIndex.h"
 #include "Unit.h"
+#include "UnitCache.h"
+
+#include "core/ObjectPool.h"
+#include "core/TimerWheel.h"
 
 class SfmlRenderTarget;
 
@@ -28,7 +35,7 @@ struct Player;
 struct Building;
 struct Missile;
 struct Camera;
-
+class ActionMove;
 
 typedef std::shared_ptr<Camera> CameraPtr;
 
@@ -113,8 +120,14 @@ public:
     bool init();
     void setHumanPlayer(const std::shared_ptr<Player> &player) { m_humanPlayer = player; }
 
+    /// Only the auto target search and the movement thinking run on the job threads, damage,
+    /// spawning and actually moving the units is done one unit at a time on the main thread.
+    /// Deterministic no matter how many job threads there are, the parts that run on them only
+    /// read the state and what they come up with is applied in a fixed order (see test/determinism-check.cpp)
     bool update(Time time);
-    void render(const std::shared_ptr<SfmlRenderTarget> &renderTarget, const std::vector<std::weak_ptr<Entity> > &visible);
+    /// Renders what is on the tiles from the first up to the last (not included).
+    /// Moving things are drawn the interpolation (0 to 1) of the way from where they were before the last update.
+    void render(const std::shared_ptr<SfmlRenderTarget> &renderTarget, const int firstCol, const int firstRow, const int lastCol, const int lastRow, const float interpolation);
 
     bool onLeftClick(const ScreenPos &screenPos, const CameraPtr &camera);
     void onRightClick(const ScreenPos &screenPos, const CameraPtr &camera);
@@ -141,28 +154,70 @@ public:
 
     const Task defaultActionAt(const ScreenPos &pos, const CameraPtr &camera) const noexcept;
     void moveUnitTo(const Unit::Ptr &unit, const MapPos &targetPos);
+
+    /// Units with the same terrain restriction share one flow field instead of searching separately
+    void moveUnitsTo(const std::vector<Unit::Ptr> &units, const MapPos &targetPos);
     void selectAttackTarget();
 
     State state() const { return m_state; }
 
-    void addMissile(const std::shared_ptr<Missile> &missile) { m_missiles.insert(missile); }
-    void addDecayingEntity(const DecayingEntity::Ptr &entity) { m_decayingEntities.insert(entity); }
+    /// From a pool, they come and go all the time. Still need to be added after they are set up.
+    Missile::Ptr createMissile(const genie::Unit &data, const Unit::Ptr &sourceUnit, const MapPos &target, const Unit::Ptr &targetUnit);
+    DecayingEntity::Ptr createDecayingEntity(const int graphicId, const float decayTime);
+
+    void addMissile(const std::shared_ptr<Missile> &missile) { m_missiles.push_back(missile); }
+    /// Starts counting down its decay time
+    void addDecayingEntity(const DecayingEntity::Ptr &entity);
+
+    const TargetIndex &targetIndex() const { return m_targetIndex; }
+
+    /// For things that should happen at a certain game time, driven by update()
+    TimerWheel &timers() { return m_timers; }
 
-    void onCombatantUnitsMoved() { m_unitsMoved = true; }
+    /// Only the active units are updated every tick, units wake themselves up when they get
+    /// something to do (actions, production, being hit, etc.) and go back to sleep when they are idle
+    void wakeUp(Unit *unit) noexcept;
+
+    UnitCache &unitCache() { return m_unitCache; }
+    const UnitCache &unitCache() const { return m_unitCache; }
+    const ResourceIndex &resourceIndex() const { return m_resourceIndex; }
 
 private:
     void updateBuildingToPlace();
     void placeBuilding(const UnplacedBuilding &building);
+    void removeFromCache(Unit &unit);
+
+    /// The parts of the update that only look at the world are done for all the units at the
+    /// same time, from how things are at the start of the tick, and then what they came up with
+    /// is applied one unit at a time in a fixed order. So it ends up the same however many threads there are.
+    void findAutoTargets();
+    void thinkMovement(const Time time);
 
     State m_state = State::Default;
 
     void playSound(const Unit::Ptr &unit);
     const Task taskForPosition(const Unit::Ptr &unit, const ScreenPos &pos, const CameraPtr &camera) const noexcept;
 
-    std::unordered_set<std::shared_ptr<Missile>> m_missiles;
-    std::unordered_set<DecayingEntity::Ptr> m_decayingEntities;
+    // The callbacks only hold weak pointers to what they are for, so the order this goes away in doesn't matter
+    TimerWheel m_timers;
+
+    std::vector<std::shared_ptr<Missile>> m_missiles;
+    std::vector<DecayingEntity::Ptr> m_decayingEntities;
+    ObjectPool<Missile> m_missilePool;
+    ObjectPool<DecayingEntity> m_decayingEntityPool; // smoke trails and corpses
     UnitVector m_units;
+    std::vector<Unit*> m_activeUnits; // owned by m_units
+    UnitCache m_unitCache;
     UnitSet m_unitsWithActions;
+
+    // Reused every tick
+    struct AutoTarget {
+        Unit *unit = nullptr;
+        Task task;
+        Unit::Ptr target;
+    };
+    std::vector<AutoTarget> m_autoTargets;
+    std::vector<ActionMove*> m_movingActions;
     std::unordered_set<Task> m_currentActions;
 
     UnitSet m_selectedUnits;
@@ -173,7 +228,8 @@ private:
     std::vector<UnplacedBuilding> m_buildingsToPlace;
     MapPos m_wallPlacingStart;
 
-    bool m_unitsMoved = true;
+    TargetIndex m_targetIndex;
+    ResourceIndex m_resourceIndex;
 
     MapPos m_previousCameraPos;
     std::weak_ptr<Player> m_humanPlayer;
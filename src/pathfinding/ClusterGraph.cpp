@@ -0,0 +1,612 @@
+#include "ClusterGraph.h"
+
+#include "core/Logger.h"
+#include "core/Utility.h"
+
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+
+// Wider openings get an entrance at each end instead of one in the middle
+static constexpr int MAX_ENTRANCE_WIDTH = 6;
+
+namespace {
+
+/// The tiles of one cluster for jump point search, everything outside of it counts as blocked
+/// so we stay inside it like the normal search does.
+/// Diagonals can't cut corners, so there are no forced neighbours when going diagonally, and
+/// going straight we need to stop next to anything we couldn't have gotten to diagonally.
+struct JumpGrid
+{
+    int width = 0;
+    int height = 0;
+    int goal = -1;
+    std::vector<uint8_t> passable;
+
+    inline bool isPassable(const int x, const int y) const noexcept {
+        if (x < 0 || y < 0 || x >= width || y >= height) {
+            return false;
+        }
+        return passable[y * width + x];
+    }
+
+    inline bool canStep(const int x, const int y, const int dx, const int dy) const noexcept {
+        if (!isPassable(x + dx, y + dy)) {
+            return false;
+        }
+        return !dx || !dy || (isPassable(x + dx, y) && isPassable(x, y + dy));
+    }
+
+    /// Walks from x, y until it finds a tile we need to look at, -1 if it hits something first
+    int jump(int x, int y, const int dx, const int dy) const noexcept {
+        while (canStep(x, y, dx, dy)) {
+            x += dx;
+            y += dy;
+
+            const int index = y * width + x;
+            if (index == goal) {
+                return index;
+            }
+
+            if (dx && dy) {
+                if (jump(x, y, dx, 0) >= 0 || jump(x, y, 0, dy) >= 0) {
+                    return index;
+                }
+            } else if (dx) {
+                if ((isPassable(x, y - 1) && !isPassable(x - dx, y - 1)) || (isPassable(x, y + 1) && !isPassable(x - dx, y + 1))) {
+                    return index;
+                }
+            } else {
+                if ((isPassable(x - 1, y) && !isPassable(x - 1, y - dy)) || (isPassable(x + 1, y) && !isPassable(x + 1, y - dy))) {
+                    return index;
+                }
+            }
+        }
+
+        return -1;
+    }
+
+    /// Which directions to look in from x, y, coming from the parent, returns how many
+    int directions(const int x, const int y, const int parent, int directions[8][2]) const noexcept {
+        int count = 0;
+        const auto add = [&](const int dx, const int dy) {
+            directions[count][0] = dx;
+            directions[count][1] = dy;
+            count++;
+        };
+
+        // The start, look everywhere
+        if (parent < 0) {
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    if (dx || dy) {
+                        add(dx, dy);
+                    }
+                }
+            }
+            return count;
+        }
+
+        const int parentX = parent % width;
+        const int parentY = parent / width;
+        const int dx = (x > parentX) - (x < parentX);
+        const int dy = (y > parentY) - (y < parentY);
+
+        // Going straight the sides are only worth looking at if we couldn't have gotten there
+        // diagonally from the tile before, the same as what makes jump() stop here
+        if (dx && dy) {
+            add(dx, 0);
+            add(0, dy);
+            add(dx, dy);
+        } else if (dx) {
+            add(dx, 0);
+            for (const int side : { -1, 1 }) {
+                if (isPassable(x, y + side) && !isPassable(x - dx, y + side)) {
+                    add(0, side);
+                    add(dx, side);
+                }
+            }
+        } else {
+            add(0, dy);
+            for (const int side : { -1, 1 }) {
+                if (isPassable(x + side, y) && !isPassable(x + side, y - dy)) {
+                    add(side, 0);
+                    add(side, dy);
+                }
+            }
+        }
+
+        return count;
+    }
+};
+
+}
+
+ClusterGraph::ClusterGraph(const int cols, const int rows) :
+    m_cols(cols),
+    m_rows(rows)
+{
+    m_clustersX = (cols + ClusterSize - 1) / ClusterSize;
+    m_clustersY = (rows + ClusterSize - 1) / ClusterSize;
+
+    m_clusters.resize(m_clustersX * m_clustersY);
+    for (int cy = 0; cy < m_clustersY; cy++) {
+        for (int cx = 0; cx < m_clustersX; cx++) {
+            Cluster &cluster = m_clusters[cy * m_clustersX + cx];
+            cluster.firstCol = cx * ClusterSize;
+            cluster.firstRow = cy * ClusterSize;
+            cluster.lastCol = std::min(cluster.firstCol + ClusterSize, m_cols) - 1;
+            cluster.lastRow = std::min(cluster.firstRow + ClusterSize, m_rows) - 1;
+        }
+    }
+}
+
+void ClusterGraph::rebuild(const std::vector<uint8_t> &dirtyClusters, const PassableFunction &isPassable) noexcept
+{
+    // The entrances on the borders are shared with the neighbours, so they need to be updated as well
+    std::vector<uint8_t> affected(m_clusters.size(), 0);
+    for (int cy = 0; cy < m_clustersY; cy++) {
+        for (int cx = 0; cx < m_clustersX; cx++) {
+            if (!dirtyClusters[cy * m_clustersX + cx]) {
+                continue;
+            }
+
+            affected[cy * m_clustersX + cx] = 1;
+            if (cx > 0) { affected[cy * m_clustersX + cx - 1] = 1; }
+            if (cx < m_clustersX - 1) { affected[cy * m_clustersX + cx + 1] = 1; }
+            if (cy > 0) { affected[(cy - 1) * m_clustersX + cx] = 1; }
+            if (cy < m_clustersY - 1) { affected[(cy + 1) * m_clustersX + cx] = 1; }
+        }
+    }
+
+    for (size_t i=0; i<m_clusters.size(); i++) {
+        if (affected[i]) {
+            rebuildEntrances(i, isPassable);
+        }
+    }
+    for (size_t i=0; i<m_clusters.size(); i++) {
+        if (affected[i]) {
+            rebuildEdges(i, isPassable);
+        }
+    }
+}
+
+void ClusterGraph::rebuildEntrances(const int clusterIndex, const PassableFunction &isPassable) noexcept
+{
+    Cluster &cluster = m_clusters[clusterIndex];
+    cluster.nodes.clear();
+
+    // Scans along one border, (col, row) is on our side, (col + dx, row + dy) is the neighbour cluster
+    const auto scanBorder = [&](int col, int row, const int dx, const int dy, const int stepX, const int stepY, const int length) {
+        int runStart = -1;
+        for (int i = 0; i <= length; i++) {
+            const int ownCol = col + stepX * i;
+            const int ownRow = row + stepY * i;
+            const bool open = i < length && isPassable(ownCol, ownRow) && isPassable(ownCol + dx, ownRow + dy);
+
+            if (open) {
+                if (runStart < 0) {
+                    runStart = i;
+                }
+                continue;
+            }
+
+            if (runStart < 0) {
+                continue;
+            }
+
+            const int runEnd = i - 1;
+            std::vector<int> entrances;
+            if (runEnd - runStart + 1 < MAX_ENTRANCE_WIDTH) {
+                entrances.push_back((runStart + runEnd) / 2);
+            } else {
+                entrances.push_back(runStart);
+                entrances.push_back(runEnd);
+            }
+
+            for (const int entrance : entrances) {
+                const int entranceCol = col + stepX * entrance;
+                const int entranceRow = row + stepY * entrance;
+                addEntrance(cluster,
+                            entranceRow * m_cols + entranceCol,
+                            (entranceRow + dy) * m_cols + entranceCol + dx
+                            );
+            }
+
+            runStart = -1;
+        }
+    };
+
+    const int width = cluster.lastCol - cluster.firstCol + 1;
+    const int height = cluster.lastRow - cluster.firstRow + 1;
+
+    if (cluster.firstCol > 0) { // west
+        scanBorder(cluster.firstCol, cluster.firstRow, -1, 0, 0, 1, height);
+    }
+    if (cluster.lastCol < m_cols - 1) { // east
+        scanBorder(cluster.lastCol, cluster.firstRow, 1, 0, 0, 1, height);
+    }
+    if (cluster.firstRow > 0) { // north
+        scanBorder(cluster.firstCol, cluster.firstRow, 0, -1, 1, 0, width);
+    }
+    if (cluster.lastRow < m_rows - 1) { // south
+        scanBorder(cluster.firstCol, cluster.lastRow, 0, 1, 1, 0, width);
+    }
+}
+
+void ClusterGraph::addEntrance(Cluster &cluster, const int tile, const int partner) noexcept
+{
+    Node *node = nullptr;
+    for (Node &existing : cluster.nodes) {
+        if (existing.tile == tile) {
+            node = &existing;
+            break;
+        }
+    }
+
+    if (!node) {
+        cluster.nodes.emplace_back();
+        node = &cluster.nodes.back();
+        node->tile = tile;
+    }
+
+    node->edges.push_back({partner, StraightCost});
+}
+
+void ClusterGraph::rebuildEdges(const int clusterIndex, const PassableFunction &isPassable) noexcept
+{
+    Cluster &cluster = m_clusters[clusterIndex];
+    const int width = cluster.lastCol - cluster.firstCol + 1;
+
+    std::vector<int> costs;
+    for (Node &node : cluster.nodes) {
+        clusterCosts(cluster, node.tile, isPassable, costs);
+
+        for (const Node &other : cluster.nodes) {
+            if (other.tile == node.tile) {
+                continue;
+            }
+
+            const int col = other.tile % m_cols - cluster.firstCol;
+            const int row = other.tile / m_cols - cluster.firstRow;
+            const int cost = costs[row * width + col];
+            if (cost < 0) {
+                continue;
+            }
+
+            node.edges.push_back({other.tile, cost});
+        }
+    }
+}
+
+void ClusterGraph::clusterCosts(const Cluster &cluster, const int startTile, const PassableFunction &isPassable, std::vector<int> &costs, std::vector<int> *parents, int *expanded) const noexcept
+{
+    const int width = cluster.lastCol - cluster.firstCol + 1;
+    const int height = cluster.lastRow - cluster.firstRow + 1;
+    costs.assign(width * height, -1);
+    if (parents) {
+        parents->assign(width * height, -1);
+    }
+
+    typedef std::pair<int, int> QueueEntry; // cost, local index
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+
+    const int startIndex = (startTile / m_cols - cluster.firstRow) * width + startTile % m_cols - cluster.firstCol;
+    costs[startIndex] = 0;
+    queue.push({0, startIndex});
+
+    while (!queue.empty()) {
+        const QueueEntry current = queue.top();
+        queue.pop();
+
+        if (current.first > costs[current.second]) {
+            continue;
+        }
+
+        if (expanded) {
+            (*expanded)++;
+        }
+
+        const int x = current.second % width;
+        const int y = current.second / width;
+
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                if (!dx && !dy) {
+                    continue;
+                }
+
+                const int nx = x + dx;
+                const int ny = y + dy;
+                if (nx < 0 || ny < 0 || nx >= width || ny >= height) {
+                    continue;
+                }
+
+                const int col = cluster.firstCol + nx;
+                const int row = cluster.firstRow + ny;
+                if (!isPassable(col, row)) {
+                    continue;
+                }
+
+                int cost = StraightCost;
+                if (dx && dy) {
+                    // Don't cut corners
+                    if (!isPassable(cluster.firstCol + x + dx, cluster.firstRow + y) || !isPassable(cluster.firstCol + x, cluster.firstRow + y + dy)) {
+                        continue;
+                    }
+                    cost = DiagonalCost;
+                }
+
+                const int index = ny * width + nx;
+                const int newCost = current.first + cost;
+                if (costs[index] >= 0 && costs[index] <= newCost) {
+                    continue;
+                }
+
+                costs[index] = newCost;
+                if (parents) {
+                    (*parents)[index] = current.second;
+                }
+                queue.push({newCost, index});
+            }
+        }
+    }
+}
+
+const ClusterGraph::Node *ClusterGraph::nodeAt(const int tile) const noexcept
+{
+    const Cluster &cluster = m_clusters[clusterIndexAt(tile % m_cols, tile / m_cols)];
+    for (const Node &node : cluster.nodes) {
+        if (node.tile == tile) {
+            return &node;
+        }
+    }
+    return nullptr;
+}
+
+int ClusterGraph::nodeCount() const noexcept
+{
+    int count = 0;
+    for (const Cluster &cluster : m_clusters) {
+        count += cluster.nodes.size();
+    }
+    return count;
+}
+
+std::vector<ClusterGraph::TilePos> ClusterGraph::findPath(const TilePos &start, const TilePos &end, const PassableFunction &isPassable, int *expanded) const noexcept
+{
+    std::vector<TilePos> path;
+
+    if (!isPassable(start.col, start.row) || !isPassable(end.col, end.row)) {
+        return path;
+    }
+
+    const int startTile = start.row * m_cols + start.col;
+    const int endTile = end.row * m_cols + end.col;
+    const Cluster &startCluster = m_clusters[clusterIndexAt(start.col, start.row)];
+    const Cluster &endCluster = m_clusters[clusterIndexAt(end.col, end.row)];
+    const int startClusterWidth = startCluster.lastCol - startCluster.firstCol + 1;
+    const int endClusterWidth = endCluster.lastCol - endCluster.firstCol + 1;
+
+    // Connect the start and end to the entrances in their clusters
+    std::vector<int> startCosts, endCosts;
+    clusterCosts(startCluster, startTile, isPassable, startCosts, nullptr, expanded);
+    clusterCosts(endCluster, endTile, isPassable, endCosts, nullptr, expanded);
+
+    const auto localIndex = [this](const Cluster &cluster, const int width, const int tile) {
+        return (tile / m_cols - cluster.firstRow) * width + tile % m_cols - cluster.firstCol;
+    };
+    const auto heuristic = [this, &end](const int tile) {
+        const int dx = std::abs(tile % m_cols - end.col);
+        const int dy = std::abs(tile / m_cols - end.row);
+        return StraightCost * std::max(dx, dy) + (DiagonalCost - StraightCost) * std::min(dx, dy);
+    };
+
+    std::unordered_map<int, int> costs;
+    std::unordered_map<int, int> cameFrom;
+
+    typedef std::pair<int, int> QueueEntry; // estimated total cost, tile
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+
+    costs[startTile] = 0;
+    queue.push({heuristic(startTile), startTile});
+
+    const auto tryEdge = [&](const int from, const int to, const int cost) {
+        const int newCost = costs[from] + cost;
+        std::unordered_map<int, int>::iterator it = costs.find(to);
+        if (it != costs.end() && it->second <= newCost) {
+            return;
+        }
+        costs[to] = newCost;
+        cameFrom[to] = from;
+        queue.push({newCost + heuristic(to), to});
+    };
+
+    bool found = false;
+    while (!queue.empty()) {
+        const QueueEntry current = queue.top();
+        queue.pop();
+
+        const int tile = current.second;
+        if (tile == endTile) {
+            found = true;
+            break;
+        }
+
+        if (current.first > costs[tile] + heuristic(tile)) {
+            continue;
+        }
+
+        (*expanded)++;
+
+        if (tile == startTile) {
+            for (const Node &node : startCluster.nodes) {
+                const int cost = startCosts[localIndex(startCluster, startClusterWidth, node.tile)];
+                if (cost >= 0) {
+                    tryEdge(tile, node.tile, cost);
+                }
+            }
+            if (&startCluster == &endCluster && startCosts[localIndex(startCluster, startClusterWidth, endTile)] >= 0) {
+                tryEdge(tile, endTile, startCosts[localIndex(startCluster, startClusterWidth, endTile)]);
+            }
+        }
+
+        const Node *node = nodeAt(tile);
+        if (node) {
+            for (const Edge &edge : node->edges) {
+                tryEdge(tile, edge.tile, edge.cost);
+            }
+        }
+
+        if (clusterIndexAt(tile % m_cols, tile / m_cols) == clusterIndexAt(end.col, end.row)) {
+            const int cost = endCosts[localIndex(endCluster, endClusterWidth, tile)];
+            if (cost >= 0) {
+                tryEdge(tile, endTile, cost);
+            }
+        }
+    }
+
+    if (!found) {
+        return path;
+    }
+
+    std::vector<int> waypoints;
+    for (int tile = endTile; tile != startTile; tile = cameFrom[tile]) {
+        waypoints.push_back(tile);
+    }
+    waypoints.push_back(startTile);
+    std::reverse(waypoints.begin(), waypoints.end());
+
+    // Fill in the tiles between the entrances, everything except the step over to a
+    // partner entrance is inside a single cluster
+    for (size_t i=1; i<waypoints.size(); i++) {
+        const int from = waypoints[i - 1];
+        const int to = waypoints[i];
+        if (clusterIndexAt(from % m_cols, from / m_cols) != clusterIndexAt(to % m_cols, to / m_cols)) {
+            path.push_back({to % m_cols, to / m_cols});
+            continue;
+        }
+
+        if (appendJumpPointPath(from, to, isPassable, path, expanded)) {
+            continue;
+        }
+
+        appendClusterPath(from, to, isPassable, path, expanded);
+    }
+
+    return path;
+}
+
+void ClusterGraph::appendClusterPath(const int from, const int to, const PassableFunction &isPassable, std::vector<TilePos> &path, int *expanded) const noexcept
+{
+    const Cluster &cluster = m_clusters[clusterIndexAt(from % m_cols, from / m_cols)];
+    const int width = cluster.lastCol - cluster.firstCol + 1;
+
+    std::vector<int> costs, parents;
+    clusterCosts(cluster, from, isPassable, costs, &parents, expanded);
+
+    const int fromIndex = (from / m_cols - cluster.firstRow) * width + from % m_cols - cluster.firstCol;
+    const int toIndex = (to / m_cols - cluster.firstRow) * width + to % m_cols - cluster.firstCol;
+    if (IS_UNLIKELY(costs[toIndex] < 0)) {
+        WARN << "edge without a path in the cluster";
+        return;
+    }
+
+    const size_t insertAt = path.size();
+    for (int index = toIndex; index != fromIndex; index = parents[index]) {
+        path.push_back({cluster.firstCol + index % width, cluster.firstRow + index / width});
+    }
+    std::reverse(path.begin() + insertAt, path.end());
+}
+
+bool ClusterGraph::appendJumpPointPath(const int from, const int to, const PassableFunction &isPassable, std::vector<TilePos> &path, int *expanded) const noexcept
+{
+    const Cluster &cluster = m_clusters[clusterIndexAt(from % m_cols, from / m_cols)];
+
+    JumpGrid grid;
+    grid.width = cluster.lastCol - cluster.firstCol + 1;
+    grid.height = cluster.lastRow - cluster.firstRow + 1;
+    grid.passable.resize(grid.width * grid.height);
+    for (int y = 0; y < grid.height; y++) {
+        for (int x = 0; x < grid.width; x++) {
+            grid.passable[y * grid.width + x] = isPassable(cluster.firstCol + x, cluster.firstRow + y);
+        }
+    }
+
+    const int width = grid.width;
+    const int fromIndex = (from / m_cols - cluster.firstRow) * width + from % m_cols - cluster.firstCol;
+    const int toIndex = (to / m_cols - cluster.firstRow) * width + to % m_cols - cluster.firstCol;
+    grid.goal = toIndex;
+
+    const auto distance = [width](const int a, const int b) {
+        const int dx = std::abs(a % width - b % width);
+        const int dy = std::abs(a / width - b / width);
+        return StraightCost * std::max(dx, dy) + (DiagonalCost - StraightCost) * std::min(dx, dy);
+    };
+
+    std::vector<int> costs(grid.passable.size(), -1);
+    std::vector<int> parents(grid.passable.size(), -1);
+
+    typedef std::pair<int, int> QueueEntry; // estimated total cost, local index
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+
+    costs[fromIndex] = 0;
+    queue.push({distance(fromIndex, toIndex), fromIndex});
+
+    int directions[8][2];
+    bool found = false;
+    while (!queue.empty()) {
+        const QueueEntry current = queue.top();
+        queue.pop();
+
+        const int index = current.second;
+        if (index == toIndex) {
+            found = true;
+            break;
+        }
+
+        if (current.first > costs[index] + distance(index, toIndex)) {
+            continue;
+        }
+
+        (*expanded)++;
+
+        const int x = index % width;
+        const int y = index / width;
+        const int count = grid.directions(x, y, parents[index], directions);
+        for (int i=0; i<count; i++) {
+            const int jumpPoint = grid.jump(x, y, directions[i][0], directions[i][1]);
+            if (jumpPoint < 0) {
+                continue;
+            }
+
+            // Always in a straight line or diagonal, so the distance is the cost
+            const int newCost = costs[index] + distance(index, jumpPoint);
+            if (costs[jumpPoint] >= 0 && costs[jumpPoint] <= newCost) {
+                continue;
+            }
+
+            costs[jumpPoint] = newCost;
+            parents[jumpPoint] = index;
+            queue.push({newCost + distance(jumpPoint, toIndex), jumpPoint});
+        }
+    }
+
+    if (!found) {
+        return false;
+    }
+
+    // Fill in the tiles between the jump points, so it looks the same as the normal search
+    const size_t insertAt = path.size();
+    for (int index = toIndex; index != fromIndex; index = parents[index]) {
+        const int parent = parents[index];
+        const int stepX = (parent % width > index % width) - (parent % width < index % width);
+        const int stepY = (parent / width > index / width) - (parent / width < index / width);
+        for (int x = index % width, y = index / width; x != parent % width || y != parent / width; x += stepX, y += stepY) {
+            path.push_back({cluster.firstCol + x, cluster.firstRow + y});
+        }
+    }
+    std::reverse(path.begin() + insertAt, path.end());
+
+    return true;
+}
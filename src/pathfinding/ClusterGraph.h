@@ -0,0 +1,91 @@
+#ifndef CLUSTERGRAPH_H
+#define CLUSTERGRAPH_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/// Abstract graph for hierarchical pathfinding (HPA*).
+/// The map is split into square clusters of tiles, and wherever two neighbouring clusters
+/// have an opening between them we add an entrance node on each side.
+/// The entrances inside each cluster are connected with the cost of walking between them,
+/// so a long path can be found by only looking at the entrances, and then filled in with
+/// short searches inside each cluster.
+class ClusterGraph
+{
+public:
+    typedef std::shared_ptr<const ClusterGraph> Ptr;
+    typedef std::function<bool(const int col, const int row)> PassableFunction;
+
+    static constexpr int ClusterSize = 16;
+
+    // Same as the fine grained search, just per tile
+    static constexpr int StraightCost = 2;
+    static constexpr int DiagonalCost = 3;
+
+    struct TilePos {
+        int col = 0;
+        int row = 0;
+    };
+
+    ClusterGraph(const int cols, const int rows);
+
+    /// Updates the clusters flagged in dirtyClusters (indexed by clusterIndexAt()), and their neighbours
+    void rebuild(const std::vector<uint8_t> &dirtyClusters, const PassableFunction &isPassable) noexcept;
+
+    /// Returns every tile to walk through, including the end and not including the start.
+    /// The tiles inside each cluster are filled in with jump point search instead of searching
+    /// through the whole cluster, the costs here don't depend on the terrain so it finds paths as short.
+    /// Adds how many nodes and tiles it expanded along the way to expanded.
+    std::vector<TilePos> findPath(const TilePos &start, const TilePos &end, const PassableFunction &isPassable, int *expanded) const noexcept;
+
+    int clusterCount() const noexcept { return m_clusters.size(); }
+    int nodeCount() const noexcept;
+
+    inline int clusterIndexAt(const int col, const int row) const noexcept {
+        return (row / ClusterSize) * m_clustersX + col / ClusterSize;
+    }
+
+private:
+    struct Edge {
+        int tile = 0;
+        int cost = 0;
+    };
+
+    struct Node {
+        int tile = 0;
+        std::vector<Edge> edges;
+    };
+
+    struct Cluster {
+        int firstCol = 0, firstRow = 0;
+        int lastCol = 0, lastRow = 0;
+        std::vector<Node> nodes;
+    };
+
+    void rebuildEntrances(const int clusterIndex, const PassableFunction &isPassable) noexcept;
+    void addEntrance(Cluster &cluster, const int tile, const int partner) noexcept;
+    void rebuildEdges(const int clusterIndex, const PassableFunction &isPassable) noexcept;
+
+    /// Dijkstra limited to one cluster, returns the cost to every tile in the cluster (or -1)
+    /// If parents is set it gets the local index of the previous tile on the way from the start
+    void clusterCosts(const Cluster &cluster, const int startTile, const PassableFunction &isPassable, std::vector<int> &costs, std::vector<int> *parents = nullptr, int *expanded = nullptr) const noexcept;
+
+    /// Fills in the tiles between two tiles in the same cluster, not including from
+    void appendClusterPath(const int from, const int to, const PassableFunction &isPassable, std::vector<TilePos> &path, int *expanded) const noexcept;
+
+    /// Same as appendClusterPath(), but only looks at the jump points on the way. Returns false if it didn't find a way.
+    bool appendJumpPointPath(const int from, const int to, const PassableFunction &isPassable, std::vector<TilePos> &path, int *expanded) const noexcept;
+
+    const Node *nodeAt(const int tile) const noexcept;
+
+    int m_cols = 0;
+    int m_rows = 0;
+    int m_clustersX = 0;
+    int m_clustersY = 0;
+
+    std::vector<Cluster> m_clusters;
+};
+
+#endif // CLUSTERGRAPH_H
@@ -0,0 +1,135 @@
+#include "FlowField.h"
+
+#include "ClusterGraph.h"
+
+#include "core/Constants.h"
+#include "core/Logger.h"
+#include "core/Utility.h"
+
+#include <algorithm>
+#include <queue>
+
+static const int s_offsetsX[8] = { -1,  0,  1, -1, 1, -1, 0, 1 };
+static const int s_offsetsY[8] = { -1, -1, -1,  0, 0,  1, 1, 1 };
+
+FlowField::Ptr FlowField::create(const std::vector<uint8_t> &passable, const int cols, const int rows, const int targetCol, const int targetRow) noexcept
+{
+    if (IS_UNLIKELY(targetCol < 0 || targetRow < 0 || targetCol >= cols || targetRow >= rows)) {
+        WARN << "flow field target out of range" << targetCol << targetRow;
+        return nullptr;
+    }
+    if (!passable[targetRow * cols + targetCol]) {
+        return nullptr;
+    }
+
+    std::shared_ptr<FlowField> field(new FlowField);
+    field->m_cols = cols;
+    field->m_rows = rows;
+    field->m_targetCol = targetCol;
+    field->m_targetRow = targetRow;
+    field->m_directions.assign(cols * rows, Unreachable);
+
+    const auto isPassable = [&](const int col, const int row) {
+        return col >= 0 && row >= 0 && col < cols && row < rows && passable[row * cols + col];
+    };
+
+    // Integration field, plain Dijkstra out from the target
+    std::vector<int> costs(cols * rows, -1);
+
+    typedef std::pair<int, int> QueueEntry; // cost, tile
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+
+    const int targetIndex = targetRow * cols + targetCol;
+    costs[targetIndex] = 0;
+    field->m_directions[targetIndex] = Target;
+    queue.push({0, targetIndex});
+
+    while (!queue.empty()) {
+        const QueueEntry current = queue.top();
+        queue.pop();
+
+        if (current.first > costs[current.second]) {
+            continue;
+        }
+
+        const int col = current.second % cols;
+        const int row = current.second / cols;
+
+        for (int i=0; i<8; i++) {
+            const int dx = s_offsetsX[i];
+            const int dy = s_offsetsY[i];
+            const int nx = col + dx;
+            const int ny = row + dy;
+            if (!isPassable(nx, ny)) {
+                continue;
+            }
+
+            int cost = ClusterGraph::StraightCost;
+            if (dx && dy) {
+                // Don't cut corners
+                if (!isPassable(col + dx, row) || !isPassable(col, row + dy)) {
+                    continue;
+                }
+                cost = ClusterGraph::DiagonalCost;
+            }
+
+            const int index = ny * cols + nx;
+            const int newCost = current.first + cost;
+            if (costs[index] >= 0 && costs[index] <= newCost) {
+                continue;
+            }
+
+            costs[index] = newCost;
+
+            // The neighbour walks back towards us, which is the opposite offset
+            field->m_directions[index] = 7 - i;
+            queue.push({newCost, index});
+        }
+    }
+
+    return field;
+}
+
+bool FlowField::isReachable(const int col, const int row) const noexcept
+{
+    if (IS_UNLIKELY(col < 0 || row < 0 || col >= m_cols || row >= m_rows)) {
+        return false;
+    }
+
+    return m_directions[row * m_cols + col] != Unreachable;
+}
+
+std::vector<MapPos> FlowField::pathFrom(const MapPos &start, const MapPos &destination) const noexcept
+{
+    std::vector<MapPos> path;
+
+    int col = start.x / Constants::TILE_SIZE + 0.5;
+    int row = start.y / Constants::TILE_SIZE + 0.5;
+    if (!isReachable(col, row)) {
+        return path;
+    }
+
+    path.push_back(destination);
+
+    // Only keep the tiles where we turn
+    std::vector<MapPos> corners;
+    uint8_t previousDirection = Target;
+    for (int steps = 0; steps < m_cols * m_rows; steps++) {
+        const uint8_t direction = m_directions[row * m_cols + col];
+        if (direction == Target) {
+            break;
+        }
+
+        if (direction != previousDirection && previousDirection != Target) {
+            corners.emplace_back(col * Constants::TILE_SIZE, row * Constants::TILE_SIZE);
+        }
+        previousDirection = direction;
+
+        col += s_offsetsX[direction];
+        row += s_offsetsY[direction];
+    }
+
+    path.insert(path.end(), corners.rbegin(), corners.rend());
+
+    return path;
+}
@@ -0,0 +1,51 @@
+#ifndef FLOWFIELD_H
+#define FLOWFIELD_H
+
+#include "core/Types.h"
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <vector>
+
+/// Direction to walk in from every tile to get to one destination tile.
+/// Built once for a group move order, so all the units in the group can share
+/// it instead of each doing their own search towards the same place.
+/// Only looks at the tile passability, units in the way are handled by ActionMove.
+class FlowField
+{
+public:
+    typedef std::shared_ptr<const FlowField> Ptr;
+    typedef std::shared_future<Ptr> Future;
+
+    /// Returns null if the destination itself isn't passable
+    static Ptr create(const std::vector<uint8_t> &passable, const int cols, const int rows, const int targetCol, const int targetRow) noexcept;
+
+    bool isReachable(const int col, const int row) const noexcept;
+
+    /// Follows the field from the start and returns the corners on the way, reversed like
+    /// the pathfinder results (back() is the first waypoint), and ending in destination.
+    /// Empty if the start can't reach the destination.
+    std::vector<MapPos> pathFrom(const MapPos &start, const MapPos &destination) const noexcept;
+
+    int targetCol() const noexcept { return m_targetCol; }
+    int targetRow() const noexcept { return m_targetRow; }
+
+private:
+    enum Direction : uint8_t {
+        // 0-7 are indices in the neighbour offsets
+        Target = 0xFE,
+        Unreachable = 0xFF
+    };
+
+    FlowField() = default;
+
+    int m_cols = 0;
+    int m_rows = 0;
+    int m_targetCol = 0;
+    int m_targetRow = 0;
+
+    std::vector<uint8_t> m_directions;
+};
+
+#endif // FLOWFIELD_H
@@ -0,0 +1,301 @@
+#include "IncrementalPath.h"
+
+#include "ClusterGraph.h"
+#include "ObstructionSnapshot.h"
+
+#include "core/Logger.h"
+#include "core/Utility.h"
+
+#include <algorithm>
+#include <limits>
+
+static const int s_offsetsX[8] = { -1,  0,  1, -1, 1, -1, 0, 1 };
+static const int s_offsetsY[8] = { -1, -1, -1,  0, 0,  1, 1, 1 };
+
+static const float INFINITE_COST = std::numeric_limits<float>::infinity();
+
+IncrementalPath::IncrementalPath(const int goalCol, const int goalRow) :
+    m_goalCol(goalCol),
+    m_goalRow(goalRow)
+{
+}
+
+bool IncrementalPath::update(const ObstructionSnapshot &snapshot, const int startCol, const int startRow, const int maxExpanded, std::vector<int> *path, int *expanded) noexcept
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    path->clear();
+
+    if (IS_UNLIKELY(startCol < 0 || startRow < 0 || startCol >= snapshot.cols() || startRow >= snapshot.rows())) {
+        WARN << "start outside of map";
+        return true;
+    }
+
+    // Different map, start over
+    if (snapshot.cols() != m_cols || snapshot.rows() != m_rows) {
+        m_nodes.clear();
+        m_queue.clear();
+        m_goal = -1;
+        m_syncedSnapshot = nullptr;
+        m_cols = snapshot.cols();
+        m_rows = snapshot.rows();
+    }
+
+    m_snapshot = &snapshot;
+
+    const int start = startRow * m_cols + startCol;
+
+    if (m_goal < 0) {
+        if (m_goalCol < 0 || m_goalRow < 0 || m_goalCol >= m_cols || m_goalRow >= m_rows) {
+            WARN << "goal outside of map";
+            m_snapshot = nullptr;
+            return true;
+        }
+
+        m_goal = m_goalRow * m_cols + m_goalCol;
+        m_start = start;
+        m_keyModifier = 0;
+        m_syncedSnapshot = &snapshot;
+        m_searchExpanded = 0;
+
+        node(m_goal).rhs = 0;
+        m_queue.push_back({calculateKey(m_goal), m_goal});
+    } else {
+        // Instead of updating all the keys in the queue when we move we add how far we have moved to the new ones
+        if (start != m_start) {
+            m_keyModifier += heuristic(m_start, start);
+            m_start = start;
+        }
+
+        // Continuing the same search doesn't need to look for changes again
+        if (m_syncedSnapshot != &snapshot) {
+            findChanges(snapshot);
+            m_syncedSnapshot = &snapshot;
+            m_searchExpanded = 0;
+        }
+    }
+
+    if (!computeShortestPath(maxExpanded, expanded)) {
+        m_snapshot = nullptr;
+        return false;
+    }
+
+    m_syncedSnapshot = nullptr;
+
+    if (node(start).g == INFINITE_COST) {
+        m_snapshot = nullptr;
+        return true;
+    }
+
+    // Just walk downhill
+    int current = start;
+    for (int steps = 0; current != m_goal && steps < m_cols * m_rows; steps++) {
+        const int col = current % m_cols;
+        const int row = current / m_cols;
+
+        int best = -1;
+        float bestCost = INFINITE_COST;
+        for (int i=0; i<8; i++) {
+            const int nx = col + s_offsetsX[i];
+            const int ny = row + s_offsetsY[i];
+            if (nx < 0 || ny < 0 || nx >= m_cols || ny >= m_rows) {
+                continue;
+            }
+
+            const int neighbour = ny * m_cols + nx;
+            const float neighbourCost = cost(current, neighbour) + node(neighbour).g;
+            if (neighbourCost < bestCost) {
+                bestCost = neighbourCost;
+                best = neighbour;
+            }
+        }
+
+        if (best < 0) {
+            WARN << "Lost the way";
+            path->clear();
+            break;
+        }
+
+        path->push_back(best);
+        current = best;
+    }
+
+    m_snapshot = nullptr;
+    return true;
+}
+
+void IncrementalPath::findChanges(const ObstructionSnapshot &snapshot) noexcept
+{
+    std::vector<int> changed;
+    for (const std::pair<const int, Node> &it : m_nodes) {
+        if (it.second.passable != snapshot.isTilePassable(it.first % m_cols, it.first / m_cols)) {
+            changed.push_back(it.first);
+        }
+    }
+
+    for (const int tile : changed) {
+        node(tile).passable = !node(tile).passable;
+    }
+
+    // The diagonals around it depend on it as well, because we don't cut corners
+    for (const int tile : changed) {
+        updateVertex(tile);
+
+        const int col = tile % m_cols;
+        const int row = tile / m_cols;
+        for (int i=0; i<8; i++) {
+            const int nx = col + s_offsetsX[i];
+            const int ny = row + s_offsetsY[i];
+            if (nx >= 0 && ny >= 0 && nx < m_cols && ny < m_rows) {
+                updateVertex(ny * m_cols + nx);
+            }
+        }
+    }
+}
+
+IncrementalPath::Node &IncrementalPath::node(const int tile) noexcept
+{
+    std::unordered_map<int, Node>::iterator it = m_nodes.find(tile);
+    if (it != m_nodes.end()) {
+        return it->second;
+    }
+
+    Node &newNode = m_nodes[tile];
+    newNode.g = INFINITE_COST;
+    newNode.rhs = INFINITE_COST;
+    newNode.passable = m_snapshot->isTilePassable(tile % m_cols, tile / m_cols);
+    return newNode;
+}
+
+bool IncrementalPath::isPassable(const int col, const int row) noexcept
+{
+    if (col < 0 || row < 0 || col >= m_cols || row >= m_rows) {
+        return false;
+    }
+
+    // Through the nodes, so we notice when it changes
+    return node(row * m_cols + col).passable;
+}
+
+float IncrementalPath::cost(const int from, const int to) noexcept
+{
+    const int fromCol = from % m_cols, fromRow = from / m_cols;
+    const int toCol = to % m_cols, toRow = to / m_cols;
+
+    if (!isPassable(fromCol, fromRow) || !isPassable(toCol, toRow)) {
+        return INFINITE_COST;
+    }
+
+    if (fromCol == toCol || fromRow == toRow) {
+        return ClusterGraph::StraightCost;
+    }
+
+    // Don't cut corners
+    if (!isPassable(toCol, fromRow) || !isPassable(fromCol, toRow)) {
+        return INFINITE_COST;
+    }
+
+    return ClusterGraph::DiagonalCost;
+}
+
+float IncrementalPath::heuristic(const int from, const int to) const noexcept
+{
+    const int dx = std::abs(from % m_cols - to % m_cols);
+    const int dy = std::abs(from / m_cols - to / m_cols);
+    return ClusterGraph::StraightCost * std::max(dx, dy) + (ClusterGraph::DiagonalCost - ClusterGraph::StraightCost) * std::min(dx, dy);
+}
+
+IncrementalPath::Key IncrementalPath::calculateKey(const int tile) noexcept
+{
+    const Node &n = node(tile);
+    const float minCost = std::min(n.g, n.rhs);
+    return { minCost + heuristic(m_start, tile) + m_keyModifier, minCost };
+}
+
+void IncrementalPath::updateVertex(const int tile) noexcept
+{
+    Node &n = node(tile);
+
+    if (tile != m_goal) {
+        const int col = tile % m_cols;
+        const int row = tile / m_cols;
+
+        n.rhs = INFINITE_COST;
+        for (int i=0; i<8; i++) {
+            const int nx = col + s_offsetsX[i];
+            const int ny = row + s_offsetsY[i];
+            if (nx < 0 || ny < 0 || nx >= m_cols || ny >= m_rows) {
+                continue;
+            }
+
+            const int neighbour = ny * m_cols + nx;
+            n.rhs = std::min(n.rhs, cost(tile, neighbour) + node(neighbour).g);
+        }
+    }
+
+    // Old entries are just skipped when they come up, instead of searching for them to remove
+    if (n.g != n.rhs) {
+        m_queue.push_back({calculateKey(tile), tile});
+        std::push_heap(m_queue.begin(), m_queue.end());
+    }
+}
+
+bool IncrementalPath::computeShortestPath(const int maxExpanded, int *expanded) noexcept
+{
+    // If it goes on for this long something is wrong
+    const int giveUpAfter = m_cols * m_rows * 4;
+
+    int expandedNow = 0;
+    while (!m_queue.empty()) {
+        const Node &start = node(m_start);
+        if (!(m_queue.front().key < calculateKey(m_start)) && start.rhs == start.g) {
+            break;
+        }
+
+        if (expandedNow >= maxExpanded) {
+            return false;
+        }
+
+        const QueueEntry top = m_queue.front();
+        std::pop_heap(m_queue.begin(), m_queue.end());
+        m_queue.pop_back();
+
+        Node &current = node(top.tile);
+        if (current.g == current.rhs) {
+            continue;
+        }
+
+        const Key newKey = calculateKey(top.tile);
+        if (top.key < newKey) {
+            m_queue.push_back({newKey, top.tile});
+            std::push_heap(m_queue.begin(), m_queue.end());
+            continue;
+        }
+
+        expandedNow++;
+        (*expanded)++;
+        if (IS_UNLIKELY(++m_searchExpanded > giveUpAfter)) {
+            WARN << "Giving up after expanding" << m_searchExpanded;
+            return true;
+        }
+
+        if (current.g > current.rhs) {
+            current.g = current.rhs;
+        } else {
+            current.g = INFINITE_COST;
+            updateVertex(top.tile);
+        }
+
+        const int col = top.tile % m_cols;
+        const int row = top.tile / m_cols;
+        for (int i=0; i<8; i++) {
+            const int nx = col + s_offsetsX[i];
+            const int ny = row + s_offsetsY[i];
+            if (nx >= 0 && ny >= 0 && nx < m_cols && ny < m_rows) {
+                updateVertex(ny * m_cols + nx);
+            }
+        }
+    }
+
+    return true;
+}
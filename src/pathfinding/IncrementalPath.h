@@ -0,0 +1,93 @@
+#ifndef INCREMENTALPATH_H
+#define INCREMENTALPATH_H
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class ObstructionSnapshot;
+
+/// D* Lite search over tiles towards a fixed goal, which keeps its state around so when
+/// something is built or destroyed along the way we only need to look at what changed
+/// instead of searching from scratch.
+/// Searches backwards from the goal, so it doesn't matter that the unit moves in the meantime.
+class IncrementalPath
+{
+public:
+    typedef std::shared_ptr<IncrementalPath> Ptr;
+
+    IncrementalPath(const int goalCol, const int goalRow);
+
+    /// Picks up any changes in the tiles we have looked at before, and continues the search until it
+    /// is done or has expanded maxExpanded tiles. Returns false if it needs to be called again.
+    /// When done the path has the tiles from the start (not included) to the goal, empty if there is no way there.
+    /// The first call does the whole search from the goal, after that only what has changed is looked at.
+    /// Can be called from any thread, but only one at a time.
+    bool update(const ObstructionSnapshot &snapshot, const int startCol, const int startRow, const int maxExpanded, std::vector<int> *path, int *expanded) noexcept;
+
+    int goalCol() const noexcept { return m_goalCol; }
+    int goalRow() const noexcept { return m_goalRow; }
+
+private:
+    struct Node {
+        float g;
+        float rhs;
+        bool passable;
+    };
+
+    struct Key {
+        float first;
+        float second;
+
+        bool operator<(const Key &other) const noexcept {
+            return first < other.first || (first == other.first && second < other.second);
+        }
+    };
+
+    struct QueueEntry {
+        Key key;
+        int tile;
+
+        // Inverted, std::priority_queue wants the largest first
+        bool operator<(const QueueEntry &other) const noexcept { return other.key < key; }
+    };
+
+    Node &node(const int tile) noexcept;
+    bool isPassable(const int col, const int row) noexcept;
+
+    /// Infinite if we can't go directly from one to the other
+    float cost(const int from, const int to) noexcept;
+    float heuristic(const int from, const int to) const noexcept;
+
+    Key calculateKey(const int tile) noexcept;
+    void updateVertex(const int tile) noexcept;
+
+    /// Returns false if it ran out of expansions before it was done
+    bool computeShortestPath(const int maxExpanded, int *expanded) noexcept;
+    void findChanges(const ObstructionSnapshot &snapshot) noexcept;
+
+    std::mutex m_mutex;
+
+    const ObstructionSnapshot *m_snapshot = nullptr;
+
+    // What the search in progress has picked up the changes from, cleared when it is done
+    // so another snapshot that ends up at the same address isn't mistaken for it
+    const ObstructionSnapshot *m_syncedSnapshot = nullptr;
+    int m_cols = 0;
+    int m_rows = 0;
+
+    int m_goalCol = 0;
+    int m_goalRow = 0;
+    int m_goal = -1;
+    int m_start = -1;
+    float m_keyModifier = 0;
+
+    // By the search in progress, over all the slices
+    int m_searchExpanded = 0;
+
+    std::unordered_map<int, Node> m_nodes;
+    std::vector<QueueEntry> m_queue;
+};
+
+#endif // INCREMENTALPATH_H
@@ -0,0 +1,115 @@
+#include "LocalAvoidance.h"
+
+#include "core/Utility.h"
+
+#include <cmath>
+#include <limits>
+
+// How far ahead we care about collisions, in milliseconds
+static constexpr float TIME_HORIZON = 1000;
+
+static constexpr int DIRECTION_SAMPLES = 16;
+
+static constexpr float SIDE_BIAS = 0.5;
+
+MapPos LocalAvoidance::chooseVelocity(const MapPos &position, const MapPos &currentVelocity, const MapPos &preferredVelocity, const float maxSpeed, const std::vector<Neighbour> &neighbours) noexcept
+{
+    if (neighbours.empty()) {
+        return preferredVelocity;
+    }
+
+    MapPos best;
+    float bestPenalty = std::numeric_limits<float>::max();
+
+    // Penalty is how far from where we want to go it is, plus how soon we hit something.
+    // A collision right at the horizon costs nothing, at half of it the same as standing still.
+    const auto consider = [&](const MapPos &candidate) {
+        float penalty = util::hypot(candidate.x - preferredVelocity.x, candidate.y - preferredVelocity.y);
+
+        // Everyone prefers passing on the same side, otherwise units going opposite ways can end up mirroring each other
+        const float cross = preferredVelocity.x * candidate.y - preferredVelocity.y * candidate.x;
+        if (cross > 0) {
+            penalty += SIDE_BIAS * cross / std::max(maxSpeed, 0.0001f);
+        }
+        if (penalty >= bestPenalty) {
+            return;
+        }
+
+        const float time = timeToCollision(position, currentVelocity, candidate, neighbours);
+        if (time < TIME_HORIZON) {
+            penalty += maxSpeed * (TIME_HORIZON / std::max(time, 1.f) - 1.f);
+        }
+
+        if (penalty < bestPenalty) {
+            bestPenalty = penalty;
+            best = candidate;
+        }
+    };
+
+    consider(preferredVelocity);
+
+    // Nothing in the way
+    if (bestPenalty == 0.f) {
+        return preferredVelocity;
+    }
+
+    consider(currentVelocity);
+    consider(MapPos(0, 0));
+
+    for (int i=0; i<DIRECTION_SAMPLES; i++) {
+        const float angle = i * 2. * M_PI / DIRECTION_SAMPLES;
+        const float dx = std::cos(angle);
+        const float dy = std::sin(angle);
+        consider(MapPos(dx * maxSpeed, dy * maxSpeed));
+        consider(MapPos(dx * maxSpeed / 2, dy * maxSpeed / 2));
+    }
+
+    return best;
+}
+
+float LocalAvoidance::timeToCollision(const MapPos &position, const MapPos &currentVelocity, const MapPos &candidate, const std::vector<Neighbour> &neighbours) noexcept
+{
+    float earliest = std::numeric_limits<float>::infinity();
+
+    for (const Neighbour &neighbour : neighbours) {
+        float velocityX, velocityY;
+        if (neighbour.reciprocal) {
+            // We only do half of the change, they do the other
+            velocityX = 2 * candidate.x - currentVelocity.x - neighbour.velocity.x;
+            velocityY = 2 * candidate.y - currentVelocity.y - neighbour.velocity.y;
+        } else {
+            velocityX = candidate.x - neighbour.velocity.x;
+            velocityY = candidate.y - neighbour.velocity.y;
+        }
+
+        const float offsetX = neighbour.position.x - position.x;
+        const float offsetY = neighbour.position.y - position.y;
+
+        // When the distance along the relative velocity hits the clearance
+        const float a = velocityX * velocityX + velocityY * velocityY;
+        const float b = offsetX * velocityX + offsetY * velocityY;
+        const float c = offsetX * offsetX + offsetY * offsetY - neighbour.clearance * neighbour.clearance;
+
+        // Already too close, fine as long as we're moving apart
+        if (c < 0) {
+            if (b > 0) {
+                return 0;
+            }
+            continue;
+        }
+
+        // Not moving towards it
+        if (b <= 0 || a == 0) {
+            continue;
+        }
+
+        const float discriminant = b * b - a * c;
+        if (discriminant < 0) {
+            continue;
+        }
+
+        earliest = std::min(earliest, (b - std::sqrt(discriminant)) / a);
+    }
+
+    return earliest;
+}
@@ -0,0 +1,35 @@
+#ifndef LOCALAVOIDANCE_H
+#define LOCALAVOIDANCE_H
+
+#include "core/Types.h"
+
+#include <vector>
+
+/// Steers around other units close by, instead of treating them as walls and
+/// searching for a new path every time someone walks into the way.
+/// Reciprocal velocity obstacles: samples velocities around the one we want, and picks the one
+/// closest to it that doesn't run into anyone soon. Units that are moving themselves are assumed
+/// to do half of the avoiding, so two units heading for each other don't both swerve too far.
+/// Everything is in map pixels, velocities are per millisecond.
+class LocalAvoidance
+{
+public:
+    struct Neighbour {
+        MapPos position;
+        MapPos velocity;
+
+        /// How close the centres can get before they collide
+        float clearance = 0.f;
+
+        /// If it is going to avoid us as well
+        bool reciprocal = false;
+    };
+
+    static MapPos chooseVelocity(const MapPos &position, const MapPos &currentVelocity, const MapPos &preferredVelocity, const float maxSpeed, const std::vector<Neighbour> &neighbours) noexcept;
+
+    /// How many milliseconds until we hit one of them if we go with the candidate velocity, 0 if
+    /// we already overlap and are getting closer, and infinite if we don't hit anything
+    static float timeToCollision(const MapPos &position, const MapPos &currentVelocity, const MapPos &candidate, const std::vector<Neighbour> &neighbours) noexcept;
+};
+
+#endif // LOCALAVOIDANCE_H
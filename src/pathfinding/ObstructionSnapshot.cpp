@@ -0,0 +1,109 @@
+#include "ObstructionSnapshot.h"
+
+#include <genie/dat/Unit.h>
+
+#include "core/Logger.h"
+#include "mechanics/Map.h"
+#include "mechanics/Unit.h"
+
+ObstructionSnapshot::Ptr ObstructionSnapshot::create(const Map &map, const int terrainRestriction) noexcept
+{
+    std::shared_ptr<ObstructionSnapshot> snapshot(new ObstructionSnapshot);
+    snapshot->m_cols = map.getCols();
+    snapshot->m_rows = map.getRows();
+    snapshot->m_terrainRestriction = terrainRestriction;
+
+    const int tileCount = snapshot->m_cols * snapshot->m_rows;
+    snapshot->m_passable.resize(tileCount);
+    snapshot->m_tileStart.resize(tileCount + 1);
+
+    const PassabilityMap &passability = map.passability();
+
+    Obstruction obstruction;
+    for (int row = 0; row < snapshot->m_rows; row++) {
+        for (int col = 0; col < snapshot->m_cols; col++) {
+            const int index = row * snapshot->m_cols + col;
+            snapshot->m_passable[index] = passability.isPassable(terrainRestriction, col, row);
+            snapshot->m_tileStart[index] = snapshot->m_obstructions.size();
+
+            for (Entity &entity : map.entitiesAt(col, row)) {
+                const Unit *unit = Unit::fromEntity(entity);
+                if (!unit) {
+                    continue;
+                }
+
+                if (unit->data()->Size.z == 0) {
+                    continue;
+                }
+
+                switch (unit->data()->ObstructionType) {
+                case genie::Unit::PassableObstruction:
+                case genie::Unit::PassableObstruction2:
+                case genie::Unit::PassableNoOutlineObstruction:
+                case genie::Unit::BuildingObstruction:
+                case genie::Unit::MountainObstruction:
+                    obstruction.blocksMovement = false;
+                    break;
+                case genie::Unit::UnitObstruction:
+                default:
+                    obstruction.blocksMovement = true;
+                    break;
+                }
+
+                const Size size = unit->clearanceSize();
+                obstruction.canMove = unit->data()->Speed > 0;
+                obstruction.unitId = unit->id;
+                obstruction.x = unit->position().x;
+                obstruction.y = unit->position().y;
+                obstruction.width = size.width;
+                obstruction.height = size.height;
+                snapshot->m_obstructions.push_back(obstruction);
+            }
+        }
+    }
+    snapshot->m_tileStart[tileCount] = snapshot->m_obstructions.size();
+
+    snapshot->m_clusterGraph = passability.clusterGraph(terrainRestriction);
+    snapshot->m_regions = passability.regions(terrainRestriction);
+
+    return snapshot;
+}
+
+bool ObstructionSnapshot::isPassable(const float x, const float y, const int unitId, const float unitRadius, const bool includeMovingUnits) const noexcept
+{
+    if (IS_UNLIKELY(x < 0 || y < 0)) {
+        return false;
+    }
+    const int tileX = x / Constants::TILE_SIZE + 0.5;
+    const int tileY = y / Constants::TILE_SIZE + 0.5;
+    if (!isTilePassable(tileX, tileY)) {
+        return false;
+    }
+
+    for (int dx = tileX-1; dx<=tileX+1; dx++) {
+        for (int dy = tileY-1; dy<=tileY+1; dy++) {
+            if (IS_UNLIKELY(dx < 0 || dy < 0 || dx >= m_cols || dy >= m_rows)) {
+                continue;
+            }
+
+            const Obstruction *end = obstructionsEnd(dx, dy);
+            for (const Obstruction *other = obstructionsBegin(dx, dy); other != end; other++) {
+                if (!other->blocksMovement || other->unitId == unitId) {
+                    continue;
+                }
+
+                if (other->canMove && !includeMovingUnits) {
+                    continue;
+                }
+
+                const float centreDistance = util::hypot(x - other->x, y - other->y);
+                const float clearance = std::max(unitRadius, std::max(other->width, other->height));
+                if (centreDistance < clearance) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
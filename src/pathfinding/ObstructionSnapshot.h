@@ -0,0 +1,84 @@
+#ifndef OBSTRUCTIONSNAPSHOT_H
+#define OBSTRUCTIONSNAPSHOT_H
+
+#include "ClusterGraph.h"
+#include "RegionMap.h"
+
+#include "core/Constants.h"
+#include "core/Utility.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class Map;
+
+/// Immutable copy of everything a path search needs to know about the map,
+/// so searches can run on other threads while the game keeps going.
+/// Built once per tick and terrain restriction, and shared by all the
+/// searches requested in that tick.
+class ObstructionSnapshot
+{
+public:
+    typedef std::shared_ptr<const ObstructionSnapshot> Ptr;
+
+    struct Obstruction {
+        int unitId = -1;
+        float x = 0.f;
+        float y = 0.f;
+        float width = 0.f;
+        float height = 0.f;
+
+        /// False for buildings etc., which are in the tile passability, and units we can walk through
+        bool blocksMovement = false;
+
+        /// Units that can move are usually out of the way by the time we get there, and are avoided locally instead
+        bool canMove = false;
+    };
+
+    static Ptr create(const Map &map, const int terrainRestriction) noexcept;
+
+    /// Same rules as ActionMove::isPassable(), except that elevation is ignored for unit clearance
+    bool isPassable(const float x, const float y, const int unitId, const float unitRadius, const bool includeMovingUnits) const noexcept;
+
+    inline bool isTilePassable(const int col, const int row) const noexcept {
+        if (IS_UNLIKELY(col < 0 || row < 0 || col >= m_cols || row >= m_rows)) {
+            return false;
+        }
+        return m_passable[row * m_cols + col];
+    }
+
+    inline const Obstruction *obstructionsBegin(const int col, const int row) const noexcept {
+        return m_obstructions.data() + m_tileStart[row * m_cols + col];
+    }
+    inline const Obstruction *obstructionsEnd(const int col, const int row) const noexcept {
+        return m_obstructions.data() + m_tileStart[row * m_cols + col + 1];
+    }
+
+    const ClusterGraph::Ptr &clusterGraph() const noexcept { return m_clusterGraph; }
+    const RegionMap::Ptr &regions() const noexcept { return m_regions; }
+
+    int cols() const noexcept { return m_cols; }
+    int rows() const noexcept { return m_rows; }
+    int terrainRestriction() const noexcept { return m_terrainRestriction; }
+
+    int width() const noexcept { return m_cols * Constants::TILE_SIZE; }
+    int height() const noexcept { return m_rows * Constants::TILE_SIZE; }
+
+private:
+    ObstructionSnapshot() = default;
+
+    int m_cols = 0;
+    int m_rows = 0;
+    int m_terrainRestriction = 0;
+
+    std::vector<uint8_t> m_passable;
+    ClusterGraph::Ptr m_clusterGraph;
+    RegionMap::Ptr m_regions;
+
+    // Obstructions sorted by tile, m_tileStart[i] is the first in tile i
+    std::vector<uint32_t> m_tileStart;
+    std::vector<Obstruction> m_obstructions;
+};
+
+#endif // OBSTRUCTIONSNAPSHOT_H
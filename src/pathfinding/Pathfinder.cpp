@@ -0,0 +1,803 @@
+#include "Pathfinder.h"
+
+#include "SearchContext.h"
+
+#include "core/Logger.h"
+#include "core/Utility.h"
+
+#include <algorithm>
+#include <limits>
+#include <stack>
+#include <utility>
+
+#include <math.h>
+#include <stdint.h>
+
+static const float PATHFINDING_HEURISTIC_WEIGHT = 10;
+
+static constexpr float STRAIGHT_COST = 2;
+static constexpr float DIAGONAL_COST = 3;
+
+// Instead of a timeout, the searches can be paused and continued so they don't block anything.
+// But if it goes on for this long it is probably hopeless, so try a coarser one.
+static const size_t MAX_SEARCH_EXPANSIONS = 1 << 20;
+
+static std::vector<MapPos> simplifyRdp(const std::vector<MapPos> &path, const float epsilon) noexcept
+{
+    if (path.empty()) {
+        return path;
+    }
+
+    std::vector<MapPos> cleanedPath;
+
+
+    std::stack<std::pair<int, int>> ranges;
+    ranges.push({0, path.size() - 1});
+    std::vector<bool> selected(path.size(), true);
+
+    while (!ranges.empty()) {
+        const int start = ranges.top().first;
+        const int end = ranges.top().second;
+        ranges.pop();
+
+        float dmax = -1;
+        int index = 0;
+        for (int i = start + 1; i < end - 1; i++) {
+            float d = path[i].distanceToLine(path[start], path[end]);
+            if (d > dmax) {
+                index = i;
+                dmax = d;
+            }
+        }
+
+        if (dmax > epsilon) {
+            ranges.push({start, index});
+            ranges.push({index, end});
+        } else {
+            for (int i=start + 1; i<end; i++) {
+                selected[i] = false;
+            }
+        }
+    }
+
+    for (size_t i=0; i<path.size(); i++) {
+        if (selected[i]) {
+            cleanedPath.push_back(path[i]);
+        }
+    }
+
+//    DBG << "after cleaning" << cleanedPath.size() << "/" << path.size();
+
+    return cleanedPath;
+}
+
+Pathfinder::Pathfinder(const PathRequest &request) :
+    m_request(request),
+    m_snapshot(*m_request.snapshot)
+{
+}
+
+Pathfinder::~Pathfinder()
+{
+    endSearch();
+}
+
+PathResult Pathfinder::run() noexcept
+{
+    while (!runSlice(std::numeric_limits<int>::max())) { }
+
+    return takeResult();
+}
+
+bool Pathfinder::runSlice(const int maxExpanded) noexcept
+{
+    const size_t expandedBefore = m_totalExpanded;
+
+    if (m_stage == Stage::Start) {
+        m_result.destination = m_request.destination;
+        if (m_request.type == PathRequest::RepairPath) {
+            m_stage = Stage::Repairing;
+        } else {
+            m_stage = prepare() ? Stage::Done : Stage::Searching;
+        }
+    }
+
+    if (m_stage == Stage::Repairing) {
+        const SearchStatus status = continueRepair(maxExpanded);
+        if (status == SearchStatus::Paused) {
+            return false;
+        }
+
+        if (status == SearchStatus::Found) {
+            m_stage = Stage::Done;
+        } else {
+            DBG << "failed to repair path, doing a full search";
+            m_stage = prepare() ? Stage::Done : Stage::Searching;
+        }
+    }
+
+    // If one search gives up the coarser ones can continue with what's left
+    while (m_stage == Stage::Searching) {
+        const int64_t remaining = int64_t(maxExpanded) - int64_t(m_totalExpanded - expandedBefore);
+        if (remaining <= 0) {
+            return false;
+        }
+
+        const SearchStatus status = continueSearch(remaining);
+        if (status == SearchStatus::Paused) {
+            return false;
+        }
+
+        if (searchFinished(status)) {
+            m_stage = Stage::Done;
+        }
+    }
+
+#ifdef DEBUG
+    m_result.testedPoints = std::move(testedPoints);
+#endif
+
+    return true;
+}
+
+bool Pathfinder::prepare() noexcept
+{
+    if (m_request.type == PathRequest::IntermediatePath) {
+        return !beginSearch(m_request.start, m_request.destination, 1);
+    }
+
+    // Don't bother searching if it's on an island or something, just go as close as possible
+    m_target = m_request.destination;
+    if (!findReachableTarget(&m_target)) {
+        DBG << "Nothing reachable";
+        return true;
+    }
+    m_result.destination = m_target;
+
+    m_searchDestination = m_target;
+    if (!isPassable(m_searchDestination.x, m_searchDestination.y)) {
+        // WARN << "target not passable, finding closest possible position";
+        m_searchDestination = findClosestWalkableBorder(m_request.start, m_target, 2);
+        m_result.destination = m_searchDestination;
+    }
+
+    m_result.path = simplifyRdp(findHierarchicalPath(m_request.start, m_searchDestination), 2 * 1.3);
+    if (!m_result.path.empty()) {
+        return true;
+    }
+
+    if (beginSearch(m_request.start, m_searchDestination, 2)) {
+        return false;
+    }
+
+    return searchFinished(SearchStatus::Failed);
+}
+
+bool Pathfinder::searchFinished(const SearchStatus status) noexcept
+{
+    const int coarseness = m_search.coarseness;
+
+    if (status == SearchStatus::Found) {
+        m_result.path = searchResult();
+        if (m_request.type != PathRequest::IntermediatePath) {
+            m_result.path = simplifyRdp(m_result.path, coarseness * 1.3);
+        }
+        endSearch();
+        return true;
+    }
+
+    endSearch();
+
+    if (m_request.type == PathRequest::IntermediatePath) {
+        return true;
+    }
+
+    // Try coarser
+    // Uglier, but hopefully faster
+    for (const int coarser : { 5, 10 }) {
+        if (coarser <= coarseness) {
+            continue;
+        }
+
+        WARN << "failed to find path, trying coarseness" << coarser;
+        if (m_searchDestination != m_target) {
+            m_searchDestination = findClosestWalkableBorder(m_request.start, m_target, coarser);
+            m_result.destination = m_searchDestination;
+        }
+
+        if (beginSearch(m_request.start, m_searchDestination, coarser)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+Pathfinder::SearchStatus Pathfinder::continueRepair(const int maxExpanded) noexcept
+{
+    if (IS_UNLIKELY(!m_request.incrementalPath)) {
+        WARN << "Asked to repair without a path";
+        return SearchStatus::Failed;
+    }
+
+    std::vector<int> tiles;
+    int expanded = 0;
+    const bool done = m_request.incrementalPath->update(m_snapshot,
+                m_request.start.x / Constants::TILE_SIZE + 0.5,
+                m_request.start.y / Constants::TILE_SIZE + 0.5,
+                maxExpanded,
+                &tiles,
+                &expanded
+            );
+    m_totalExpanded += expanded;
+
+    if (!done) {
+        return SearchStatus::Paused;
+    }
+
+    if (tiles.empty()) {
+        return SearchStatus::Failed;
+    }
+
+    // Same as the hierarchical one, reversed and ending at the actual destination
+    std::vector<MapPos> path;
+    path.reserve(tiles.size());
+    path.push_back(m_request.destination);
+    for (int i = int(tiles.size()) - 2; i >= 0; i--) {
+        path.emplace_back((tiles[i] % m_snapshot.cols()) * Constants::TILE_SIZE, (tiles[i] / m_snapshot.cols()) * Constants::TILE_SIZE);
+    }
+
+    m_result.path = simplifyRdp(path, 2 * 1.3);
+
+    return SearchStatus::Found;
+}
+
+bool Pathfinder::findReachableTarget(MapPos *target) noexcept
+{
+    const RegionMap::Ptr &regions = m_snapshot.regions();
+    if (!regions) {
+        return true;
+    }
+
+    const int startRegion = regions->regionAt(m_request.start.x / Constants::TILE_SIZE + 0.5, m_request.start.y / Constants::TILE_SIZE + 0.5);
+    if (startRegion == RegionMap::NoRegion) {
+        // We're stuck somewhere, let the normal search try to get us out
+        return true;
+    }
+
+    const int targetCol = target->x / Constants::TILE_SIZE + 0.5;
+    const int targetRow = target->y / Constants::TILE_SIZE + 0.5;
+    if (regions->regionAt(targetCol, targetRow) == startRegion) {
+        return true;
+    }
+
+    int col, row;
+    if (!regions->findClosestInRegion(startRegion, targetCol, targetRow, &col, &row)) {
+        return false;
+    }
+
+    // As close as possible to the original target inside that tile
+    const float halfTile = Constants::TILE_SIZE / 2 - 1;
+    target->x = std::clamp(target->x, col * Constants::TILE_SIZE - halfTile, col * Constants::TILE_SIZE + halfTile);
+    target->y = std::clamp(target->y, row * Constants::TILE_SIZE - halfTile, row * Constants::TILE_SIZE + halfTile);
+
+    return true;
+}
+
+std::vector<MapPos> Pathfinder::findHierarchicalPath(const MapPos &start, const MapPos &end) noexcept
+{
+    const ClusterGraph::Ptr &graph = m_snapshot.clusterGraph();
+    if (!graph) {
+        return {};
+    }
+
+    const ClusterGraph::TilePos startTile = { int(start.x / Constants::TILE_SIZE + 0.5), int(start.y / Constants::TILE_SIZE + 0.5) };
+    const ClusterGraph::TilePos endTile = { int(end.x / Constants::TILE_SIZE + 0.5), int(end.y / Constants::TILE_SIZE + 0.5) };
+
+    // Not worth it for short paths
+    if (std::max(std::abs(startTile.col - endTile.col), std::abs(startTile.row - endTile.row)) <= ClusterGraph::ClusterSize) {
+        return {};
+    }
+
+    int expanded = 0;
+    const std::vector<ClusterGraph::TilePos> tiles = graph->findPath(startTile, endTile, [this](const int col, const int row) {
+        return m_snapshot.isTilePassable(col, row);
+    }, &expanded);
+    m_totalExpanded += expanded;
+
+    if (tiles.empty()) {
+        return {};
+    }
+
+    // Units in the way are left for ActionMove to walk around when it gets there,
+    // they will probably have moved by then anyways
+    std::vector<MapPos> path;
+    path.reserve(tiles.size());
+    path.push_back(end);
+    for (int i = int(tiles.size()) - 2; i >= 0; i--) {
+        path.emplace_back(tiles[i].col * Constants::TILE_SIZE, tiles[i].row * Constants::TILE_SIZE);
+    }
+
+    return path;
+}
+
+MapPos Pathfinder::findClosestWalkableBorder(const MapPos &start, const MapPos &target, int coarseness) noexcept
+{
+    const float radius = m_request.unitRadius;
+
+    float targetRadius = -1.f;
+    const int tileX = target.x / Constants::TILE_SIZE;
+    const int tileY = target.y / Constants::TILE_SIZE;
+    for (int dx = tileX-1; dx<=tileX+1 && targetRadius < 0; dx++) {
+        for (int dy = tileY-1; dy<=tileY+1 && targetRadius < 0; dy++) {
+            if (IS_UNLIKELY(dx < 0 || dy < 0 || dx >= m_snapshot.cols() || dy >= m_snapshot.rows())) {
+                continue;
+            }
+
+            const ObstructionSnapshot::Obstruction *end = m_snapshot.obstructionsEnd(dx, dy);
+            for (const ObstructionSnapshot::Obstruction *other = m_snapshot.obstructionsBegin(dx, dy); other != end; other++) {
+                if (IS_UNLIKELY(other->unitId == m_request.unitId)) {
+                    continue;
+                }
+
+                const float distance = util::hypot(target.x - other->x, target.y - other->y) - util::hypot(other->width, other->height);
+                if (distance < radius) {
+                    //                    DBG << "unit in our spot, trying to find a place close to it";
+                    targetRadius = std::max(other->width, other->height);
+                    break;
+                }
+            }
+        }
+    }
+
+    MapPos newPos = start;
+    if (targetRadius >= 0) {
+#ifdef DEBUG
+        testedPoints.push_back(target);
+#endif
+        const float clearanceLength = std::max(targetRadius, radius);
+
+
+        const float stepSize = M_PI / radius;
+
+        float lowestDistance = std::numeric_limits<float>::max();
+
+        for (float angleOffset = 0; angleOffset < M_PI*2.; angleOffset += stepSize) {
+            MapPos potential(cos(angleOffset), sin(angleOffset));
+            potential = potential * clearanceLength + target;
+            if (!isPassable(potential.x, potential.y)) {
+                continue;
+            }
+
+#ifdef DEBUG
+            testedPoints.push_back(potential);
+#endif
+
+            const float distance = start.distance(potential);
+            if (distance < lowestDistance) {
+                newPos = potential;
+                lowestDistance = distance;
+            }
+        }
+    }
+    if (isPassable(newPos.x, newPos.y)) {
+        return newPos;
+    }
+    // follow a straight line from the target to our location, to find the closest position we can get to
+    // standard bresenham, not the prettiest implementation
+
+    const int x0 = std::round(target.x / coarseness) * coarseness;
+    const int y0 = std::round(target.y / coarseness) * coarseness;
+    const int x1 = std::round(start.x / coarseness) * coarseness;
+    const int y1 = std::round(start.y / coarseness) * coarseness;
+
+    int dx = x1 - x0;
+    int dy = y1 - y0;
+
+    int u, v;
+    int distanceU, distanceV;
+    int uincrX, uincrY, vincrX, vincrY;
+
+    if (std::abs(dx) > std::abs(dy)) {
+        distanceU = std::abs(dx);
+        distanceV = std::abs(dy);
+        u = x1;
+        v = y1;
+        uincrX = 1;
+        uincrY = 0;
+        vincrX = 0;
+        vincrY = 1;
+        if (dx < 0) { uincrX = -uincrX; }
+        if (dy < 0) { vincrY = -vincrY; }
+    } else {
+        distanceU = std::abs(dy);
+        distanceV = std::abs(dx);
+        u = y1;
+        v = x1;
+        uincrX = 0;
+        uincrY = 1;
+        vincrX = 1;
+        vincrY = 0;
+        if (dx < 0) { vincrX = -vincrX; }
+        if (dy < 0) { uincrY = -uincrY; }
+    }
+
+    const int uend = u + distanceU;
+    int d = (2 * distanceV) - distanceU;	    /* Initial value as in Bresenham's */
+    const int incrS = coarseness * 2 * distanceV;	/* Δd for straight increments */
+    const int incrD = coarseness * 2 *(distanceV - distanceU);	/* Δd for diagonal increments */
+
+    int x = x0, y = y0;
+
+    do {
+        if (d < 0) {
+            /* choose straight (u direction) */
+            d = d + incrS;
+        } else {
+            /* choose diagonal (u+v direction) */
+            d = d + incrD;
+            v = v+1;
+            x += vincrX;
+            y += vincrY;
+        }
+
+        u = u+1;
+        x += uincrX;
+        y += uincrY;
+
+        if (isPassable(x, y)) {
+            x += uincrX;
+            y += uincrY;
+            break;
+        }
+    } while (u <= uend);
+
+
+
+    return MapPos(x, y);
+}
+
+std::vector<MapPos> Pathfinder::findPath(MapPos start, MapPos end, int coarseness) noexcept
+{
+    std::vector<MapPos> path;
+    if (beginSearch(start, end, coarseness) && continueSearch(std::numeric_limits<int>::max()) == SearchStatus::Found) {
+        path = searchResult();
+    }
+    endSearch();
+
+    return path;
+}
+
+bool Pathfinder::beginSearch(MapPos start, MapPos end, const int coarseness) noexcept
+{
+    endSearch();
+    m_search.coarseness = coarseness;
+    m_search.end = end;
+
+    if (start == end) {
+        return false;
+    }
+
+    int startX = std::round(start.x / coarseness);
+    int startY = std::round(start.y / coarseness);
+    const int endX = std::round(end.x / coarseness);
+    const int endY = std::round(end.y / coarseness);
+    if (!isPassable(startX * coarseness, startY * coarseness)) {
+        WARN << "handed unpassable start, attempting to get out";
+        start = findClosestWalkableBorder(MapPos(endX * coarseness, endY * coarseness), MapPos(startX * coarseness, startY * coarseness), coarseness);
+        startX = std::round(start.x / coarseness);
+        startY = std::round(start.y / coarseness);
+    }
+
+    if (!isPassable(startX * coarseness, startY * coarseness)) {
+        WARN << "handed unpassable start, failed to find new";
+        return false;
+    }
+
+    if (!isPassable(endX * coarseness, endY * coarseness)) {
+//        WARN << "handed unpassable target, attempting to get out";
+        start = findClosestWalkableBorder(start, end, coarseness);
+        startX = std::round(start.x / coarseness);
+        startY = std::round(start.y / coarseness);
+    }
+
+    if (!isPassable(endX * coarseness, endY * coarseness)) {
+        WARN << "handed unpassable target";
+        return false;
+    }
+
+    // Need one extra, we round to the closest
+    m_search.context = SearchContext::acquire();
+    SearchContext &context = *m_search.context;
+    context.begin(m_snapshot.width() / coarseness + 2, m_snapshot.height() / coarseness + 2);
+
+    if (!context.isValid(startX, startY) || !context.isValid(endX, endY)) {
+        WARN << "path outside of map" << startX << startY << endX << endY;
+        return false;
+    }
+
+    m_search.endX = endX;
+    m_search.endY = endY;
+
+    m_search.startIndex = context.index(startX, startY);
+    context.open(context.cell(startX, startY), 0, -1);
+    context.push(util::hypot(startX - endX, startY - endY) * PATHFINDING_HEURISTIC_WEIGHT * STRAIGHT_COST, startX, startY);
+
+    return true;
+}
+
+Pathfinder::SearchStatus Pathfinder::continueSearch(const int maxExpanded) noexcept
+{
+    if (IS_UNLIKELY(!m_search.context)) {
+        return SearchStatus::Failed;
+    }
+
+    SearchContext &context = *m_search.context;
+    const int coarseness = m_search.coarseness;
+    const int endX = m_search.endX;
+    const int endY = m_search.endY;
+
+    const auto heuristic = [endX, endY](const int x, const int y) {
+        return util::hypot(x - endX, y - endY) * PATHFINDING_HEURISTIC_WEIGHT * STRAIGHT_COST;
+    };
+
+    m_search.slices++;
+
+    int expanded = 0;
+    while (!context.queueEmpty()) {
+        if (expanded >= maxExpanded) {
+            return SearchStatus::Paused;
+        }
+
+        int x, y;
+        context.pop(&x, &y);
+
+        SearchContext::Cell &current = context.cell(x, y);
+
+        // Already handled through a shorter path
+        if (context.isClosed(current)) {
+            continue;
+        }
+        expanded++;
+        m_search.expanded++;
+        m_totalExpanded++;
+
+        if (x == endX && y == endY) {
+            if (m_search.expanded > 10000) {
+                DBG << "walked" << m_search.expanded << "nodes in" << m_search.slices << "slices";
+            }
+            return SearchStatus::Found;
+        }
+
+        context.close(current);
+
+#ifdef DEBUG
+        testedPoints.push_back(MapPos(x * coarseness, y * coarseness));
+#endif
+
+        const float currentCost = current.cost;
+        const int currentIndex = context.index(x, y);
+
+        if (m_request.jumpPoints) {
+            int directions[8][2];
+            const int directionCount = jumpDirections(context, x, y, current.parent, directions);
+
+            int scanned = 0;
+            for (int i = 0; i < directionCount; i++) {
+                const int dx = directions[i][0];
+                const int dy = directions[i][1];
+                const int jumpPoint = jump(context, x, y, dx, dy, &scanned);
+                if (jumpPoint < 0) {
+                    continue;
+                }
+
+                const int nx = context.xAt(jumpPoint);
+                const int ny = context.yAt(jumpPoint);
+                SearchContext::Cell &neighbour = context.cell(nx, ny);
+                if (context.isClosed(neighbour)) {
+                    continue;
+                }
+
+                // Always a straight or diagonal line
+                const int steps = std::max(std::abs(nx - x), std::abs(ny - y));
+                const float cost = currentCost + steps * ((dx && dy) ? DIAGONAL_COST : STRAIGHT_COST);
+                if (context.isOpen(neighbour) && neighbour.cost <= cost) {
+                    continue;
+                }
+
+                context.open(neighbour, cost, currentIndex);
+                context.push(cost + heuristic(nx, ny), nx, ny);
+            }
+
+            // So the budget still matches how much work it was
+            expanded += scanned;
+            m_search.expanded += scanned;
+            m_totalExpanded += scanned;
+        } else {
+            for (int dx = -1; dx <= 1; dx++) {
+                for (int dy = -1; dy <= 1; dy++) {
+                    if (!dx && !dy) {
+                        continue;
+                    }
+
+                    const int nx = x + dx;
+                    const int ny = y + dy;
+                    if (!isCellPassable(context, nx, ny, coarseness)) {
+                        continue;
+                    }
+
+                    SearchContext::Cell &neighbour = context.cell(nx, ny);
+                    if (context.isClosed(neighbour)) {
+                        continue;
+                    }
+
+                    const float cost = currentCost + ((dx && dy) ? DIAGONAL_COST : STRAIGHT_COST);
+                    if (context.isOpen(neighbour) && neighbour.cost <= cost) {
+                        continue;
+                    }
+
+                    context.open(neighbour, cost, currentIndex);
+                    context.push(cost + heuristic(nx, ny), nx, ny);
+                }
+            }
+        }
+
+        if (IS_UNLIKELY(m_search.expanded > MAX_SEARCH_EXPANSIONS)) {
+            WARN << "Giving up after expanding" << m_search.expanded << "nodes in" << m_search.slices << "slices";
+            return SearchStatus::Failed;
+        }
+    }
+
+    WARN << "Failed to find path to" << endX << "," << endY;
+    return SearchStatus::Failed;
+}
+
+int Pathfinder::jump(SearchContext &context, int x, int y, const int dx, const int dy, int *scanned) noexcept
+{
+    const int coarseness = m_search.coarseness;
+    const int endX = m_search.endX;
+    const int endY = m_search.endY;
+
+    while (isCellPassable(context, x + dx, y + dy, coarseness)) {
+        x += dx;
+        y += dy;
+        (*scanned)++;
+
+        if (x == endX && y == endY) {
+            return context.index(x, y);
+        }
+
+        // Diagonals can cut corners, so something next to us opens up a shorter way around it
+        if (dx && dy) {
+            if ((!isCellPassable(context, x - dx, y, coarseness) && isCellPassable(context, x - dx, y + dy, coarseness)) ||
+                (!isCellPassable(context, x, y - dy, coarseness) && isCellPassable(context, x + dx, y - dy, coarseness))) {
+                return context.index(x, y);
+            }
+
+            if (jump(context, x, y, dx, 0, scanned) >= 0 || jump(context, x, y, 0, dy, scanned) >= 0) {
+                return context.index(x, y);
+            }
+        } else if (dx) {
+            if ((!isCellPassable(context, x, y - 1, coarseness) && isCellPassable(context, x + dx, y - 1, coarseness)) ||
+                (!isCellPassable(context, x, y + 1, coarseness) && isCellPassable(context, x + dx, y + 1, coarseness))) {
+                return context.index(x, y);
+            }
+        } else {
+            if ((!isCellPassable(context, x - 1, y, coarseness) && isCellPassable(context, x - 1, y + dy, coarseness)) ||
+                (!isCellPassable(context, x + 1, y, coarseness) && isCellPassable(context, x + 1, y + dy, coarseness))) {
+                return context.index(x, y);
+            }
+        }
+    }
+
+    return -1;
+}
+
+int Pathfinder::jumpDirections(SearchContext &context, const int x, const int y, const int parent, int directions[8][2]) noexcept
+{
+    const int coarseness = m_search.coarseness;
+
+    int count = 0;
+    const auto add = [&](const int dx, const int dy) {
+        directions[count][0] = dx;
+        directions[count][1] = dy;
+        count++;
+    };
+
+    // The start, look everywhere
+    if (parent < 0) {
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                if (dx || dy) {
+                    add(dx, dy);
+                }
+            }
+        }
+        return count;
+    }
+
+    const int parentX = context.xAt(parent);
+    const int parentY = context.yAt(parent);
+    const int dx = (x > parentX) - (x < parentX);
+    const int dy = (y > parentY) - (y < parentY);
+
+    // Everything else can be reached at least as cheaply without going through here,
+    // except around something that's in the way
+    if (dx && dy) {
+        add(dx, 0);
+        add(0, dy);
+        add(dx, dy);
+        if (!isCellPassable(context, x - dx, y, coarseness)) {
+            add(-dx, dy);
+        }
+        if (!isCellPassable(context, x, y - dy, coarseness)) {
+            add(dx, -dy);
+        }
+    } else if (dx) {
+        add(dx, 0);
+        if (!isCellPassable(context, x, y - 1, coarseness)) {
+            add(dx, -1);
+        }
+        if (!isCellPassable(context, x, y + 1, coarseness)) {
+            add(dx, 1);
+        }
+    } else {
+        add(0, dy);
+        if (!isCellPassable(context, x - 1, y, coarseness)) {
+            add(-1, dy);
+        }
+        if (!isCellPassable(context, x + 1, y, coarseness)) {
+            add(1, dy);
+        }
+    }
+
+    return count;
+}
+
+std::vector<MapPos> Pathfinder::searchResult() noexcept
+{
+    std::vector<MapPos> path;
+    if (IS_UNLIKELY(!m_search.context)) {
+        return path;
+    }
+
+    SearchContext &context = *m_search.context;
+    const int coarseness = m_search.coarseness;
+    const int startIndex = m_search.startIndex;
+    const int endX = m_search.endX;
+    const int endY = m_search.endY;
+
+    path.push_back(m_search.end);
+
+    for (int index = context.cell(endX, endY).parent; index != startIndex && index >= 0; ) {
+        const int x = context.xAt(index);
+        const int y = context.yAt(index);
+        path.emplace_back(x * coarseness, y * coarseness);
+        index = context.cell(x, y).parent;
+    }
+
+    return path;
+}
+
+void Pathfinder::endSearch() noexcept
+{
+    if (m_search.context) {
+        SearchContext::release(std::move(m_search.context));
+    }
+
+    m_search = GridSearch();
+}
+
+bool Pathfinder::isCellPassable(SearchContext &context, const int x, const int y, const int coarseness) noexcept
+{
+    if (IS_UNLIKELY(!context.isValid(x, y))) {
+        return false;
+    }
+
+    SearchContext::Cell &cell = context.cell(x, y);
+    if (!context.isPassableKnown(cell)) {
+        context.setPassable(cell, isPassable(x * coarseness, y * coarseness));
+    }
+
+    return context.isPassable(cell);
+}
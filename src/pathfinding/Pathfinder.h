@@ -0,0 +1,169 @@
+#ifndef PATHFINDER_H
+#define PATHFINDER_H
+
+#include "IncrementalPath.h"
+#include "ObstructionSnapshot.h"
+
+#include "core/Types.h"
+
+#include <memory>
+#include <vector>
+
+class SearchContext;
+
+struct PathRequest {
+    enum Type {
+        /// Adjusts the destination if it isn't reachable, and falls back to coarser searches
+        FullPath,
+
+        /// Just a fine grained search to get around something in the way
+        IntermediatePath,
+
+        /// Something was built or destroyed along the way, only updates the search state in incrementalPath,
+        /// and falls back to a full search if that doesn't work out
+        RepairPath
+    };
+
+    Type type = FullPath;
+
+    ObstructionSnapshot::Ptr snapshot;
+    MapPos start;
+    MapPos destination;
+
+    int unitId = -1;
+    float unitRadius = 0.f;
+
+    /// Other units that can move are normally left to the local avoidance when we get to them,
+    /// but short paths around something that is blocking us right now need to go around them
+    bool avoidMovingUnits = false;
+
+    /// The grid search costs only depend on whether a cell can be walked through, so it can jump
+    /// along straight lines and only stop where something is in the way. Turned off to compare against.
+    bool jumpPoints = true;
+
+    /// Kept by the requester between repairs, only needed for RepairPath. The first repair
+    /// does the whole search, the ones after that only have to look at what has changed.
+    IncrementalPath::Ptr incrementalPath;
+};
+
+struct PathResult {
+    /// Reversed, back() is the next waypoint
+    std::vector<MapPos> path;
+
+    /// Might be different from the requested one if that wasn't reachable
+    MapPos destination;
+
+#ifdef DEBUG
+    std::vector<MapPos> testedPoints;
+#endif
+};
+
+/// Does the actual path searching, only works on the snapshot it is handed
+/// so it is safe to run outside of the main thread.
+/// The grid searches can be run in slices, so a long search can be paused when
+/// it has used up its share of the frame and continued later (even on another thread).
+class Pathfinder
+{
+public:
+    Pathfinder(const PathRequest &request);
+    ~Pathfinder();
+
+    Pathfinder(const Pathfinder&) = delete;
+    const Pathfinder &operator=(const Pathfinder&) = delete;
+
+    /// Does everything in one go
+    PathResult run() noexcept;
+
+    /// Continues the search until it is done or has expanded maxExpanded cells.
+    /// Returns true when it is done, and the result can be fetched with takeResult().
+    bool runSlice(const int maxExpanded) noexcept;
+
+    PathResult takeResult() noexcept { return std::move(m_result); }
+
+    /// How many cells, tiles and nodes have been expanded in total by the grid, hierarchical and incremental searches
+    size_t expandedCount() const noexcept { return m_totalExpanded; }
+
+    std::vector<MapPos> findPath(MapPos start, MapPos end, int coarseness) noexcept;
+
+    /// Moves the target to the closest point we can get to, if it is in another region than the start
+    bool findReachableTarget(MapPos *target) noexcept;
+
+    /// Finds the entrances between clusters to go through first, and then only fills in within each cluster
+    std::vector<MapPos> findHierarchicalPath(const MapPos &start, const MapPos &end) noexcept;
+
+    MapPos findClosestWalkableBorder(const MapPos &start, const MapPos &target, int coarseness) noexcept;
+
+    inline bool isPassable(const float x, const float y) const noexcept {
+        return m_snapshot.isPassable(x, y, m_request.unitId, m_request.unitRadius, m_request.avoidMovingUnits);
+    }
+
+#ifdef DEBUG
+    std::vector<MapPos> testedPoints;
+#endif
+
+private:
+    enum class Stage {
+        Start,
+        Repairing,
+        Searching,
+        Done
+    };
+
+    enum class SearchStatus {
+        Found,
+        Failed,
+        Paused
+    };
+
+    /// Everything needed to continue a grid search where it left off
+    struct GridSearch {
+        std::unique_ptr<SearchContext> context;
+        MapPos end;
+        int coarseness = 0;
+        int startIndex = -1;
+        int endX = 0;
+        int endY = 0;
+        size_t expanded = 0;
+        int slices = 0;
+    };
+
+    /// Handles everything before the grid search, returns true if it is already done
+    bool prepare() noexcept;
+
+    /// Continues updating the incremental path, the result is empty if it didn't work out
+    /// so the normal search can try
+    SearchStatus continueRepair(const int maxExpanded) noexcept;
+
+    /// Handles a failed or finished grid search, returns true if there's nothing more to try
+    bool searchFinished(const SearchStatus status) noexcept;
+
+    /// Returns false if there's no point in searching
+    bool beginSearch(MapPos start, MapPos end, const int coarseness) noexcept;
+    SearchStatus continueSearch(const int maxExpanded) noexcept;
+    std::vector<MapPos> searchResult() noexcept;
+    void endSearch() noexcept;
+
+    bool isCellPassable(SearchContext &context, const int x, const int y, const int coarseness) noexcept;
+
+    /// Walks from x, y until it gets to a cell that needs to be looked at properly (the end, or next
+    /// to something in the way), returns its index or -1 if it runs into something first
+    int jump(SearchContext &context, int x, int y, const int dx, const int dy, int *scanned) noexcept;
+
+    /// Which directions are worth looking in from x, y coming from the parent, returns how many
+    int jumpDirections(SearchContext &context, const int x, const int y, const int parent, int directions[8][2]) noexcept;
+
+    const PathRequest m_request;
+    const ObstructionSnapshot &m_snapshot;
+
+    Stage m_stage = Stage::Start;
+    PathResult m_result;
+
+    // Where the full search is actually heading, might be moved if something is standing on the target
+    MapPos m_target;
+    MapPos m_searchDestination;
+
+    GridSearch m_search;
+    size_t m_totalExpanded = 0;
+};
+
+#endif // PATHFINDER_H
@@ -0,0 +1,248 @@
+#include "PathfinderPool.h"
+
+#include "core/Logger.h"
+#include "mechanics/Map.h"
+
+#include <algorithm>
+
+// Each one is a byte per tile, and we usually don't have many groups going different places at the same time
+static constexpr size_t MAX_CACHED_FLOW_FIELDS = 16;
+
+// How many cells all the searches together can expand per frame, about 4ms of work.
+// Split up in slices so the searches take turns and one long one doesn't hold up all the others.
+static constexpr int FRAME_BUDGET = 40000;
+static constexpr int SLICE_SIZE = 4000;
+
+PathfinderPool &PathfinderPool::Inst()
+{
+    static PathfinderPool inst;
+    return inst;
+}
+
+PathfinderPool::PathfinderPool() :
+    m_frameBudget(FRAME_BUDGET)
+{
+    // Leave a core for the main thread
+    const int threadCount = std::clamp(int(std::thread::hardware_concurrency()) - 1, 1, 4);
+    DBG << "Starting" << threadCount << "pathfinding threads";
+
+    for (int i=0; i<threadCount; i++) {
+        m_workers.emplace_back(&PathfinderPool::run, this);
+    }
+}
+
+PathfinderPool::~PathfinderPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_running = false;
+    }
+    m_jobsAvailable.notify_all();
+
+    for (std::thread &worker : m_workers) {
+        worker.join();
+    }
+}
+
+std::future<PathResult> PathfinderPool::findPath(PathRequest request) noexcept
+{
+    if (IS_UNLIKELY(!request.snapshot)) {
+        WARN << "No snapshot to search in";
+        std::promise<PathResult> failed;
+        failed.set_value(PathResult());
+        return failed.get_future();
+    }
+
+    // std::function needs to be copyable
+    std::shared_ptr<SlicedSearch> search = std::make_shared<SlicedSearch>(request);
+    std::future<PathResult> result = search->promise.get_future();
+
+    addJob([this, search]() {
+        runSlice(search);
+    });
+
+    return result;
+}
+
+void PathfinderPool::beginFrame() noexcept
+{
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_frameBudget = FRAME_BUDGET;
+
+        for (const std::shared_ptr<SlicedSearch> &search : m_waitingForBudget) {
+            m_jobs.push_back([this, search]() {
+                runSlice(search);
+            });
+        }
+        m_waitingForBudget.clear();
+    }
+
+    m_jobsAvailable.notify_all();
+}
+
+void PathfinderPool::runSlice(const std::shared_ptr<SlicedSearch> &search) noexcept
+{
+    int budget = SLICE_SIZE;
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        if (m_budgetLimited) {
+            if (m_frameBudget <= 0) {
+                m_waitingForBudget.push_back(search);
+                return;
+            }
+
+            budget = std::min(m_frameBudget, SLICE_SIZE);
+            m_frameBudget -= budget;
+        }
+    }
+
+    const size_t expandedBefore = search->pathfinder.expandedCount();
+    const bool done = search->pathfinder.runSlice(budget);
+    const int used = search->pathfinder.expandedCount() - expandedBefore;
+
+    if (done) {
+        search->promise.set_value(search->pathfinder.takeResult());
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+
+        // Give back what we didn't use, the hierarchical search isn't split up so it can go over
+        if (m_budgetLimited) {
+            m_frameBudget += budget - used;
+        }
+
+        // Back of the queue, so everyone else gets a turn first
+        if (!done) {
+            m_jobs.push_back([this, search]() {
+                runSlice(search);
+            });
+        }
+    }
+
+    if (!done) {
+        m_jobsAvailable.notify_one();
+    }
+}
+
+void PathfinderPool::waitUntilIdle() noexcept
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this]() { return m_runningJobs == 0 && m_jobs.empty(); });
+}
+
+void PathfinderPool::setBudgetLimited(const bool limited) noexcept
+{
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_budgetLimited = limited;
+        m_frameBudget = FRAME_BUDGET;
+
+        for (const std::shared_ptr<SlicedSearch> &search : m_waitingForBudget) {
+            m_jobs.push_back([this, search]() {
+                runSlice(search);
+            });
+        }
+        m_waitingForBudget.clear();
+    }
+
+    m_jobsAvailable.notify_all();
+}
+
+FlowField::Future PathfinderPool::flowField(const std::shared_ptr<Map> &map, const int terrainRestriction, const MapPos &destination) noexcept
+{
+    if (m_flowFieldMap.lock() != map) {
+        m_flowFields.clear();
+        m_flowFieldMap = map;
+    }
+
+    const PassabilityMap &passability = map->passability();
+    const int col = destination.x / Constants::TILE_SIZE + 0.5;
+    const int row = destination.y / Constants::TILE_SIZE + 0.5;
+    const uint64_t key = (uint64_t(uint32_t(terrainRestriction)) << 32) | uint32_t(row * passability.cols() + col);
+
+    m_flowFieldRequests++;
+
+    std::unordered_map<uint64_t, CachedFlowField>::iterator it = m_flowFields.find(key);
+    if (it != m_flowFields.end() && it->second.revision == passability.revision()) {
+        it->second.lastUsed = m_flowFieldRequests;
+        return it->second.field;
+    }
+
+    if (it == m_flowFields.end() && m_flowFields.size() >= MAX_CACHED_FLOW_FIELDS) {
+        std::unordered_map<uint64_t, CachedFlowField>::iterator oldest = m_flowFields.begin();
+        for (std::unordered_map<uint64_t, CachedFlowField>::iterator candidate = m_flowFields.begin(); candidate != m_flowFields.end(); candidate++) {
+            if (candidate->second.lastUsed < oldest->second.lastUsed) {
+                oldest = candidate;
+            }
+        }
+        m_flowFields.erase(oldest);
+    }
+
+    std::shared_ptr<std::promise<FlowField::Ptr>> promise = std::make_shared<std::promise<FlowField::Ptr>>();
+
+    CachedFlowField &cached = m_flowFields[key];
+    cached.field = promise->get_future().share();
+    cached.revision = passability.revision();
+    cached.lastUsed = m_flowFieldRequests;
+
+    addJob([passable = passability.passableTiles(terrainRestriction), cols = passability.cols(), rows = passability.rows(), col, row, promise]() {
+        promise->set_value(FlowField::create(passable, cols, rows, col, row));
+    });
+
+    return cached.field;
+}
+
+void PathfinderPool::addJob(std::function<void()> job) noexcept
+{
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_jobs.push_back(std::move(job));
+    }
+    m_jobsAvailable.notify_one();
+}
+
+ObstructionSnapshot::Ptr PathfinderPool::snapshot(const std::shared_ptr<Map> &map, const int terrainRestriction, const Time time) noexcept
+{
+    if (time != m_snapshotTime || m_snapshotMap.lock() != map) {
+        m_snapshots.clear();
+        m_snapshotTime = time;
+        m_snapshotMap = map;
+    }
+
+    ObstructionSnapshot::Ptr &snapshot = m_snapshots[terrainRestriction];
+    if (!snapshot) {
+        snapshot = ObstructionSnapshot::create(*map, terrainRestriction);
+    }
+
+    return snapshot;
+}
+
+void PathfinderPool::run() noexcept
+{
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobsAvailable.wait(lock, [this]() { return !m_running || !m_jobs.empty(); });
+            if (!m_running) {
+                return;
+            }
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            m_runningJobs++;
+        }
+
+        job();
+
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_runningJobs--;
+            if (m_runningJobs == 0 && m_jobs.empty()) {
+                m_idle.notify_all();
+            }
+        }
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef PATHFINDERPOOL_H
+#define PATHFINDERPOOL_H
+
+#include "FlowField.h"
+#include "Pathfinder.h"
+
+#include "core/Types.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class Map;
+
+/// Fixed set of threads running path searches, so the game never has to wait for them.
+/// Results are handed back through futures, which the requester polls each update.
+/// The searches are run in slices taking turns, and all of them share a budget for how
+/// much they can do per frame, so lots of units moving at once doesn't hog the CPU.
+class PathfinderPool
+{
+public:
+    static PathfinderPool &Inst();
+
+    PathfinderPool(const PathfinderPool&) = delete;
+    const PathfinderPool &operator=(const PathfinderPool&) = delete;
+
+    std::future<PathResult> findPath(PathRequest request) noexcept;
+
+    /// Call once per tick from the main thread, refills the budget for the searches
+    void beginFrame() noexcept;
+
+    /// Blocks until all the queued searches and flow fields are done, except the ones waiting for the
+    /// budget of the next frame.
+    /// For checks that need the results to arrive in the same tick every time they run.
+    void waitUntilIdle() noexcept;
+
+    /// Which searches run out of budget depends on how the threads happen to take turns, so
+    /// checks that compare runs turn it off. On by default.
+    void setBudgetLimited(const bool limited) noexcept;
+
+    /// Only call from the main thread. Fields are cached per destination tile and terrain restriction,
+    /// until the map passability changes, so a group ordered to the same place shares one.
+    FlowField::Future flowField(const std::shared_ptr<Map> &map, const int terrainRestriction, const MapPos &destination) noexcept;
+
+    /// Only call from the main thread, the snapshot is shared with everything else asking during the same tick
+    ObstructionSnapshot::Ptr snapshot(const std::shared_ptr<Map> &map, const int terrainRestriction, const Time time) noexcept;
+
+private:
+    struct CachedFlowField {
+        FlowField::Future field;
+        uint32_t revision = 0;
+        uint64_t lastUsed = 0;
+    };
+
+    struct SlicedSearch {
+        SlicedSearch(const PathRequest &request) : pathfinder(request) {}
+
+        Pathfinder pathfinder;
+        std::promise<PathResult> promise;
+    };
+
+    PathfinderPool();
+    ~PathfinderPool();
+
+    void addJob(std::function<void()> job) noexcept;
+
+    /// Runs a bit of the search, and puts it back in the queue if it isn't done
+    void runSlice(const std::shared_ptr<SlicedSearch> &search) noexcept;
+    void run() noexcept;
+
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_jobsAvailable;
+    std::condition_variable m_idle;
+    int m_runningJobs = 0;
+    bool m_running = true;
+
+    // Both protected by m_mutex
+    int m_frameBudget;
+    bool m_budgetLimited = true;
+    std::vector<std::shared_ptr<SlicedSearch>> m_waitingForBudget;
+
+    std::weak_ptr<Map> m_snapshotMap;
+    Time m_snapshotTime = -1;
+    std::unordered_map<int, ObstructionSnapshot::Ptr> m_snapshots;
+
+    std::weak_ptr<Map> m_flowFieldMap;
+    uint64_t m_flowFieldRequests = 0;
+    std::unordered_map<uint64_t, CachedFlowField> m_flowFields; // key is restriction << 32 | tile index
+};
+
+#endif // PATHFINDERPOOL_H
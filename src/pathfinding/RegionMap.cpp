@@ -0,0 +1,461 @@
+#include "RegionMap.h"
+
+#include "core/Logger.h"
+#include "core/Utility.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const int s_offsetsX[8] = { -1,  0,  1, -1, 1, -1, 0, 1 };
+static const int s_offsetsY[8] = { -1, -1, -1,  0, 0,  1, 1, 1 };
+
+// Units are usually all in the same few regions, each one is an int per tile
+static constexpr size_t MAX_CLOSEST_TILES = 4;
+
+RegionMap::RegionMap(const int cols, const int rows) :
+    m_cols(cols),
+    m_rows(rows)
+{
+    m_labels.assign(cols * rows, NoRegion);
+    m_sizes.assign(1, 0);
+    m_splitOwners.assign(cols * rows, -1);
+    m_splitGenerations.assign(cols * rows, 0);
+}
+
+RegionMap::RegionMap(const RegionMap &other) :
+    m_cols(other.m_cols),
+    m_rows(other.m_rows),
+    m_labels(other.m_labels),
+    m_sizes(other.m_sizes),
+    m_freeLabels(other.m_freeLabels),
+    m_splitOwners(other.m_splitOwners),
+    m_splitGenerations(other.m_splitGenerations),
+    m_splitGeneration(other.m_splitGeneration)
+{
+}
+
+void RegionMap::rebuild(const PassableFunction &isPassable) noexcept
+{
+    m_labels.assign(m_cols * m_rows, NoRegion);
+    m_sizes.assign(1, 0);
+    m_freeLabels.clear();
+    m_closestTiles.clear();
+
+    // Mark the passable ones with a temporary label first, so we can flood fill them
+    constexpr int unlabeled = -1;
+    for (int row = 0; row < m_rows; row++) {
+        for (int col = 0; col < m_cols; col++) {
+            if (isPassable(col, row)) {
+                m_labels[row * m_cols + col] = unlabeled;
+            }
+        }
+    }
+
+    for (size_t tile = 0; tile < m_labels.size(); tile++) {
+        if (m_labels[tile] != unlabeled) {
+            continue;
+        }
+
+        const int label = newLabel();
+        m_sizes[label] = relabel(tile, unlabeled, label);
+    }
+}
+
+void RegionMap::update(const std::vector<int> &changedTiles, const PassableFunction &isPassable) noexcept
+{
+    m_closestTiles.clear();
+
+    // Remove everything that got blocked first, so the flood fills don't go through them
+    std::vector<int> removed;
+    std::vector<int> added;
+    for (const int tile : changedTiles) {
+        const bool passable = isPassable(tile % m_cols, tile / m_cols);
+        const int label = m_labels[tile];
+        if (!passable && label != NoRegion) {
+            m_labels[tile] = NoRegion;
+            m_sizes[label]--;
+            if (m_sizes[label] == 0) {
+                m_freeLabels.push_back(label);
+            }
+            removed.push_back(tile);
+        } else if (passable && label == NoRegion) {
+            added.push_back(tile);
+        }
+    }
+
+    // Check if removing it split the region it was in
+    for (const int tile : removed) {
+        const int col = tile % m_cols;
+        const int row = tile / m_cols;
+
+        // Neighbours grouped by whether they're still connected around the removed tile
+        int neighbours[8];
+        int groups[8];
+        int count = 0;
+        for (int i=0; i<8; i++) {
+            const int nx = col + s_offsetsX[i];
+            const int ny = row + s_offsetsY[i];
+            if (regionAt(nx, ny) == NoRegion) {
+                continue;
+            }
+
+            neighbours[count] = i;
+            groups[count] = count;
+            count++;
+        }
+
+        for (int i=0; i<count; i++) {
+            for (int j=i + 1; j<count; j++) {
+                const int ax = s_offsetsX[neighbours[i]], ay = s_offsetsY[neighbours[i]];
+                const int bx = s_offsetsX[neighbours[j]], by = s_offsetsY[neighbours[j]];
+                if (std::abs(ax - bx) > 1 || std::abs(ay - by) > 1) {
+                    continue;
+                }
+
+                const int oldGroup = groups[j];
+                for (int k=0; k<count; k++) {
+                    if (groups[k] == oldGroup) {
+                        groups[k] = groups[i];
+                    }
+                }
+            }
+        }
+
+        // One seed per group and label, earlier splits might have changed the labels
+        std::vector<std::pair<int, int>> seeds; // label, tile
+        for (int i=0; i<count; i++) {
+            bool seen = false;
+            for (int j=0; j<i; j++) {
+                if (groups[j] == groups[i]) {
+                    seen = true;
+                    break;
+                }
+            }
+            if (seen) {
+                continue;
+            }
+
+            const int seed = (row + s_offsetsY[neighbours[i]]) * m_cols + col + s_offsetsX[neighbours[i]];
+            seeds.emplace_back(m_labels[seed], seed);
+        }
+        std::sort(seeds.begin(), seeds.end());
+
+        for (size_t i=0; i<seeds.size(); ) {
+            size_t end = i + 1;
+            while (end < seeds.size() && seeds[end].first == seeds[i].first) {
+                end++;
+            }
+
+            if (end - i > 1) {
+                std::vector<int> labelSeeds;
+                for (size_t j=i; j<end; j++) {
+                    labelSeeds.push_back(seeds[j].second);
+                }
+                splitRegion(seeds[i].first, labelSeeds);
+            }
+
+            i = end;
+        }
+    }
+
+    for (const int tile : added) {
+        addTile(tile);
+    }
+}
+
+void RegionMap::addTile(const int tile) noexcept
+{
+    const int col = tile % m_cols;
+    const int row = tile / m_cols;
+
+    int largest = NoRegion;
+    for (int i=0; i<8; i++) {
+        const int label = regionAt(col + s_offsetsX[i], row + s_offsetsY[i]);
+        if (label != NoRegion && (largest == NoRegion || m_sizes[label] > m_sizes[largest])) {
+            largest = label;
+        }
+    }
+
+    if (largest == NoRegion) {
+        largest = newLabel();
+    }
+
+    m_labels[tile] = largest;
+    m_sizes[largest]++;
+
+    // Connects regions, move the smaller ones into the largest
+    for (int i=0; i<8; i++) {
+        const int nx = col + s_offsetsX[i];
+        const int ny = row + s_offsetsY[i];
+        const int label = regionAt(nx, ny);
+        if (label == NoRegion || label == largest) {
+            continue;
+        }
+
+        const int moved = relabel(ny * m_cols + nx, label, largest);
+        m_sizes[label] -= moved;
+        m_sizes[largest] += moved;
+        if (m_sizes[label] == 0) {
+            m_freeLabels.push_back(label);
+        }
+    }
+}
+
+void RegionMap::splitRegion(const int label, const std::vector<int> &seeds) noexcept
+{
+    // Flood fills from all the seeds at the same time, one step each in turn,
+    // until they either all meet or run out. Those that run out are a new region.
+    // Means we only walk through about as much as the smaller parts.
+    const int seedCount = seeds.size();
+
+    m_splitGeneration++;
+    if (IS_UNLIKELY(m_splitGeneration == 0)) {
+        std::fill(m_splitGenerations.begin(), m_splitGenerations.end(), 0);
+        m_splitGeneration = 1;
+    }
+    const auto ownerOf = [this](const int tile) {
+        return m_splitGenerations[tile] == m_splitGeneration ? m_splitOwners[tile] : -1;
+    };
+    const auto setOwner = [this](const int tile, const int seed) {
+        m_splitOwners[tile] = seed;
+        m_splitGenerations[tile] = m_splitGeneration;
+    };
+
+    std::vector<std::vector<int>> visited(seedCount);
+    std::vector<size_t> queueStart(seedCount, 0);
+    std::vector<int> groupOf(seedCount);
+    std::vector<bool> finished(seedCount, false);
+
+    for (int i=0; i<seedCount; i++) {
+        groupOf[i] = i;
+        setOwner(seeds[i], i);
+        visited[i].push_back(seeds[i]);
+    }
+
+    const auto findGroup = [&](int seed) {
+        while (groupOf[seed] != seed) {
+            seed = groupOf[seed];
+        }
+        return seed;
+    };
+
+    int groupsLeft = seedCount;
+    while (groupsLeft > 1) {
+        for (int i=0; i<seedCount && groupsLeft > 1; i++) {
+            if (queueStart[i] >= visited[i].size()) {
+                continue;
+            }
+
+            const int tile = visited[i][queueStart[i]++];
+            const int col = tile % m_cols;
+            const int row = tile / m_cols;
+
+            for (int n=0; n<8; n++) {
+                const int nx = col + s_offsetsX[n];
+                const int ny = row + s_offsetsY[n];
+                if (regionAt(nx, ny) != label) {
+                    continue;
+                }
+
+                const int neighbour = ny * m_cols + nx;
+                const int neighbourOwner = ownerOf(neighbour);
+                if (neighbourOwner < 0) {
+                    setOwner(neighbour, i);
+                    visited[i].push_back(neighbour);
+                    continue;
+                }
+
+                const int ourGroup = findGroup(i);
+                const int theirGroup = findGroup(neighbourOwner);
+                if (ourGroup != theirGroup) {
+                    groupOf[theirGroup] = ourGroup;
+                    groupsLeft--;
+                }
+            }
+        }
+
+        // Check if any of the groups are completely filled
+        for (int i=0; i<seedCount && groupsLeft > 1; i++) {
+            const int group = findGroup(i);
+            if (group != i || finished[group]) {
+                continue;
+            }
+
+            bool done = true;
+            for (int j=0; j<seedCount; j++) {
+                if (findGroup(j) == group && queueStart[j] < visited[j].size()) {
+                    done = false;
+                    break;
+                }
+            }
+            if (!done) {
+                continue;
+            }
+
+            finished[group] = true;
+            groupsLeft--;
+
+            const int split = newLabel();
+            for (int j=0; j<seedCount; j++) {
+                if (findGroup(j) != group) {
+                    continue;
+                }
+                for (const int tile : visited[j]) {
+                    m_labels[tile] = split;
+                }
+                m_sizes[split] += visited[j].size();
+                m_sizes[label] -= visited[j].size();
+            }
+        }
+    }
+}
+
+int RegionMap::relabel(const int seed, const int from, const int to) noexcept
+{
+    std::vector<int> queue;
+    queue.push_back(seed);
+    m_labels[seed] = to;
+
+    for (size_t i=0; i<queue.size(); i++) {
+        const int col = queue[i] % m_cols;
+        const int row = queue[i] / m_cols;
+
+        for (int n=0; n<8; n++) {
+            const int nx = col + s_offsetsX[n];
+            const int ny = row + s_offsetsY[n];
+            if (nx < 0 || ny < 0 || nx >= m_cols || ny >= m_rows) {
+                continue;
+            }
+
+            const int neighbour = ny * m_cols + nx;
+            if (m_labels[neighbour] != from) {
+                continue;
+            }
+
+            m_labels[neighbour] = to;
+            queue.push_back(neighbour);
+        }
+    }
+
+    return queue.size();
+}
+
+int RegionMap::newLabel() noexcept
+{
+    // Reuse the ones that got emptied, otherwise the sizes keep growing as buildings come and go
+    if (!m_freeLabels.empty()) {
+        const int label = m_freeLabels.back();
+        m_freeLabels.pop_back();
+        return label;
+    }
+
+    m_sizes.push_back(0);
+    return m_sizes.size() - 1;
+}
+
+int RegionMap::regionSize(const int region) const noexcept
+{
+    if (IS_UNLIKELY(region <= NoRegion || region >= int(m_sizes.size()))) {
+        return 0;
+    }
+
+    return m_sizes[region];
+}
+
+bool RegionMap::findClosestInRegion(const int region, const int col, const int row, int *closestCol, int *closestRow) const noexcept
+{
+    if (regionSize(region) <= 0) {
+        return false;
+    }
+
+    const std::shared_ptr<const ClosestTiles> closest = closestTiles(region);
+
+    // Outside the map the closest tile is the same as for the closest edge tile, near enough
+    const int tile = std::clamp(row, 0, m_rows - 1) * m_cols + std::clamp(col, 0, m_cols - 1);
+    const int found = closest->tiles[tile];
+    if (IS_UNLIKELY(found < 0)) {
+        return false;
+    }
+
+    *closestCol = found % m_cols;
+    *closestRow = found / m_cols;
+
+    return true;
+}
+
+std::shared_ptr<const RegionMap::ClosestTiles> RegionMap::closestTiles(const int region) const noexcept
+{
+    std::lock_guard<std::mutex> guard(m_closestTilesMutex);
+    for (const std::shared_ptr<const ClosestTiles> &cached : m_closestTiles) {
+        if (cached->region == region) {
+            return cached;
+        }
+    }
+
+    std::shared_ptr<ClosestTiles> closest = std::make_shared<ClosestTiles>();
+    closest->region = region;
+    std::vector<int32_t> &tiles = closest->tiles;
+    tiles.assign(m_cols * m_rows, -1);
+    for (size_t tile = 0; tile < m_labels.size(); tile++) {
+        if (m_labels[tile] == region) {
+            tiles[tile] = tile;
+        }
+    }
+
+    // Two passes over the map each way, every tile takes the closest of what its
+    // neighbours have found so far (8SSEDT). Can be off by a tiny bit in rare cases,
+    // but never picks anything outside the region.
+    const auto takeCloser = [&](const int col, const int row, const int otherCol, const int otherRow) {
+        if (otherCol < 0 || otherRow < 0 || otherCol >= m_cols || otherRow >= m_rows) {
+            return;
+        }
+
+        const int candidate = tiles[otherRow * m_cols + otherCol];
+        if (candidate < 0) {
+            return;
+        }
+
+        int32_t &current = tiles[row * m_cols + col];
+        if (current < 0) {
+            current = candidate;
+            return;
+        }
+
+        const int candidateX = candidate % m_cols - col, candidateY = candidate / m_cols - row;
+        const int currentX = current % m_cols - col, currentY = current / m_cols - row;
+        if (candidateX * candidateX + candidateY * candidateY < currentX * currentX + currentY * currentY) {
+            current = candidate;
+        }
+    };
+
+    for (int row = 0; row < m_rows; row++) {
+        for (int col = 0; col < m_cols; col++) {
+            takeCloser(col, row, col - 1, row);
+            takeCloser(col, row, col - 1, row - 1);
+            takeCloser(col, row, col, row - 1);
+            takeCloser(col, row, col + 1, row - 1);
+        }
+        for (int col = m_cols - 1; col >= 0; col--) {
+            takeCloser(col, row, col + 1, row);
+        }
+    }
+
+    for (int row = m_rows - 1; row >= 0; row--) {
+        for (int col = m_cols - 1; col >= 0; col--) {
+            takeCloser(col, row, col + 1, row);
+            takeCloser(col, row, col - 1, row + 1);
+            takeCloser(col, row, col, row + 1);
+            takeCloser(col, row, col + 1, row + 1);
+        }
+        for (int col = 0; col < m_cols; col++) {
+            takeCloser(col, row, col - 1, row);
+        }
+    }
+
+    if (m_closestTiles.size() >= MAX_CLOSEST_TILES) {
+        m_closestTiles.erase(m_closestTiles.begin());
+    }
+    m_closestTiles.push_back(closest);
+
+    return closest;
+}
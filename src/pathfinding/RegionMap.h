@@ -0,0 +1,86 @@
+#ifndef REGIONMAP_H
+#define REGIONMAP_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/// Labels every passable tile with the connected region it is in, so we can tell right
+/// away if a destination can be reached (e.g. on another island, or inside walls)
+/// instead of waiting for the searches to give up.
+/// Tiles are connected to all eight neighbours, the fine grained search cuts corners
+/// as well, so we never say something is unreachable when it isn't.
+class RegionMap
+{
+public:
+    typedef std::shared_ptr<const RegionMap> Ptr;
+    typedef std::function<bool(const int col, const int row)> PassableFunction;
+
+    /// Not passable
+    static constexpr int NoRegion = 0;
+
+    RegionMap(const int cols, const int rows);
+
+    /// Doesn't copy the closest tiles, they are recreated when needed
+    RegionMap(const RegionMap &other);
+
+    /// Labels everything from scratch
+    void rebuild(const PassableFunction &isPassable) noexcept;
+
+    /// Only updates the regions around the tiles that changed (indices are row * cols + col),
+    /// merging and splitting regions as needed
+    void update(const std::vector<int> &changedTiles, const PassableFunction &isPassable) noexcept;
+
+    inline int regionAt(const int col, const int row) const noexcept {
+        if (col < 0 || row < 0 || col >= m_cols || row >= m_rows) {
+            return NoRegion;
+        }
+        return m_labels[row * m_cols + col];
+    }
+
+    /// Finds the tile in the region that is closest to the target, returns false if the region is empty.
+    /// The first time a region is asked for it works out the closest tile for the whole map, after that it is a lookup.
+    bool findClosestInRegion(const int region, const int col, const int row, int *closestCol, int *closestRow) const noexcept;
+
+    int regionSize(const int region) const noexcept;
+
+private:
+    /// A distance transform of the region, with the closest tile in it for every tile on the map
+    struct ClosestTiles {
+        int region = NoRegion;
+        std::vector<int32_t> tiles;
+    };
+
+    std::shared_ptr<const ClosestTiles> closestTiles(const int region) const noexcept;
+
+    void addTile(const int tile) noexcept;
+    void splitRegion(const int label, const std::vector<int> &seeds) noexcept;
+
+    /// Flood fills from the seed, changing from one label to the other, returns how many tiles were changed
+    int relabel(const int seed, const int from, const int to) noexcept;
+
+    int newLabel() noexcept;
+
+    int m_cols = 0;
+    int m_rows = 0;
+
+    std::vector<int32_t> m_labels;
+    std::vector<int32_t> m_sizes;
+
+    /// Labels that don't have any tiles anymore, newLabel() takes from here first
+    std::vector<int32_t> m_freeLabels;
+
+    /// Which seed reached each tile in splitRegion, only valid where the
+    /// generation matches so we don't need to clear it for every split
+    std::vector<int32_t> m_splitOwners;
+    std::vector<uint32_t> m_splitGenerations;
+    uint32_t m_splitGeneration = 0;
+
+    /// Made when the path searches ask for them, cleared when the labels change
+    mutable std::mutex m_closestTilesMutex;
+    mutable std::vector<std::shared_ptr<const ClosestTiles>> m_closestTiles;
+};
+
+#endif // REGIONMAP_H
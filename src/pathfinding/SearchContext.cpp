@@ -0,0 +1,160 @@
+#include "SearchContext.h"
+
+#include <algorithm>
+#include <limits>
+#include <mutex>
+
+// How many pages we keep between searches, 64KB each.
+// A single search can go above it, but we start over on the next one
+static constexpr size_t MAX_KEPT_PAGES = 128;
+
+// Enough for all the pathfinding threads and a bunch of paused searches, anything above is freed
+static constexpr size_t MAX_KEPT_CONTEXTS = 16;
+
+namespace {
+struct FreeContexts {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<SearchContext>> contexts;
+};
+
+FreeContexts &freeContexts()
+{
+    static FreeContexts inst;
+    return inst;
+}
+}
+
+std::unique_ptr<SearchContext> SearchContext::acquire() noexcept
+{
+    FreeContexts &available = freeContexts();
+    std::lock_guard<std::mutex> guard(available.mutex);
+
+    if (available.contexts.empty()) {
+        return std::make_unique<SearchContext>();
+    }
+
+    std::unique_ptr<SearchContext> context = std::move(available.contexts.back());
+    available.contexts.pop_back();
+    return context;
+}
+
+void SearchContext::release(std::unique_ptr<SearchContext> context) noexcept
+{
+    // Don't keep huge ones around
+    if (!context || context->allocatedPages() > MAX_KEPT_PAGES) {
+        return;
+    }
+
+    FreeContexts &available = freeContexts();
+    std::lock_guard<std::mutex> guard(available.mutex);
+
+    if (available.contexts.size() < MAX_KEPT_CONTEXTS) {
+        available.contexts.push_back(std::move(context));
+    }
+}
+
+void SearchContext::begin(const int width, const int height) noexcept
+{
+    m_heap.clear();
+
+    if (width != m_width || height != m_height) {
+        m_width = width;
+        m_height = height;
+        m_pagesX = (width + PageSize - 1) / PageSize;
+        const int pagesY = (height + PageSize - 1) / PageSize;
+        m_directory.assign(m_pagesX * pagesY, -1);
+        m_usedDirectoryEntries.clear();
+        m_usedPages = 0;
+    }
+
+    if (m_usedPages > MAX_KEPT_PAGES) {
+        for (const int entry : m_usedDirectoryEntries) {
+            m_directory[entry] = -1;
+        }
+        m_usedDirectoryEntries.clear();
+        m_usedPages = 0;
+        m_pages.resize(MAX_KEPT_PAGES);
+    }
+
+    if (IS_UNLIKELY(m_closedStamp >= std::numeric_limits<uint32_t>::max() - 2)) {
+        for (std::unique_ptr<Page> &page : m_pages) {
+            for (Cell &cell : page->cells) {
+                cell.stamp = 0;
+                cell.passableStamp = 0;
+            }
+        }
+        m_openStamp = 0;
+        m_closedStamp = 1;
+    }
+
+    // Everything with an older stamp is now invalid
+    m_openStamp += 2;
+    m_closedStamp = m_openStamp + 1;
+}
+
+int32_t SearchContext::allocatePage(const int pageIndex) noexcept
+{
+    // Reused pages have older stamps, so they don't need to be cleared
+    if (m_usedPages >= m_pages.size()) {
+        m_pages.emplace_back(new Page);
+    }
+
+    m_directory[pageIndex] = m_usedPages;
+    m_usedDirectoryEntries.push_back(pageIndex);
+
+    return m_usedPages++;
+}
+
+void SearchContext::push(const float priority, const int x, const int y) noexcept
+{
+    size_t index = m_heap.size();
+    m_heap.push_back({priority, x, y});
+
+    const HeapEntry entry = m_heap[index];
+    while (index > 0) {
+        const size_t parent = (index - 1) / 4;
+        if (m_heap[parent].priority <= entry.priority) {
+            break;
+        }
+        m_heap[index] = m_heap[parent];
+        index = parent;
+    }
+    m_heap[index] = entry;
+}
+
+void SearchContext::pop(int *x, int *y) noexcept
+{
+    *x = m_heap[0].x;
+    *y = m_heap[0].y;
+
+    const HeapEntry entry = m_heap.back();
+    m_heap.pop_back();
+    if (m_heap.empty()) {
+        return;
+    }
+
+    const size_t size = m_heap.size();
+    size_t index = 0;
+    while (true) {
+        const size_t firstChild = index * 4 + 1;
+        if (firstChild >= size) {
+            break;
+        }
+
+        size_t best = firstChild;
+        const size_t lastChild = std::min(firstChild + 4, size);
+        for (size_t child = firstChild + 1; child < lastChild; child++) {
+            if (m_heap[child].priority < m_heap[best].priority) {
+                best = child;
+            }
+        }
+
+        if (entry.priority <= m_heap[best].priority) {
+            break;
+        }
+
+        m_heap[index] = m_heap[best];
+        index = best;
+    }
+    m_heap[index] = entry;
+}
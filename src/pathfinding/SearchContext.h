@@ -0,0 +1,110 @@
+#ifndef SEARCHCONTEXT_H
+#define SEARCHCONTEXT_H
+
+#include "core/Utility.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/// Everything the A* search needs per grid cell, kept around between searches so
+/// we don't allocate or clear anything per path.
+/// The grid is split into pages that are only allocated when a search gets there,
+/// the fine grained grids are way too big to have all of it in memory.
+/// Each search gets a new generation, cells stamped with an older one are just ignored.
+class SearchContext
+{
+public:
+    struct Cell {
+        float cost = 0.f;
+        int32_t parent = -1;
+        uint32_t stamp = 0;
+
+        /// The open stamp of the search that checked it, plus one if it is passable
+        uint32_t passableStamp = 0;
+    };
+
+    /// Searches can be paused and continued later on another thread, so each one
+    /// borrows a context until it is done and hands it back for the next one to reuse
+    static std::unique_ptr<SearchContext> acquire() noexcept;
+    static void release(std::unique_ptr<SearchContext> context) noexcept;
+
+    /// Starts a new search, width and height are in cells
+    void begin(const int width, const int height) noexcept;
+
+    inline bool isValid(const int x, const int y) const noexcept {
+        return x >= 0 && y >= 0 && x < m_width && y < m_height;
+    }
+
+    inline int index(const int x, const int y) const noexcept { return y * m_width + x; }
+    inline int xAt(const int index) const noexcept { return index % m_width; }
+    inline int yAt(const int index) const noexcept { return index / m_width; }
+
+    inline Cell &cell(const int x, const int y) noexcept {
+        const int pageIndex = (y >> PageShift) * m_pagesX + (x >> PageShift);
+        int32_t page = m_directory[pageIndex];
+        if (IS_UNLIKELY(page < 0)) {
+            page = allocatePage(pageIndex);
+        }
+        return m_pages[page]->cells[((y & PageMask) << PageShift) + (x & PageMask)];
+    }
+
+    inline bool isOpen(const Cell &cell) const noexcept { return cell.stamp == m_openStamp; }
+    inline bool isClosed(const Cell &cell) const noexcept { return cell.stamp == m_closedStamp; }
+
+    /// Open or closed in this search
+    inline bool isSeen(const Cell &cell) const noexcept { return cell.stamp >= m_openStamp; }
+
+    inline void open(Cell &cell, const float cost, const int32_t parent) noexcept {
+        cell.cost = cost;
+        cell.parent = parent;
+        cell.stamp = m_openStamp;
+    }
+    inline void close(Cell &cell) noexcept { cell.stamp = m_closedStamp; }
+
+    /// Passability is expensive to check and the snapshot doesn't change during a search
+    inline bool isPassableKnown(const Cell &cell) const noexcept { return (cell.passableStamp & ~1u) == m_openStamp; }
+    inline bool isPassable(const Cell &cell) const noexcept { return cell.passableStamp & 1u; }
+    inline void setPassable(Cell &cell, const bool passable) noexcept { cell.passableStamp = m_openStamp | passable; }
+
+    // Open list, a 4-ary heap because it is shallower and the children are next to each other in memory
+    inline bool queueEmpty() const noexcept { return m_heap.empty(); }
+    void push(const float priority, const int x, const int y) noexcept;
+    void pop(int *x, int *y) noexcept;
+
+    size_t allocatedPages() const noexcept { return m_pages.size(); }
+
+private:
+    static constexpr int PageShift = 6;
+    static constexpr int PageSize = 1 << PageShift;
+    static constexpr int PageMask = PageSize - 1;
+
+    struct Page {
+        Cell cells[PageSize * PageSize];
+    };
+
+    struct HeapEntry {
+        float priority;
+        int32_t x;
+        int32_t y;
+    };
+
+    int32_t allocatePage(const int pageIndex) noexcept;
+
+    int m_width = 0;
+    int m_height = 0;
+    int m_pagesX = 0;
+
+    // Two stamps per generation, one for open and one for closed, so the open one is always even
+    uint32_t m_openStamp = 0;
+    uint32_t m_closedStamp = 1;
+
+    std::vector<int32_t> m_directory;
+    std::vector<int> m_usedDirectoryEntries;
+    std::vector<std::unique_ptr<Page>> m_pages;
+    size_t m_usedPages = 0;
+
+    std::vector<HeapEntry> m_heap;
+};
+
+#endif // SEARCHCONTEXT_H
@@ -27,11 +27,13 @@
 #include <genie/dat/GraphicDelta.h>
 #include <resource/AssetManager.h>
 #include <algorithm>
+#include <cmath>
 #include <memory>
 #include <vector>
 
 #include "audio/AudioPlayer.h"
 #include "core/Logger.h"
+#include "core/TimerWheel.h"
 #include "core/Types.h"
 #include "render/GraphicRender.h"
 #include "resource/Graphic.h"
@@ -39,70 +41,45 @@
 bool GraphicRender::update(Time time, const bool isVisible) noexcept
 {
     m_frameChanged = false;
+    m_time = time;
 
-    bool updated = false;
-
-    if (isVisible) {
-        for (size_t i=0; i<m_deltas.size(); i++) {
-            if (!m_deltas[i].validForAngle(m_angle)) {
-                continue;
-            }
-
-            updated = m_deltas[i].graphic->update(time, isVisible) || updated;
-        }
-
-        if (m_damageOverlay) {
-            updated = m_damageOverlay->update(time, isVisible) || updated;
-        }
-    }
-
-    if (!m_graphic) {
-        return updated;
+    if (!m_animationStarted) {
+        m_animationStarted = true;
+        startAnimationFrom(m_currentFrame);
     }
-    if (!m_graphic->framerate()) {
-        return updated;
-    }
-
-    const bool isAtEnd = m_currentFrame >= m_graphic->frameCount() - 1;
 
-    // Just let it run out if we're not visible
-    if (isAtEnd && (m_graphic->runOnce() || !isVisible)) {
-        return updated;
+    // Nobody sees it, so there's nothing to do until someone does or asks for the frame
+    if (!isVisible) {
+        m_wasVisible = false;
+        return false;
     }
 
-    int newFrame = m_currentFrame;
+    bool updated = false;
 
-    Time elapsed = time - m_lastFrameTime;
+    for (size_t i=0; i<m_deltas.size(); i++) {
+        if (!m_deltas[i].validForAngle(m_angle)) {
+            continue;
+        }
 
-    if (isAtEnd && elapsed < m_graphic->replayDelay() / 0.0015) {
-        return updated;
+        updated = m_deltas[i].graphic->update(time, isVisible) || updated;
     }
 
-    if (m_lastFrameTime == 0) {
-        m_lastFrameTime = time;
-        newFrame = 0;
-    } else if (elapsed > m_graphic->framerate() / 0.0015) {
-        if (newFrame < m_graphic->frameCount() - 1) {
-            newFrame++;
-        } else {
-            newFrame = 0;
-
-            m_currentSound++;
-            if (m_currentSound > 2) {
-                m_currentSound = 0;
-            }
-        }
-
-        m_lastFrameTime = time;
+    if (m_damageOverlay) {
+        updated = m_damageOverlay->update(time, isVisible) || updated;
     }
 
-    if (newFrame != m_currentFrame) {
+    const int newFrame = frameAt(time);
+
+    // Don't play sounds for whatever frame it happens to be at when it comes into view
+    if (newFrame != m_currentFrame && m_wasVisible) {
         m_frameChanged = true;
     }
 
+    updated = updated || newFrame != m_currentFrame;
     m_currentFrame = newFrame;
+    m_wasVisible = true;
 
-    return updated || m_frameChanged;
+    return updated;
 }
 
 inline bool GraphicRender::isValid() const noexcept
@@ -110,8 +87,11 @@ inline bool GraphicRender::isValid() const noexcept
     return m_graphic && m_graphic->isValid();
 }
 
-void GraphicRender::render(sf::RenderTarget &renderTarget, const ScreenPos screenPos, const RenderType renderpass) noexcept
+void GraphicRender::render(sf::RenderTarget &renderTarget, const ScreenPos screenPos, const RenderType renderpass, const Time time) noexcept
 {
+    // Might not have been updated since it came into view, or at all if the unit is sleeping
+    m_currentFrame = frameAt(std::max(m_time, time));
+
     if (m_frameChanged && m_playSounds) {
         m_frameChanged = false;
 
@@ -127,7 +107,7 @@ void GraphicRender::render(sf::RenderTarget &renderTarget, const ScreenPos scree
             continue;
         }
 
-        delta.graphic->render(renderTarget, screenPos + delta.offset, renderpass);
+        delta.graphic->render(renderTarget, screenPos + delta.offset, renderpass, time);
     }
 
     if (m_graphic && m_graphic->isValid()) {
@@ -174,7 +154,7 @@ void GraphicRender::render(sf::RenderTarget &renderTarget, const ScreenPos scree
 
 
     if (m_damageOverlay) {
-        m_damageOverlay->render(renderTarget, screenPos, renderpass);
+        m_damageOverlay->render(renderTarget, screenPos, renderpass, time);
     }
 }
 
@@ -238,8 +218,8 @@ bool GraphicRender::setGraphic(const GraphicPtr &graphic) noexcept
 
     m_graphic = graphic;
     m_currentFrame = 0;
-    m_currentSound = 0;
     m_frameChanged = true;
+    m_animationStarted = false;
     m_deltas.clear();
 
     if (!graphic) {
@@ -289,11 +269,13 @@ ScreenRect GraphicRender::rect() const noexcept
         return ScreenRect();
     }
 
+    const int frame = currentFrame();
+
     ScreenRect ret;
-    const ScreenPos hotspot = m_graphic->getHotspot(m_currentFrame, m_angle);
+    const ScreenPos hotspot = m_graphic->getHotspot(frame, m_angle);
     ret.x = -hotspot.x;
     ret.y = -hotspot.y;
-    const sf::Vector2u size = m_graphic->size(m_currentFrame, m_angle);
+    const sf::Vector2u size = m_graphic->size(frame, m_angle);
     ret.width = size.x;
     ret.height = size.y;
 
@@ -325,9 +307,10 @@ bool GraphicRender::checkClick(const ScreenPos &pos) const noexcept
     if (!isValid()) {
         return false;
     }
-    const ScreenPos correctedPos = pos + m_graphic->getHotspot(m_currentFrame, m_angle);
+    const int frame = currentFrame();
+    const ScreenPos correctedPos = pos + m_graphic->getHotspot(frame, m_angle);
 
-    if (m_graphic->checkClick(correctedPos, m_currentFrame, m_angle)) {
+    if (m_graphic->checkClick(correctedPos, frame, m_angle)) {
         return true;
     }
 
@@ -376,12 +359,33 @@ int GraphicRender::frameCount() const noexcept
     return m_graphic ? m_graphic->frameCount() : 0;
 }
 
-void GraphicRender::setCurrentFrame(int frame) noexcept
+bool GraphicRender::isAnimating() const noexcept
 {
-    if (frame == m_currentFrame) {
-        return;
+    for (const GraphicDelta &delta : m_deltas) {
+        if (delta.graphic->isAnimating()) {
+            return true;
+        }
     }
 
+    if (m_damageOverlay && m_damageOverlay->isAnimating()) {
+        return true;
+    }
+
+    if (!m_graphic || !m_graphic->framerate() || m_graphic->frameCount() <= 1) {
+        return false;
+    }
+
+    // Looping animations are drawn at whatever frame they are at when rendering, they don't need updating
+    return m_graphic->runOnce() && currentFrame() < m_graphic->frameCount() - 1;
+}
+
+int GraphicRender::currentFrame() const noexcept
+{
+    return frameAt(m_time);
+}
+
+void GraphicRender::setCurrentFrame(int frame) noexcept
+{
     if (frame >= frameCount()) {
         frame = frameCount() - 1;
     }
@@ -390,6 +394,38 @@ void GraphicRender::setCurrentFrame(int frame) noexcept
     }
 
     m_currentFrame = frame;
+    m_animationStarted = false;
+}
+
+int GraphicRender::frameAt(const Time time) const noexcept
+{
+    if (!m_animationStarted || !m_graphic || !m_graphic->framerate() || m_graphic->frameCount() <= 1) {
+        return m_currentFrame;
+    }
+
+    const int lastFrame = m_graphic->frameCount() - 1;
+    const double frameTime = gameSecondsToMs(m_graphic->framerate());
+    const double elapsed = std::max(time - m_animationStart, Time(0));
+
+    if (m_graphic->runOnce()) {
+        return std::min(int(elapsed / frameTime), lastFrame);
+    }
+
+    // The last frame stays up until the replay delay has passed
+    const double lastFrameTime = std::max(frameTime, gameSecondsToMs(m_graphic->replayDelay()));
+    const double loopTime = lastFrame * frameTime + lastFrameTime;
+    return std::min(int(std::fmod(elapsed, loopTime) / frameTime), lastFrame);
+}
+
+void GraphicRender::startAnimationFrom(const int frame) noexcept
+{
+    if (!m_graphic || !m_graphic->framerate()) {
+        m_animationStart = m_time;
+        return;
+    }
+
+    // Rounded up so it doesn't end up just short of the frame
+    m_animationStart = m_time - Time(std::ceil(gameSecondsToMs(frame * m_graphic->framerate())));
 }
 
 void GraphicRender::maybePlaySound(const float pan, const float volume) noexcept
@@ -83,10 +83,13 @@ class GraphicRender
 public:
     virtual ~GraphicRender() = default;
 
+    /// Off screen it only keeps track of the time, the frame is worked out from when the
+    /// animation started when it is needed. Deltas and the damage overlay are left alone.
     bool update(Time time, const bool isVisible) noexcept;
     inline bool isValid() const noexcept;
 
-    virtual void render(sf::RenderTarget &renderTarget, const ScreenPos screenPos, const RenderType renderpass) noexcept;
+    /// Draws the frame the animation is at by the time given, so things that aren't updated keep animating
+    virtual void render(sf::RenderTarget &renderTarget, const ScreenPos screenPos, const RenderType renderpass, const Time time) noexcept;
 
     void setPlayerColor(int playerColor) noexcept;
     void setCivId(int civId) noexcept { m_civId = civId; }
@@ -108,14 +111,25 @@ public:
 
     int frameCount() const noexcept;
 
-    inline int currentFrame() const noexcept { return m_currentFrame; }
+    int currentFrame() const noexcept;
+
+    /// The animation carries on from this frame when it is next updated
     void setCurrentFrame(int frame) noexcept;
 
+    /// If it is playing a run-once animation that hasn't ended (like dying), which has to be updated to get to the end
+    bool isAnimating() const noexcept;
+
     void setPlaySounds(bool playSound) noexcept { m_playSounds = playSound; }
 
 private:
     void maybePlaySound(const float pan, const float volume) noexcept;
 
+    /// Where the animation is at the time, counted from when it started
+    int frameAt(const Time time) const noexcept;
+
+    /// Moves the start of the animation so it is at the frame now
+    void startAnimationFrom(const int frame) noexcept;
+
     struct GraphicDelta {
         inline bool validForAngle(const float angle) const noexcept;
 
@@ -124,12 +138,22 @@ private:
         int angleToDrawOn = -1;
     };
 
-    Time m_lastFrameTime = 0;
+    /// The time of the last update
+    Time m_time = 0;
+
+    /// When the animation was (or would have been) at the first frame
+    Time m_animationStart = 0;
+
+    /// A new graphic or frame stays put until the next update, that is when we know what time
+    /// it is (a sleeping unit getting killed hasn't been updated for a while)
+    bool m_animationStarted = false;
+
     std::vector<GraphicDelta> m_deltas;
 
     int m_playerColor = 0;
     int m_civId = 0;
 
+    // The frame last shown, or the one set if it isn't animated
     int m_currentFrame = 0;
     float m_angle = 0;
     GraphicPtr m_graphic;
@@ -137,7 +161,7 @@ private:
     std::unique_ptr<GraphicRender> m_damageOverlay;
 
     bool m_frameChanged = false;
-    int m_currentSound = 0;
+    bool m_wasVisible = false;
     bool m_playSounds = false;
 };
 
@@ -183,6 +183,9 @@ public:
 
     virtual void clear(const Drawable::Color &color = Drawable::Color(0, 0, 0, 255)) = 0;
 
+    /// Replaces what is in the rect with the color, instead of drawing on top of it
+    virtual void clear(const ScreenRect &rect, const Drawable::Color &color) = 0;
+
 
 protected:
     CameraPtr m_camera;
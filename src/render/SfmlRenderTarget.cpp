@@ -23,6 +23,7 @@
 #include "fonts/Alegreya/Alegreya-Bold.latin.h"
 #include "fonts/BerryRotunda/BerryRotunda.ttf.h"
 
+#include <SFML/Graphics/BlendMode.hpp>
 #include <SFML/Graphics/Font.hpp>
 #include <SFML/Graphics/Rect.hpp>
 #include <SFML/Graphics/RectangleShape.hpp>
@@ -282,6 +283,16 @@ void SfmlRenderTarget::clear(const Drawable::Color &color)
     renderTarget_->clear(convertColor(color));
 }
 
+void SfmlRenderTarget::clear(const ScreenRect &rect, const Drawable::Color &color)
+{
+    sf::RectangleShape shape;
+    shape.setFillColor(convertColor(color));
+    shape.setPosition(rect.topLeft());
+    shape.setSize(rect.size());
+
+    renderTarget_->draw(shape, sf::BlendNone);
+}
+
 
 void SfmlRenderTarget::draw(const std::shared_ptr<IRenderTarget> &renderTarget, const ScreenPos &pos)
 {
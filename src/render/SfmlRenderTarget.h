@@ -94,6 +94,7 @@ public:
     std::shared_ptr<IRenderTarget> createTextureTarget(const Size &size) override;
 
     void clear(const Drawable::Color &color = Drawable::Color(0, 0, 0, 255)) override;
+    void clear(const ScreenRect &rect, const Drawable::Color &color) override;
 
     std::unique_ptr<sf::RenderTexture> m_renderTexture;
 
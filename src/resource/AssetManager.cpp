@@ -228,8 +228,10 @@ GraphicPtr AssetManager::getGraphic(uint32_t id)
 //------------------------------------------------------------------------------
 const TerrainPtr &AssetManager::getTerrain(uint32_t id)
 {
-    if (terrains_.find(id) != terrains_.end()) {
-        return terrains_[id];
+    // Only look up, so it is safe from several threads once they are all loaded
+    TerrainMap::const_iterator it = terrains_.find(id);
+    if (it != terrains_.end()) {
+        return it->second;
     }
 
     TerrainPtr terrain = std::make_shared<TerrainSprite>(id);
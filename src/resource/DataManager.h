@@ -57,6 +57,7 @@ public:
     const genie::Terrain &getTerrain(unsigned int id) const;
     const genie::Effect &getEffect(unsigned int id) const;
     const genie::TerrainRestriction &getTerrainRestriction(unsigned int id) const;
+    size_t terrainRestrictionCount() const { return dat_file_.TerrainRestrictions.size(); }
     const genie::PlayerColour &getPlayerColor(unsigned int id) const;
     const genie::Sound &getSound(unsigned int id) const;
     const std::vector<genie::Task> &getTasks(unsigned int id) const;
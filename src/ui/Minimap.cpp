@@ -84,12 +84,12 @@ void Minimap::setVisibilityMap(const std::shared_ptr<VisibilityMap> &visibilityM
 
 void Minimap::updateUnits()
 {
-    m_unitsUpdated = true;
+    m_changedUnits.add(m_map->changedUnitsRegion());
 }
 
 void Minimap::updateTerrain()
 {
-    m_terrainUpdated = true;
+    m_changedTerrain.add(m_map->changedTerrainRegion());
 }
 
 void Minimap::updateCamera()
@@ -199,24 +199,44 @@ bool Minimap::update(Time /*time*/)
         m_lastCameraPos = m_renderTarget->camera()->m_target;
     }
 
-    if (!m_map || (!m_unitsUpdated && !m_terrainUpdated)) {
+    if (!m_map) {
+        return false;
+    }
+
+    const bool terrainChanged = m_terrainUpdated || !m_changedTerrain.isEmpty();
+    const bool unitsChanged = (m_unitsUpdated || !m_changedUnits.isEmpty()) && m_unitManager;
+    if (!terrainChanged && !unitsChanged) {
         return false;
     }
 
+    if (terrainChanged) {
+        redrawTerrain();
+    }
+
+    if (unitsChanged) {
+        redrawUnits();
+    }
+
+    return true;
+}
+
+void Minimap::redrawTerrain()
+{
+    if (!m_terrainTexture ||  m_terrainTexture->getSize() != m_rect.size()) {
+        DBG << "recreating terrain";
+        m_terrainTexture = m_renderTarget->createTextureTarget(m_rect.size());
+        m_terrainUpdated = true;
+    }
+
     const MapRect mapDimensions(0, 0, m_map->getCols(), m_map->getRows());
+    const float scaleX = m_rect.boundingMapRect().width / mapDimensions.width / 2;
+    const float scaleY = m_rect.boundingMapRect().height / mapDimensions.height / 2;
 
+    MapRegion region;
     if (m_terrainUpdated) {
         DBG << "redrawing terrain";
-        if (!m_terrainTexture ||  m_terrainTexture->getSize() != m_rect.size()) {
-            DBG << "recreating terrain";
-            m_terrainTexture = m_renderTarget->createTextureTarget(m_rect.size());
-        }
-
         m_terrainTexture->clear(Drawable::Transparent);
 
-        const float scaleX = m_rect.boundingMapRect().width / mapDimensions.width / 2;
-        const float scaleY = m_rect.boundingMapRect().height / mapDimensions.height / 2;
-
         Drawable::Circle background;
         background.aspectRatio = m_rect.height / m_rect.width;
         background.radius = std::floor(m_rect.width / 2);
@@ -225,120 +245,155 @@ bool Minimap::update(Time /*time*/)
         background.filled = true;
         m_terrainTexture->draw(background);
 
-        Drawable::Circle tileShape;
-        tileShape.aspectRatio =  m_rect.height / m_rect.width;
-        tileShape.radius = scaleY;
-        tileShape.filled = true;
-        tileShape.pointCount = 4;
-        const ScreenPos center(m_rect.width/2, m_rect.height/2);
-
-        const std::vector<genie::Color> &colors = AssetManager::Inst()->getPalette(50500).getColors();
-        for (int col = 0; col < m_map->getCols(); col++) {
-            for (int row = 0; row < m_map->getRows(); row++) {
-                const VisibilityMap::Visibility visibility = m_visibilityMap->visibilityAt(col, row);
-                if (visibility == VisibilityMap::Unexplored) {
-                    continue;
-                }
-
-                const MapTile &tile = m_map->getTileAt(col, row);
-                const genie::Terrain &terrain = DataManager::Inst().getTerrain(tile.terrainId);
-                const genie::Color &color = colors[terrain.Colors[0]];
-                if (visibility == VisibilityMap::Explored) {
-                    tileShape.fillColor = Drawable::Color(color.r/2, color.g/2, color.b/2);
-                } else {
-                    tileShape.fillColor = Drawable::Color(color.r, color.g, color.b);
-                }
-
-                // WTF TODO FIXME why the fuck is flipping row and col the correct here..
-                const ScreenPos pos = MapPos(row * scaleX, col * scaleY).toScreen();
-                tileShape.center = ScreenPos(pos.x, pos.y + center.y - scaleY / 2);
-                m_terrainTexture->draw(tileShape);
+        region.add(0, 0, m_map->getCols() - 1, m_map->getRows() - 1);
+    } else {
+        // The tiles overlap the edges of their neighbours a bit, so the ones around are redrawn on top like when drawing everything
+        region.add(std::max(m_changedTerrain.firstCol, 0), std::max(m_changedTerrain.firstRow, 0),
+                   std::min(m_changedTerrain.lastCol + 1, m_map->getCols() - 1), std::min(m_changedTerrain.lastRow + 1, m_map->getRows() - 1));
+    }
+
+    m_terrainUpdated = false;
+    m_changedTerrain.clear();
+
+    Drawable::Circle tileShape;
+    tileShape.aspectRatio =  m_rect.height / m_rect.width;
+    tileShape.radius = scaleY;
+    tileShape.filled = true;
+    tileShape.pointCount = 4;
+    const ScreenPos center(m_rect.width/2, m_rect.height/2);
+
+    const std::vector<genie::Color> &colors = AssetManager::Inst()->getPalette(50500).getColors();
+    for (int col = region.firstCol; col <= region.lastCol; col++) {
+        for (int row = region.firstRow; row <= region.lastRow; row++) {
+            const VisibilityMap::Visibility visibility = m_visibilityMap->visibilityAt(col, row);
+            if (visibility == VisibilityMap::Unexplored) {
+                continue;
+            }
 
+            const MapTile &tile = m_map->getTileAt(col, row);
+            const genie::Terrain &terrain = DataManager::Inst().getTerrain(tile.terrainId);
+            const genie::Color &color = colors[terrain.Colors[0]];
+            if (visibility == VisibilityMap::Explored) {
+                tileShape.fillColor = Drawable::Color(color.r/2, color.g/2, color.b/2);
+            } else {
+                tileShape.fillColor = Drawable::Color(color.r, color.g, color.b);
             }
+
+            // WTF TODO FIXME why the fuck is flipping row and col the correct here..
+            const ScreenPos pos = MapPos(row * scaleX, col * scaleY).toScreen();
+            tileShape.center = ScreenPos(pos.x, pos.y + center.y - scaleY / 2);
+            m_terrainTexture->draw(tileShape);
+
         }
+    }
 
-        m_terrainTexture->display();
+    m_terrainTexture->display();
+}
+
+void Minimap::redrawUnits()
+{
+    TIME_THIS;
 
-        m_terrainUpdated = false;
+    if (!m_unitsTexture || m_unitsTexture->getSize() != m_rect.size()) {
+        m_unitsTexture = m_renderTarget->createTextureTarget(m_rect.size());
+        m_unitsUpdated = true;
     }
 
-    if (m_unitsUpdated && m_unitManager) {
-        TIME_THIS;
+    const MapRect mapDimensions(0, 0, m_map->getCols(), m_map->getRows());
+    const float scaleX = m_rect.boundingMapRect().width / mapDimensions.width / 2;
+    const float scaleY = m_rect.boundingMapRect().height / mapDimensions.height / 2;
 
-        if (!m_unitsTexture || m_unitsTexture->getSize() != m_rect.size()) {
-            m_unitsTexture = m_renderTarget->createTextureTarget(m_rect.size());
-        }
+    const ScreenPos center(m_rect.width/2, m_rect.height/2);
+
+    // Where on the minimap the unit at this position (in tiles) is drawn around
+    const auto minimapPos = [&](const float col, const float row) {
+        const ScreenPos pos = MapPos(row, col - 1).toScreen();
+        return ScreenPos(pos.x * scaleX, pos.y * scaleY + center.y);
+    };
+
+    // Empty when redrawing everything
+    ScreenRect dirtyRect;
+    if (m_unitsUpdated) {
         m_unitsTexture->clear(Drawable::Transparent);
+    } else {
+        const MapRegion &region = m_changedUnits;
+        dirtyRect = ScreenRect(minimapPos(region.firstCol, region.firstRow), minimapPos(region.lastCol + 1, region.lastRow + 1));
+        dirtyRect += ScreenRect(minimapPos(region.lastCol + 1, region.firstRow), minimapPos(region.firstCol, region.lastRow + 1));
+
+        // Units that were on the tiles are drawn around them, a unit is drawn up to twice its size from its position
+        const float margin = 2.f * m_largestUnitSize;
+        dirtyRect = ScreenRect(dirtyRect.x - margin, dirtyRect.y - margin, dirtyRect.width + 2 * margin, dirtyRect.height + 2 * margin);
+        m_unitsTexture->clear(dirtyRect, Drawable::Transparent);
+    }
 
+    m_unitsUpdated = false;
+    m_changedUnits.clear();
 
-        const MapRect mapDimensions(0, 0, m_map->getCols(), m_map->getRows());
-        const float scaleX = m_rect.boundingMapRect().width / mapDimensions.width / 2;
-        const float scaleY = m_rect.boundingMapRect().height / mapDimensions.height / 2;
+    Drawable::Circle diamondSprite;
+    diamondSprite.pointCount = 4;
+    diamondSprite.radius = scaleY;
+    diamondSprite.aspectRatio = m_rect.height / m_rect.width;
+    diamondSprite.filled = true;
 
-        const ScreenPos center(m_rect.width/2, m_rect.height/2);
+    Drawable::Rect rectangleSprite;
+    rectangleSprite.filled = true;
 
-        Drawable::Circle diamondSprite;
-        diamondSprite.pointCount = 4;
-        diamondSprite.radius = scaleY;
-        diamondSprite.aspectRatio = m_rect.height / m_rect.width;
-        diamondSprite.filled = true;
+    const std::vector<genie::Color> &colors = AssetManager::Inst()->getPalette(50500).getColors();
 
-        Drawable::Rect rectangleSprite;
-        rectangleSprite.filled = true;
+    for (const Unit::Ptr &unit : m_unitManager->units()) {
+        const MapPos mapPos = unit->position();
+        ScreenPos pos = minimapPos(mapPos.x / Constants::TILE_SIZE, mapPos.y / Constants::TILE_SIZE);
+        float size = std::max(unit->data()->OutlineSize.x * scaleX * 2, 2.f);
+        pos.x -= size/2;
+        pos.y -= size/2;
 
-        const std::vector<genie::Color> &colors = AssetManager::Inst()->getPalette(50500).getColors();
+        // Everything else is still there from before
+        if (!dirtyRect.isEmpty() && dirtyRect.intersected(ScreenRect(pos, Size(2 * size, 2 * size))).isEmpty()) {
+            continue;
+        }
 
-        for (const Unit::Ptr &unit : m_unitManager->units()) {
-            const VisibilityMap::Visibility visibility = m_visibilityMap->visibilityAt(unit->position());
-            if (visibility == VisibilityMap::Unexplored) {
-                continue;
-            }
-            if (visibility == VisibilityMap::Explored && unit->playerId != UnitManager::GaiaID) {
-                continue;
-            }
+        const VisibilityMap::Visibility visibility = m_visibilityMap->visibilityAt(unit->position());
+        if (visibility == VisibilityMap::Unexplored) {
+            continue;
+        }
+        if (visibility == VisibilityMap::Explored && unit->playerId != UnitManager::GaiaID) {
+            continue;
+        }
 
-            const genie::Unit::MinimapModes mode = genie::Unit::MinimapModes(unit->data()->MinimapMode);
-            if (mode == genie::Unit::MinimapInvisible) {
-                continue;
-            }
-            if (mode == genie::Unit::MinimapFlying) {
-                continue;
-            }
+        const genie::Unit::MinimapModes mode = genie::Unit::MinimapModes(unit->data()->MinimapMode);
+        if (mode == genie::Unit::MinimapInvisible) {
+            continue;
+        }
+        if (mode == genie::Unit::MinimapFlying) {
+            continue;
+        }
 
-            if (mode != genie::Unit::MinimapUnit && mode != genie::Unit::MinimapBuilding && mode != genie::Unit::MinimapLargeTerrain) {
-                DBG << "Unhandled minimap mode" << int(mode) << unit->data()->MinimapColor;
-                continue;
-            }
+        if (mode != genie::Unit::MinimapUnit && mode != genie::Unit::MinimapBuilding && mode != genie::Unit::MinimapLargeTerrain) {
+            DBG << "Unhandled minimap mode" << int(mode) << unit->data()->MinimapColor;
+            continue;
+        }
 
-            const MapPos mapPos = unit->position();
-            ScreenPos pos = MapPos(mapPos.y / Constants::TILE_SIZE, mapPos.x / Constants::TILE_SIZE - 1).toScreen();
-            float size = std::max(unit->data()->OutlineSize.x * scaleX * 2, 2.f);
-            pos.x = pos.x * scaleX - size/2;
-            pos.y = pos.y * scaleY + center.y - size/2;
-
-            // WARN: according to genieutils this is the inverted of what the game officially does,
-            // but squares on the minimap look soooo ugly
-            if (mode == genie::Unit::MinimapBuilding) {
-                rectangleSprite.rect = ScreenRect(pos, Size(size, size));
-                rectangleSprite.fillColor = unitColor(unit);
-                m_unitsTexture->draw(rectangleSprite);
-            } else if (mode == genie::Unit::MinimapUnit) {
-                diamondSprite.fillColor = unitColor(unit);
-                diamondSprite.center = pos;
-                diamondSprite.radius = size;
-                m_unitsTexture->draw(diamondSprite);
-            } else if (mode == genie::Unit::MinimapLargeTerrain) {
-                rectangleSprite.rect = ScreenRect(pos, Size(size, size));
-                const genie::Color &color = colors[unit->data()->MinimapColor];
-                rectangleSprite.fillColor = Drawable::Color(color.r, color.g, color.b);
-                m_unitsTexture->draw(rectangleSprite);
-            }
+        m_largestUnitSize = std::max(m_largestUnitSize, size);
+
+        // WARN: according to genieutils this is the inverted of what the game officially does,
+        // but squares on the minimap look soooo ugly
+        if (mode == genie::Unit::MinimapBuilding) {
+            rectangleSprite.rect = ScreenRect(pos, Size(size, size));
+            rectangleSprite.fillColor = unitColor(unit);
+            m_unitsTexture->draw(rectangleSprite);
+        } else if (mode == genie::Unit::MinimapUnit) {
+            diamondSprite.fillColor = unitColor(unit);
+            diamondSprite.center = pos;
+            diamondSprite.radius = size;
+            m_unitsTexture->draw(diamondSprite);
+        } else if (mode == genie::Unit::MinimapLargeTerrain) {
+            rectangleSprite.rect = ScreenRect(pos, Size(size, size));
+            const genie::Color &color = colors[unit->data()->MinimapColor];
+            rectangleSprite.fillColor = Drawable::Color(color.r, color.g, color.b);
+            m_unitsTexture->draw(rectangleSprite);
         }
-        m_unitsTexture->display();
-        m_unitsUpdated = false;
     }
-
-    return true;
+    m_unitsTexture->display();
 }
 
 void Minimap::draw()
@@ -5,9 +5,9 @@
 
 #include "core/Types.h"
 #include "mechanics/IState.h"
+#include "mechanics/Map.h"
 #include "render/IRenderTarget.h"
 
-class Map;
 class UnitManager;
 namespace sf {
 class Event;
@@ -44,8 +44,19 @@ private:
     void updateCamera();
     Drawable::Color unitColor(const std::shared_ptr<Unit> &unit);
 
+    void redrawTerrain();
+    void redrawUnits();
+
+    // Redraw everything
     bool m_unitsUpdated = false;
     bool m_terrainUpdated = false;
+
+    // Only redraw what the map has signalled changes for
+    MapRegion m_changedUnits;
+    MapRegion m_changedTerrain;
+
+    /// The largest unit drawn so far, so we know how far outside the changed tiles to clear
+    float m_largestUnitSize = 0.f;
     std::shared_ptr<Map> m_map;
     std::shared_ptr<UnitManager> m_unitManager;
     IRenderTargetPtr m_renderTarget;
@@ -0,0 +1,141 @@
+#ifndef ARGUMENTPARSER_H
+#define ARGUMENTPARSER_H
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "core/Logger.h"
+
+// The command line handling shared by the benchmarks and checks, they all take
+// the game path first and then "--name value" pairs.
+
+class ArgumentParser
+{
+public:
+    ArgumentParser(const std::string &positionalName) :
+        m_positionalName(positionalName)
+    {
+    }
+
+    void add(const std::string &name, const std::string &valueName, const std::string &description, std::string *target)
+    {
+        addOption(name, valueName, description, [target](const std::string &value) {
+            *target = value;
+        });
+    }
+
+    void add(const std::string &name, const std::string &valueName, const std::string &description, int *target, const int min, const int max)
+    {
+        addOption(name, valueName, description, [target, min, max](const std::string &value) {
+            *target = std::clamp(parseNumber<int>(value, [](const std::string &string, size_t *end) { return std::stoi(string, end); }), min, max);
+        });
+    }
+
+    void add(const std::string &name, const std::string &valueName, const std::string &description, unsigned *target)
+    {
+        addOption(name, valueName, description, [target](const std::string &value) {
+            if (value.find('-') != std::string::npos) {
+                throw std::invalid_argument("negative");
+            }
+            const unsigned long parsed = parseNumber<unsigned long>(value, [](const std::string &string, size_t *end) { return std::stoul(string, end); });
+            if (parsed > std::numeric_limits<unsigned>::max()) {
+                throw std::out_of_range("too large");
+            }
+            *target = parsed;
+        });
+    }
+
+    void add(const std::string &name, const std::string &valueName, const std::string &description, float *target)
+    {
+        addOption(name, valueName, description, [target](const std::string &value) {
+            *target = parseNumber<float>(value, [](const std::string &string, size_t *end) { return std::stof(string, end); });
+        });
+    }
+
+    /// Returns false if something is missing or invalid, after saying what
+    bool parse(int argc, char *argv[], std::string *positional) const
+    {
+        if (argc < 2) {
+            return false;
+        }
+        *positional = argv[1];
+
+        for (int i = 2; i < argc; i++) {
+            const std::string argument = argv[i];
+            const std::vector<Option>::const_iterator option = std::find_if(m_options.begin(), m_options.end(), [&](const Option &o) {
+                return o.name == argument;
+            });
+            if (option == m_options.end()) {
+                WARN << "Unknown argument" << argument;
+                return false;
+            }
+
+            if (i + 1 >= argc) {
+                WARN << "Missing value for" << argument;
+                return false;
+            }
+            const std::string value = argv[++i];
+
+            try {
+                option->parse(value);
+            } catch (const std::invalid_argument &) {
+                WARN << "Invalid value for" << argument << value;
+                return false;
+            } catch (const std::out_of_range &) {
+                WARN << "Value out of range for" << argument << value;
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void printUsage(const char *name) const
+    {
+        size_t width = 0;
+        for (const Option &option : m_options) {
+            width = std::max(width, option.name.size() + option.valueName.size() + 1);
+        }
+
+        std::cerr << "Usage: " << name << " " << m_positionalName << " [options]\n";
+        for (const Option &option : m_options) {
+            const std::string column = option.name + " " + option.valueName;
+            std::cerr << "  " << column << std::string(width - column.size() + 2, ' ') << option.description << "\n";
+        }
+    }
+
+private:
+    struct Option {
+        std::string name;
+        std::string valueName;
+        std::string description;
+        std::function<void(const std::string &value)> parse;
+    };
+
+    void addOption(const std::string &name, const std::string &valueName, const std::string &description, const std::function<void(const std::string &value)> &parse)
+    {
+        m_options.push_back({name, valueName, description, parse});
+    }
+
+    /// The std::sto* functions accept trailing garbage, we don't
+    template<typename T, typename Function>
+    static T parseNumber(const std::string &value, const Function &convert)
+    {
+        size_t end = 0;
+        const T parsed = convert(value, &end);
+        if (end != value.size()) {
+            throw std::invalid_argument("trailing characters");
+        }
+        return parsed;
+    }
+
+    std::string m_positionalName;
+    std::vector<Option> m_options;
+};
+
+#endif // ARGUMENTPARSER_H
@@ -0,0 +1,214 @@
+#include <genie/script/ScnFile.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ArgumentParser.h"
+#include "Engine.h"
+#include "core/Constants.h"
+#include "core/JobSystem.h"
+#include "core/Logger.h"
+#include "mechanics/Map.h"
+#include "mechanics/Player.h"
+#include "mechanics/Unit.h"
+#include "mechanics/UnitFactory.h"
+#include "mechanics/UnitManager.h"
+#include "pathfinding/PathfinderPool.h"
+#include "resource/AssetManager.h"
+#include "resource/DataManager.h"
+
+// Runs the same fight with the job system on one thread and on all of them, and checks that
+// every unit ends up in the same state after every tick.
+// Only the auto target search and the movement thinking run on the job threads, both only read
+// the state of the other units and what they come up with is applied in a fixed order afterwards,
+// so the thread count isn't supposed to make any difference.
+
+static const int GRASS = 0;
+
+struct Options {
+    std::string gamePath;
+    int size = 48;
+
+    /// Per player
+    int units = 20;
+
+    int ticks = 600;
+    unsigned seed = 1;
+};
+
+struct RunResult {
+    std::vector<uint64_t> stateHashes;
+};
+
+static ArgumentParser argumentParser(Options *options)
+{
+    ArgumentParser parser("<game path>");
+    parser.add("--size", "N", "size of the map (default 48)", &options->size, 16, Constants::MAP_MAX_SIZE);
+    parser.add("--units", "N", "units per player (default 20)", &options->units, 1, std::numeric_limits<int>::max());
+    parser.add("--ticks", "N", "how long to run (default 600)", &options->ticks, 1, std::numeric_limits<int>::max());
+    parser.add("--seed", "N", "random seed (default 1)", &options->seed);
+    return parser;
+}
+
+static void hashBytes(uint64_t *hash, const void *data, const size_t size)
+{
+    const uint8_t *bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        *hash ^= bytes[i];
+        *hash *= 1099511628211ull;
+    }
+}
+
+static uint64_t stateHash(const UnitManager &unitManager)
+{
+    // The ids keep counting up between the runs, so go by the order they were added in instead
+    uint64_t hash = 1469598103934665603ull;
+    for (const Unit::Ptr &unit : unitManager.units()) {
+        const MapPos position = unit->position();
+        const float hitpoints = unit->hitpointsLeft();
+        const int actionType = unit->currentAction() ? int(unit->currentAction()->type) : -1;
+
+        hashBytes(&hash, &position.x, sizeof position.x);
+        hashBytes(&hash, &position.y, sizeof position.y);
+        hashBytes(&hash, &hitpoints, sizeof hitpoints);
+        hashBytes(&hash, &actionType, sizeof actionType);
+        hashBytes(&hash, &unit->playerId, sizeof unit->playerId);
+    }
+
+    const size_t count = unitManager.units().size();
+    hashBytes(&hash, &count, sizeof count);
+
+    return hash;
+}
+
+static RunResult run(const Options &options, const bool singleThreaded)
+{
+    JobSystem::Inst().setSingleThreaded(singleThreaded);
+    std::srand(options.seed);
+
+    RunResult result;
+
+    std::shared_ptr<Map> map = std::make_shared<Map>();
+    std::shared_ptr<UnitManager> unitManager = std::make_shared<UnitManager>();
+    if (!unitManager->init()) {
+        WARN << "Failed to set up the unit manager";
+        return result;
+    }
+    unitManager->setMap(map);
+
+    genie::ScnMap description;
+    description.width = options.size;
+    description.height = options.size;
+    description.tiles.resize(options.size * options.size);
+    for (genie::MapTile &tile : description.tiles) {
+        tile.terrainID = GRASS;
+        tile.elevation = 0;
+    }
+    map->create(description);
+
+    const Player::Ptr left = std::make_shared<Player>(1, 1);
+    const Player::Ptr right = std::make_shared<Player>(2, 2);
+
+    // Two lines of militia and archers walking into each other in the middle
+    const int unitIds[] = { Unit::Militia, Unit::Archer };
+    const int rows = std::max(options.size / 3, 1);
+    std::vector<Unit::Ptr> units;
+    for (int i = 0; i < options.units; i++) {
+        const int row = options.size / 3 + i % rows;
+        const int column = 2 + i / rows;
+
+        const MapPos leftPos(column * Constants::TILE_SIZE, row * Constants::TILE_SIZE);
+        const MapPos rightPos((options.size - 1 - column) * Constants::TILE_SIZE, row * Constants::TILE_SIZE);
+
+        Unit::Ptr unit = UnitFactory::Inst().createUnit(unitIds[i % 2], leftPos, left, *unitManager);
+        unitManager->add(unit);
+        units.push_back(unit);
+
+        unit = UnitFactory::Inst().createUnit(unitIds[i % 2], rightPos, right, *unitManager);
+        unitManager->add(unit);
+        units.push_back(unit);
+    }
+
+    map->updateMapData();
+    map->setDeferSignals(true);
+
+    const MapPos middle(options.size * Constants::TILE_SIZE / 2, options.size * Constants::TILE_SIZE / 2);
+    for (const Unit::Ptr &unit : units) {
+        unitManager->moveUnitTo(unit, middle);
+    }
+
+    // Same as the engine, counted in microseconds so the ticks don't drift
+    int64_t simulationTime = 0;
+    for (int tick = 0; tick < options.ticks; tick++) {
+        simulationTime += Engine::DefaultTickLength;
+        unitManager->update(simulationTime / 1000);
+        map->flushSignals();
+
+        // So the paths arrive in the same tick in both runs
+        PathfinderPool::Inst().waitUntilIdle();
+
+        result.stateHashes.push_back(stateHash(*unitManager));
+    }
+
+    JobSystem::Inst().setSingleThreaded(false);
+
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    const ArgumentParser arguments = argumentParser(&options);
+    if (!arguments.parse(argc, argv, &options.gamePath)) {
+        arguments.printUsage(argv[0]);
+        return 1;
+    }
+
+    if (!DataManager::Inst().initialize(options.gamePath)) {
+        WARN << "Failed to load game data";
+        return 1;
+    }
+    if (!AssetManager::Inst()->initialize(options.gamePath, DataManager::Inst().gameVersion())) {
+        WARN << "Failed to load game assets";
+        return 1;
+    }
+
+    const int threadCount = JobSystem::Inst().threadCount();
+    if (threadCount < 2) {
+        WARN << "Only one job thread available, both runs will be the same";
+    }
+
+    // Otherwise which searches get pushed to the next frame depends on the timing
+    PathfinderPool::Inst().setBudgetLimited(false);
+
+    const RunResult single = run(options, true);
+    const RunResult parallel = run(options, false);
+
+    if (single.stateHashes.empty() || parallel.stateHashes.empty()) {
+        return 1;
+    }
+
+    int firstDifference = -1;
+    for (size_t tick = 0; tick < single.stateHashes.size(); tick++) {
+        if (tick >= parallel.stateHashes.size() || single.stateHashes[tick] != parallel.stateHashes[tick]) {
+            firstDifference = tick;
+            break;
+        }
+    }
+
+    std::cout << "{\"size\":" << options.size
+              << ",\"units\":" << options.units
+              << ",\"ticks\":" << options.ticks
+              << ",\"seed\":" << options.seed
+              << ",\"threads\":" << threadCount
+              << ",\"identical\":" << (firstDifference == -1 ? "true" : "false")
+              << ",\"firstDifference\":" << firstDifference
+              << "}" << std::endl;
+
+    return firstDifference == -1 ? 0 : 1;
+}
@@ -0,0 +1,233 @@
+#include <genie/script/ScnFile.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ArgumentParser.h"
+#include "core/Constants.h"
+#include "core/JobSystem.h"
+#include "core/Logger.h"
+#include "core/Utility.h"
+#include "mechanics/Map.h"
+#include "mechanics/MapTile.h"
+#include "resource/AssetManager.h"
+#include "resource/DataManager.h"
+
+// Times Map::updateMapData on generated or loaded maps, both on one thread and spread over
+// the job threads, and checks that both give exactly the same tiles.
+// Prints the results as a single line of JSON so they can be compared between commits.
+
+struct Options {
+    std::string gamePath;
+
+    /// random or a path to a .scn file
+    std::string map = "random";
+    int size = Constants::MAP_MAX_SIZE;
+
+    int runs = 10;
+    unsigned seed = 1;
+
+    std::string output;
+};
+
+static ArgumentParser argumentParser(Options *options)
+{
+    ArgumentParser parser("<game path>");
+    parser.add("--map", "random|<file.scn>", "map to preprocess (default random)", &options->map);
+    parser.add("--size", "N", "size of the random map (default 255)", &options->size, 8, Constants::MAP_MAX_SIZE);
+    parser.add("--runs", "N", "times to run each (default 10)", &options->runs, 1, std::numeric_limits<int>::max());
+    parser.add("--seed", "N", "random seed (default 1)", &options->seed);
+    parser.add("--output", "FILE", "write the results here instead of stdout", &options->output);
+    return parser;
+}
+
+static genie::ScnMap randomMap(const int size, std::mt19937 &random)
+{
+    // Grass, water, forest, desert, shallows and snow, so there's plenty of blending
+    static const int terrains[] = { 0, 1, 10, 14, 4, 32 };
+
+    genie::ScnMap description;
+    description.width = size;
+    description.height = size;
+    description.tiles.resize(size * size);
+
+    std::uniform_int_distribution<int> terrainDistribution(0, std::size(terrains) - 1);
+    std::uniform_int_distribution<int> positionDistribution(0, size - 1);
+    std::uniform_int_distribution<int> radiusDistribution(1, 6);
+
+    for (genie::MapTile &tile : description.tiles) {
+        tile.terrainID = terrains[0];
+        tile.elevation = 0;
+    }
+
+    // Patches of terrain, and hills on top, so there are slopes of every kind
+    const int patches = size * size / 30;
+    for (int i = 0; i < patches; i++) {
+        const int centerCol = positionDistribution(random);
+        const int centerRow = positionDistribution(random);
+        const int radius = radiusDistribution(random);
+        const int terrain = terrains[terrainDistribution(random)];
+        const bool hill = i % 3 == 0;
+
+        for (int row = std::max(centerRow - radius, 0); row <= std::min(centerRow + radius, size - 1); row++) {
+            for (int col = std::max(centerCol - radius, 0); col <= std::min(centerCol + radius, size - 1); col++) {
+                genie::MapTile &tile = description.tiles[row * size + col];
+                if (hill) {
+                    tile.elevation = std::min(tile.elevation + 1, 7);
+                } else {
+                    tile.terrainID = terrain;
+                }
+            }
+        }
+    }
+
+    return description;
+}
+
+static bool createMap(Map *map, const Options &options, std::mt19937 &random)
+{
+    if (options.map == "random") {
+        map->create(randomMap(options.size, random));
+        return true;
+    }
+
+    try {
+        genie::ScnFile scenario;
+        scenario.load(options.map);
+        map->create(scenario.map);
+    } catch (const std::exception &error) {
+        WARN << "Failed to load" << options.map << ":" << error.what();
+        return false;
+    }
+
+    return true;
+}
+
+static std::vector<MapTile> copyTiles(const Map &map)
+{
+    std::vector<MapTile> tiles;
+    tiles.reserve(map.getCols() * map.getRows());
+    for (int row = 0; row < map.getRows(); row++) {
+        for (int col = 0; col < map.getCols(); col++) {
+            tiles.push_back(map.getTileAt(col, row));
+        }
+    }
+    return tiles;
+}
+
+static bool sameTile(const MapTile &a, const MapTile &b)
+{
+    // The == doesn't check everything we set
+    return a == b && a.elevation == b.elevation && a.yOffset == b.yOffset;
+}
+
+static std::string timesJson(std::vector<double> times)
+{
+    std::sort(times.begin(), times.end());
+
+    double sum = 0;
+    for (const double time : times) {
+        sum += time;
+    }
+
+    std::ostringstream json;
+    json << "{\"mean\":" << sum / times.size()
+         << ",\"min\":" << times.front()
+         << ",\"p50\":" << times[times.size() / 2]
+         << ",\"max\":" << times.back()
+         << "}";
+    return json.str();
+}
+
+static std::vector<double> timeRuns(Map *map, const bool parallel, const int runs)
+{
+    std::vector<double> times;
+    for (int i = 0; i < runs; i++) {
+        const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+        map->updateMapData(parallel);
+        const std::chrono::steady_clock::time_point endTime = std::chrono::steady_clock::now();
+
+        times.push_back(std::chrono::duration<double, std::milli>(endTime - startTime).count());
+    }
+    return times;
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    const ArgumentParser arguments = argumentParser(&options);
+    if (!arguments.parse(argc, argv, &options.gamePath)) {
+        arguments.printUsage(argv[0]);
+        return 1;
+    }
+
+    if (!DataManager::Inst().initialize(options.gamePath)) {
+        WARN << "Failed to load game data";
+        return 1;
+    }
+    if (!AssetManager::Inst()->initialize(options.gamePath, DataManager::Inst().gameVersion())) {
+        WARN << "Failed to load game assets";
+        return 1;
+    }
+
+    std::mt19937 random(options.seed);
+
+    std::shared_ptr<Map> map = std::make_shared<Map>();
+    if (!createMap(map.get(), options, random)) {
+        return 1;
+    }
+
+    DBG << "Running" << options.runs << "times on" << map->getCols() << "x" << map->getRows();
+
+    // The first one loads all the terrain sprites, don't count that
+    map->updateMapData(false);
+
+    const std::vector<double> serialTimes = timeRuns(map.get(), false, options.runs);
+    const std::vector<MapTile> serialTiles = copyTiles(*map);
+
+    const std::vector<double> parallelTimes = timeRuns(map.get(), true, options.runs);
+    const std::vector<MapTile> parallelTiles = copyTiles(*map);
+
+    int differentTiles = 0;
+    for (size_t i = 0; i < serialTiles.size(); i++) {
+        if (!sameTile(serialTiles[i], parallelTiles[i])) {
+            differentTiles++;
+        }
+    }
+    if (differentTiles > 0) {
+        WARN << differentTiles << "tiles differ between serial and parallel";
+    }
+
+    std::ostringstream json;
+    json << "{\"map\":\"" << util::jsonEscape(options.map) << "\""
+         << ",\"cols\":" << map->getCols()
+         << ",\"rows\":" << map->getRows()
+         << ",\"seed\":" << options.seed
+         << ",\"runs\":" << options.runs
+         << ",\"threads\":" << JobSystem::Inst().threadCount()
+         << ",\"serialMs\":" << timesJson(serialTimes)
+         << ",\"parallelMs\":" << timesJson(parallelTimes)
+         << ",\"identical\":" << (differentTiles == 0 ? "true" : "false")
+         << ",\"differentTiles\":" << differentTiles
+         << "}";
+
+    if (options.output.empty()) {
+        std::cout << json.str() << std::endl;
+    } else {
+        std::ofstream outputFile(options.output);
+        if (!outputFile.good()) {
+            WARN << "Failed to open" << options.output;
+            return 1;
+        }
+        outputFile << json.str() << std::endl;
+    }
+
+    return differentTiles == 0 ? 0 : 1;
+}
@@ -0,0 +1,434 @@
+#include <genie/script/ScnFile.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ArgumentParser.h"
+#include "actions/ActionMove.h"
+#include "core/Constants.h"
+#include "core/Logger.h"
+#include "core/Utility.h"
+#include "mechanics/Civilization.h"
+#include "mechanics/Map.h"
+#include "mechanics/Unit.h"
+#include "pathfinding/Pathfinder.h"
+#include "resource/DataManager.h"
+
+// Runs batches of the same path requests ActionMove sends on generated or loaded maps,
+// and prints the results as a single line of JSON so they can be compared between commits.
+
+static const int GRASS = 0;
+static const int WATER = 1; // Blocks land units
+
+struct Options {
+    std::string gamePath;
+
+    /// open, basic, allunits, or a path to a .scn file
+    std::string map = "open";
+    int size = 128;
+
+    /// none, forest, walls or chokepoints
+    std::string pattern = "forest";
+
+    int count = 200;
+    unsigned seed = 1;
+    int unitId = Unit::MaleVillager;
+
+    /// The pathfinder used to give up after this, so count how many would have
+    float timeoutMs = 50;
+
+    /// How many of the paths to also run through the plain grid search and the jump point one, to check they agree
+    int gridChecks = 50;
+
+    std::string output;
+};
+
+struct Sample {
+    bool found = false;
+    double ms = 0;
+    size_t expanded = 0;
+    double lengthRatio = 0;
+};
+
+/// The same grid search with and without jump points
+struct GridCheck {
+    bool plainFound = false;
+    bool jumpPointsFound = false;
+    size_t plainExpanded = 0;
+    size_t jumpPointsExpanded = 0;
+
+    /// Jump point path length against the plain one
+    double lengthRatio = 0;
+};
+
+static ArgumentParser argumentParser(Options *options)
+{
+    ArgumentParser parser("<game path>");
+    parser.add("--map", "open|basic|allunits|<file.scn>", "map to search in (default open)", &options->map);
+    parser.add("--size", "N", "size of the open map (default 128)", &options->size, 8, Constants::MAP_MAX_SIZE);
+    parser.add("--pattern", "none|forest|walls|chokepoints", "obstacles to add (default forest)", &options->pattern);
+    parser.add("--count", "N", "number of paths (default 200)", &options->count, 1, std::numeric_limits<int>::max());
+    parser.add("--seed", "N", "random seed (default 1)", &options->seed);
+    parser.add("--unit", "ID", "unit to path for (default villager)", &options->unitId, 0, std::numeric_limits<int>::max());
+    parser.add("--timeout-ms", "MS", "what counts as a timeout (default 50)", &options->timeoutMs);
+    parser.add("--grid-checks", "N", "paths to compare the plain and jump point grid search on (default 50)", &options->gridChecks, 0, std::numeric_limits<int>::max());
+    parser.add("--output", "FILE", "write the results here instead of stdout", &options->output);
+    return parser;
+}
+
+static bool createMap(Map *map, const Options &options)
+{
+    if (options.map == "basic") {
+        map->setupBasic();
+        return true;
+    }
+
+    if (options.map == "allunits") {
+        map->setupAllunitsMap();
+        return true;
+    }
+
+    if (options.map == "open") {
+        genie::ScnMap description;
+        description.width = options.size;
+        description.height = options.size;
+        description.tiles.resize(options.size * options.size);
+        for (genie::MapTile &tile : description.tiles) {
+            tile.terrainID = GRASS;
+            tile.elevation = 0;
+        }
+        map->create(description);
+        return true;
+    }
+
+    try {
+        genie::ScnFile scenario;
+        scenario.load(options.map);
+        map->create(scenario.map);
+    } catch (const std::exception &error) {
+        WARN << "Failed to load" << options.map << ":" << error.what();
+        return false;
+    }
+
+    return true;
+}
+
+static void fill(Map *map, const int col, const int row)
+{
+    if (col >= 0 && row >= 0 && col < map->getCols() && row < map->getRows()) {
+        map->setTileAt(col, row, WATER);
+    }
+}
+
+static bool addPattern(Map *map, const std::string &pattern, std::mt19937 &random)
+{
+    const int cols = map->getCols();
+    const int rows = map->getRows();
+
+    if (pattern == "none") {
+        return true;
+    }
+
+    if (pattern == "forest") {
+        // Lots of clumps of different sizes
+        std::uniform_int_distribution<int> colDistribution(0, cols - 1);
+        std::uniform_int_distribution<int> rowDistribution(0, rows - 1);
+        std::uniform_int_distribution<int> radiusDistribution(1, 4);
+        std::bernoulli_distribution dense(0.7);
+
+        const int clumps = cols * rows / 40;
+        for (int i = 0; i < clumps; i++) {
+            const int centerCol = colDistribution(random);
+            const int centerRow = rowDistribution(random);
+            const int radius = radiusDistribution(random);
+            for (int col = centerCol - radius; col <= centerCol + radius; col++) {
+                for (int row = centerRow - radius; row <= centerRow + radius; row++) {
+                    if (std::hypot(col - centerCol, row - centerRow) <= radius && dense(random)) {
+                        fill(map, col, row);
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    if (pattern == "walls") {
+        // Long horizontal walls with a couple of openings each
+        std::uniform_int_distribution<int> gapDistribution(1, cols - 3);
+        for (int row = 6; row < rows - 2; row += 8) {
+            const int firstGap = gapDistribution(random);
+            const int secondGap = gapDistribution(random);
+            for (int col = 0; col < cols; col++) {
+                if (std::abs(col - firstGap) <= 1 || std::abs(col - secondGap) <= 1) {
+                    continue;
+                }
+                fill(map, col, row);
+            }
+        }
+        return true;
+    }
+
+    if (pattern == "chokepoints") {
+        // A few vertical walls across the whole map, with only a single tile to get through
+        std::uniform_int_distribution<int> gapDistribution(1, rows - 2);
+        for (int col = cols / 4; col < cols; col += cols / 4) {
+            const int gap = gapDistribution(random);
+            for (int row = 0; row < rows; row++) {
+                if (row != gap) {
+                    fill(map, col, row);
+                }
+            }
+        }
+        return true;
+    }
+
+    WARN << "Unknown pattern" << pattern;
+    return false;
+}
+
+static double percentile(std::vector<double> values, const double fraction)
+{
+    if (values.empty()) {
+        return 0;
+    }
+
+    std::sort(values.begin(), values.end());
+    const size_t index = std::min(size_t(fraction * values.size()), values.size() - 1);
+    return values[index];
+}
+
+static double mean(const std::vector<double> &values)
+{
+    if (values.empty()) {
+        return 0;
+    }
+
+    double sum = 0;
+    for (const double value : values) {
+        sum += value;
+    }
+    return sum / values.size();
+}
+
+static std::string distributionJson(const std::vector<double> &values)
+{
+    std::ostringstream json;
+    json << "{\"mean\":" << mean(values)
+         << ",\"p50\":" << percentile(values, 0.5)
+         << ",\"p90\":" << percentile(values, 0.9)
+         << ",\"p99\":" << percentile(values, 0.99)
+         << ",\"max\":" << percentile(values, 1.)
+         << "}";
+    return json.str();
+}
+
+static double pathLength(const MapPos &start, const std::vector<MapPos> &path)
+{
+    // Reversed, back() is the first waypoint
+    double length = 0;
+    MapPos previous = start;
+    for (std::vector<MapPos>::const_reverse_iterator it = path.rbegin(); it != path.rend(); it++) {
+        length += previous.distance(*it);
+        previous = *it;
+    }
+    return length;
+}
+
+static GridCheck checkGridSearch(PathRequest request)
+{
+    // Coarseness is the same as the fallback in the full search
+    GridCheck check;
+
+    request.jumpPoints = false;
+    Pathfinder plain(request);
+    const std::vector<MapPos> plainPath = plain.findPath(request.start, request.destination, 2);
+    check.plainFound = !plainPath.empty();
+    check.plainExpanded = plain.expandedCount();
+
+    request.jumpPoints = true;
+    Pathfinder jumpPoints(request);
+    const std::vector<MapPos> jumpPointPath = jumpPoints.findPath(request.start, request.destination, 2);
+    check.jumpPointsFound = !jumpPointPath.empty();
+    check.jumpPointsExpanded = jumpPoints.expandedCount();
+
+    if (check.plainFound && check.jumpPointsFound) {
+        const double plainLength = pathLength(request.start, plainPath);
+        if (plainLength > 0) {
+            check.lengthRatio = pathLength(request.start, jumpPointPath) / plainLength;
+        }
+    }
+
+    return check;
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    const ArgumentParser arguments = argumentParser(&options);
+    if (!arguments.parse(argc, argv, &options.gamePath)) {
+        arguments.printUsage(argv[0]);
+        return 1;
+    }
+
+    if (!DataManager::Inst().initialize(options.gamePath)) {
+        WARN << "Failed to load game data";
+        return 1;
+    }
+
+    std::mt19937 random(options.seed);
+
+    std::shared_ptr<Map> map = std::make_shared<Map>();
+    if (!createMap(map.get(), options)) {
+        return 1;
+    }
+    if (!addPattern(map.get(), options.pattern, random)) {
+        return 1;
+    }
+
+    const Civilization civilization(1);
+    const genie::Unit &unitData = civilization.unitData(options.unitId);
+    const int restriction = unitData.TerrainRestriction;
+
+    const PassabilityMap &passability = map->passability();
+    std::vector<int> passableTiles;
+    for (int row = 0; row < passability.rows(); row++) {
+        for (int col = 0; col < passability.cols(); col++) {
+            if (passability.isPassable(restriction, col, row)) {
+                passableTiles.push_back(row * passability.cols() + col);
+            }
+        }
+    }
+    if (passableTiles.size() < 2) {
+        WARN << "Nowhere to go";
+        return 1;
+    }
+
+    // Same snapshot for everything, like units asking in the same tick
+    const ObstructionSnapshot::Ptr snapshot = ObstructionSnapshot::create(*map, restriction);
+
+    DBG << "Running" << options.count << "paths on" << options.map << "with" << options.pattern;
+
+    std::uniform_int_distribution<size_t> tileDistribution(0, passableTiles.size() - 1);
+    std::vector<Sample> samples;
+    samples.reserve(options.count);
+    std::vector<GridCheck> gridChecks;
+    for (int i = 0; i < options.count; i++) {
+        const int startTile = passableTiles[tileDistribution(random)];
+        const int endTile = passableTiles[tileDistribution(random)];
+
+        // The same as a unit ordered to move there would send
+        const MapPos start((startTile % passability.cols()) * Constants::TILE_SIZE, (startTile / passability.cols()) * Constants::TILE_SIZE);
+        const MapPos destination((endTile % passability.cols()) * Constants::TILE_SIZE, (endTile / passability.cols()) * Constants::TILE_SIZE);
+        const PathRequest request = ActionMove::createPathRequest(snapshot, unitData, -1, start, destination);
+
+        Pathfinder pathfinder(request);
+
+        const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+        const PathResult result = pathfinder.run();
+        const std::chrono::steady_clock::time_point endTime = std::chrono::steady_clock::now();
+
+        Sample sample;
+        sample.ms = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+        sample.expanded = pathfinder.expandedCount();
+        sample.found = !result.path.empty();
+
+        // Against a straight line to where it actually ended up going
+        const double straightDistance = request.start.distance(result.destination);
+        if (sample.found && straightDistance > Constants::TILE_SIZE) {
+            sample.lengthRatio = pathLength(request.start, result.path) / straightDistance;
+        }
+
+        samples.push_back(sample);
+
+        if (i < options.gridChecks) {
+            gridChecks.push_back(checkGridSearch(request));
+        }
+    }
+
+    int found = 0;
+    int timeouts = 0;
+    std::vector<double> times;
+    std::vector<double> expanded;
+    std::vector<double> lengthRatios;
+    for (const Sample &sample : samples) {
+        times.push_back(sample.ms);
+        expanded.push_back(sample.expanded);
+
+        if (sample.found) {
+            found++;
+        }
+        if (sample.ms > options.timeoutMs) {
+            timeouts++;
+        }
+        if (sample.lengthRatio > 0) {
+            lengthRatios.push_back(sample.lengthRatio);
+        }
+    }
+
+    // The heuristic is weighted, so neither search is guaranteed to find the shortest path and they
+    // don't always end up with the same one. But they have to agree on whether there is one.
+    int gridMismatches = 0;
+    std::vector<double> plainExpanded;
+    std::vector<double> jumpPointsExpanded;
+    std::vector<double> gridLengthRatios;
+    for (const GridCheck &check : gridChecks) {
+        if (check.plainFound != check.jumpPointsFound) {
+            gridMismatches++;
+        }
+        plainExpanded.push_back(check.plainExpanded);
+        jumpPointsExpanded.push_back(check.jumpPointsExpanded);
+        if (check.lengthRatio > 0) {
+            gridLengthRatios.push_back(check.lengthRatio);
+        }
+    }
+    if (gridMismatches) {
+        WARN << "The plain and jump point grid searches disagreed on" << gridMismatches << "paths";
+    }
+
+    std::ostringstream json;
+    json << "{\"map\":\"" << util::jsonEscape(options.map) << "\""
+         << ",\"cols\":" << map->getCols()
+         << ",\"rows\":" << map->getRows()
+         << ",\"pattern\":\"" << util::jsonEscape(options.pattern) << "\""
+         << ",\"seed\":" << options.seed
+         << ",\"unit\":" << options.unitId
+         << ",\"restriction\":" << restriction
+         << ",\"paths\":" << samples.size()
+         << ",\"found\":" << found
+         << ",\"failed\":" << (int(samples.size()) - found)
+         << ",\"timeouts\":" << timeouts
+         << ",\"timeoutMs\":" << options.timeoutMs
+         << ",\"ms\":" << distributionJson(times)
+         << ",\"expanded\":" << distributionJson(expanded)
+         << ",\"lengthRatio\":" << distributionJson(lengthRatios)
+         << ",\"gridChecks\":{\"paths\":" << gridChecks.size()
+         << ",\"mismatches\":" << gridMismatches
+         << ",\"plainExpanded\":" << distributionJson(plainExpanded)
+         << ",\"jumpPointsExpanded\":" << distributionJson(jumpPointsExpanded)
+         << ",\"lengthRatio\":" << distributionJson(gridLengthRatios)
+         << "}}";
+
+    const int exitCode = gridMismatches ? 1 : 0;
+
+    if (options.output.empty()) {
+        std::cout << json.str() << std::endl;
+        return exitCode;
+    }
+
+    std::ofstream outputFile(options.output);
+    if (!outputFile.good()) {
+        WARN << "Failed to open" << options.output;
+        return 1;
+    }
+    outputFile << json.str() << std::endl;
+
+    return exitCode;
+}